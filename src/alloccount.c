@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ alloccount.c  heap allocation counting for make ALLOC_COUNT=1
+
+ malloc, calloc and realloc are replaced with counting versions that call
+ on to glibc, so allocations made inside the C library (stdio buffers,
+ strdup) are seen as well as our own. Only built in with ALLOC_COUNT, the
+ normal build leaves the allocator alone.
+ */
+
+#include "alloccount.h"
+
+#ifdef ALLOC_COUNT
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#ifndef __GLIBC__
+#error "ALLOC_COUNT=1 needs glibc"
+#endif
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* block, size_t size);
+
+static atomic_ullong total_allocs;
+static atomic_ullong warmup_allocs;     // Made by each thread's first job
+static atomic_ullong steady_allocs;     // Made by every later job
+
+static __thread uint64_t thread_allocs;
+static __thread uint64_t job_start;
+static __thread bool thread_warm;
+
+static void countAlloc(void) {
+    thread_allocs++;
+    atomic_fetch_add_explicit(&total_allocs, 1, memory_order_relaxed);
+}
+
+void* malloc(size_t size) {
+    countAlloc();
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    countAlloc();
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* block, size_t size) {
+    countAlloc();
+    return __libc_realloc(block, size);
+}
+
+void beginAllocJob(void) {
+    job_start = thread_allocs;
+}
+
+void endAllocJob(void) {
+    uint64_t n = thread_allocs - job_start;
+    atomic_fetch_add_explicit(thread_warm ? &steady_allocs : &warmup_allocs, n, memory_order_relaxed);
+    thread_warm = true;
+}
+
+void printAllocSummary(void) {
+    printf("Heap allocations: %llu in total, %llu in warm up jobs, %llu in steady state jobs\n",
+           (unsigned long long)atomic_load(&total_allocs), (unsigned long long)atomic_load(&warmup_allocs),
+           (unsigned long long)atomic_load(&steady_allocs));
+}
+
+#endif // ALLOC_COUNT
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ alloccount.h  include for alloccount.c
+ */
+
+#ifndef ALLOCCOUNT_H
+#define ALLOCCOUNT_H
+
+// Heap allocation counting, built with make ALLOC_COUNT=1. Work between
+// beginAllocJob() and endAllocJob() is charged to a job; each thread's
+// first job is the warm up, every later one should allocate nothing.
+#ifdef ALLOC_COUNT
+void beginAllocJob(void);
+void endAllocJob(void);
+void printAllocSummary(void);
+#else
+#define beginAllocJob()      ((void)0)
+#define endAllocJob()        ((void)0)
+#define printAllocSummary()  ((void)0)
+#endif
+
+#endif // ALLOCCOUNT_H
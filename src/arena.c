@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ arena.c  per job bump allocator
+
+ Batch and single image runs take the image, text bitmap, output paths and
+ encoded outputs of a job from one arena and reset it when the job is done.
+ The block is sized for a job up front; anything past it is spilled to
+ malloc for that job only and the block is grown to fit at the next reset.
+ */
+
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Spilled allocation, the data follows the header at ARENA_ALIGN.
+struct ArenaSpill {
+    ArenaSpill* next;
+};
+
+static size_t alignSize(size_t size) {
+    return (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+int initArena(Arena* arena, size_t size) {
+    memset(arena, 0, sizeof(*arena));
+    arena->base = (char*)malloc(size);
+    if (!arena->base) {
+        return 0;
+    }
+    arena->size = size;
+    return 1;
+}
+
+// size bytes aligned to ARENA_ALIGN, NULL only when a spill fails.
+void* allocArena(Arena* arena, size_t size) {
+    size_t n = alignSize(size ? size : 1);
+
+    arena->wanted += n;
+    if (arena->wanted > arena->peak) {
+        arena->peak = arena->wanted;
+    }
+
+    if (n <= arena->size - arena->used) {
+        arena->top = arena->base + arena->used;
+        arena->used += n;
+        return arena->top;
+    }
+
+    ArenaSpill* spill = (ArenaSpill*)malloc(ARENA_ALIGN + n);
+    if (!spill) {
+        return NULL;
+    }
+    spill->next = arena->spill;
+    arena->spill = spill;
+    arena->top = NULL;
+    return (char*)spill + ARENA_ALIGN;
+}
+
+// Resize block (NULL allocates), in place when it is the last allocation
+// and still fits, otherwise moved to a new allocation.
+void* growArena(Arena* arena, void* block, size_t old_size, size_t new_size) {
+    if (block && block == arena->top) {
+        size_t offset = (size_t)((char*)block - arena->base);
+        size_t n = alignSize(new_size);
+        if (n <= arena->size - offset) {
+            arena->wanted = arena->wanted - (arena->used - offset) + n;
+            if (arena->wanted > arena->peak) {
+                arena->peak = arena->wanted;
+            }
+            arena->used = offset + n;
+            return block;
+        }
+    }
+
+    void* grown = allocArena(arena, new_size);
+    if (grown && block) {
+        memcpy(grown, block, old_size);
+    }
+    return grown;
+}
+
+static void freeSpills(Arena* arena) {
+    while (arena->spill) {
+        ArenaSpill* next = arena->spill->next;
+        free(arena->spill);
+        arena->spill = next;
+    }
+}
+
+// Release everything allocated since the last reset.
+void resetArena(Arena* arena) {
+    freeSpills(arena);
+
+    // A job spilled, make room for it in the block from now on.
+    if (arena->peak > arena->size) {
+        char* grown = (char*)malloc(arena->peak);
+        if (grown) {
+            free(arena->base);
+            arena->base = grown;
+            arena->size = arena->peak;
+        }
+    }
+
+    arena->used = 0;
+    arena->wanted = 0;
+    arena->top = NULL;
+}
+
+void freeArena(Arena* arena) {
+    freeSpills(arena);
+    free(arena->base);
+    memset(arena, 0, sizeof(*arena));
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ arena.h  include for arena.c
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_ALIGN       16
+#define JOB_ARENA_SIZE    (512 * 1024)  // Image, bitmap, paths and every encoded output of a job
+
+typedef struct ArenaSpill ArenaSpill;
+
+// Bump allocator for the buffers of one job, emptied with resetArena().
+// Allocations that do not fit come from malloc until the next reset, which
+// then grows the block to the peak, so a repeated job allocates nothing.
+typedef struct {
+    char*  base;
+    size_t size;
+    size_t used;
+    size_t wanted;                  // Bytes allocated since the reset, spills included
+    size_t peak;                    // Most bytes wanted between resets
+    void*  top;                     // Last allocation in the block, it can grow in place
+    ArenaSpill* spill;              // Overflow allocations, freed on reset
+} Arena;
+
+int initArena(Arena* arena, size_t size);
+void* allocArena(Arena* arena, size_t size);
+void* growArena(Arena* arena, void* block, size_t old_size, size_t new_size);
+void resetArena(Arena* arena);
+void freeArena(Arena* arena);
+
+#endif // ARENA_H
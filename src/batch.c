@@ -0,0 +1,830 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ batch.c  manifest (batch) mode, generates many EPROM images in one process.
+
+ Manifest format, one image per line:
+
+    # ID text,      output file,   options
+    VK3DG GEELONG,  out/vk3dg,     debug
+    "VK3EHT",       out/vk3eht
+    VK3XKA,         out/vk3xka,    nolabel
+
+ Blank lines and lines starting with '#' are ignored. Fields may be quoted,
+ underscores in the ID text become spaces as with -t. Options are separated
+ by spaces or ';':
+    debug     also write <name>.dump and <name>_id.txt
+    nolabel   do not write <name>_eprom_label.html
+ Each output file belongs to one row, a later row naming it again fails.
+
+ With -j N the images are generated on N threads and written by one writer.
+ With --writer pwritev or uring the outputs of many jobs are formatted into
+ memory and written a batch at a time (see writer.c). The encoded outputs
+ of a job are held in a job arena (arena.c) that is reset after the job, so
+ once warm a run makes no heap allocations per image.
+ */
+
+#include "batch.h"
+#include "tcgen.h"
+#include "debug.h"
+#include "alloccount.h"
+#include "stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// Monotonic time in seconds, used for the throughput figure.
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Copy the next comma separated field into field, return pointer past it.
+// Surrounding white space is trimmed, double quotes protect the content.
+static const char* nextField(const char* p, char* field, size_t field_size) {
+    size_t len = 0;
+
+    while (*p == ' ' || *p == '\t') p++;
+
+    if (*p == '"') {
+        p++;
+        while (*p && *p != '"') {
+            if (len < field_size - 1) field[len++] = *p;
+            p++;
+        }
+        if (*p == '"') p++;
+        while (*p && *p != ',') p++;
+    } else {
+        while (*p && *p != ',') {
+            if (len < field_size - 1) field[len++] = *p;
+            p++;
+        }
+        while (len > 0 && (field[len-1] == ' ' || field[len-1] == '\t')) len--;
+    }
+    field[len] = '\0';
+
+    if (*p == ',') p++;
+    return p;
+}
+
+// Parse one manifest line. Returns 1 for a job, 0 for a blank or comment
+// line and -1 on error.
+int parseManifestLine(const char* line, int line_no, BatchJob* job) {
+    char text[MANIFEST_LINE_MAX];
+    char options[MANIFEST_LINE_MAX];
+    char raw[MANIFEST_LINE_MAX];
+
+    const char* p = line;
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p == '\0' || *p == '\r' || *p == '\n' || *p == '#') {
+        return 0;
+    }
+
+    // Strip the line ending before splitting fields.
+    strncpy(raw, p, sizeof(raw) - 1);
+    raw[sizeof(raw) - 1] = '\0';
+    raw[strcspn(raw, "\r\n")] = '\0';
+
+    memset(job, 0, sizeof(*job));
+    job->line = line_no;
+    job->label = true;
+
+    p = nextField(raw, text, sizeof(text));
+    p = nextField(p, job->output_file, sizeof(job->output_file));
+    nextField(p, options, sizeof(options));
+
+    if (!text[0] || !job->output_file[0]) {
+        fprintf(stderr, "Error: Manifest line %d: ID text and output file are required\n", line_no);
+        return -1;
+    }
+
+    // Normalise into a larger buffer first so over-length text is reported.
+    normalizeIdText(text, text, sizeof(text));
+    if (!validateText(text)) {
+        fprintf(stderr, "Error: Manifest line %d: invalid ID text\n", line_no);
+        return -1;
+    }
+    strcpy(job->id_text, text);
+
+    for (char* opt = strtok(options, " ;\t"); opt; opt = strtok(NULL, " ;\t")) {
+        if (strcmp(opt, "debug") == 0) {
+            job->debug = true;
+        } else if (strcmp(opt, "nolabel") == 0) {
+            job->label = false;
+        } else {
+            fprintf(stderr, "Error: Manifest line %d: unknown option '%s'\n", line_no, opt);
+            return -1;
+        }
+    }
+
+    return 1;
+}
+
+// File to write an output to: the output itself, or with an index a
+// temporary that commitOutput() puts in place.
+static const char* outputTarget(const BatchOptions* options, const char* path, char* tmp) {
+    return options->index ? getTempName(path, tmp, OUTPUT_PATH_MAX + 16) : path;
+}
+
+static int commitOutput(const BatchJob* job, const BatchOptions* options, const char* tmp, const char* path) {
+    return !options->index || commitOutputFile(options->index, job->key, tmp, path);
+}
+
+// Image formats written for a job: the -f list, and the dump for "debug".
+static int getJobFormats(const BatchJob* job, const BatchOptions* options, EncoderList* list) {
+    *list = options->formats;
+    if (list->count == 0 && !parseEncoderList(ENCODER_DEFAULT, list)) {
+        return 0;
+    }
+    return !job->debug || addEncoderFormat(list, findEncoderFormat("dump"));
+}
+
+// Write all outputs for one generated job. Encoded outputs are held in
+// arena, or on the heap when it is NULL.
+int writeJobOutputs(const BatchJob* job, const uint8_t* eprom_data, const uint8_t* bitmap_data,
+                    const BatchOptions* options, Arena* arena) {
+    OutputNames names;
+    EncoderList formats;
+    OutputBuffer outs[MAX_ENCODERS];
+    char name[OUTPUT_PATH_MAX];
+    char tmp[OUTPUT_PATH_MAX + 16];
+
+    if (!buildOutputNames(job->output_file, &names) || !getJobFormats(job, options, &formats)) {
+        return 0;
+    }
+
+    // All image formats in one pass.
+    memset(outs, 0, sizeof(outs));
+    for (int i = 0; i < formats.count; i++) {
+        outs[i].arena = arena;
+    }
+    uint64_t started = startStatsTimer();
+    int ok = encodeImage(eprom_data, EPROM_SIZE, &formats, &options->hex, outs);
+    stopStatsTimer(STATS_ENCODE, started);
+    countStatsRecords(outs, &formats);
+    if (!ok) {
+        fprintf(stderr, "Error: Could not encode the image\n");
+    }
+    for (int i = 0; ok && i < formats.count; i++) {
+        const EncoderFormat* format = formats.formats[i];
+        ok = buildOutputName(job->output_file, format->suffix, name) &&
+             writeOutputBuffer(&outs[i], outputTarget(options, name, tmp), format->binary) &&
+             commitOutput(job, options, tmp, name);
+        if (!ok) {
+            fprintf(stderr, "Error: Failed to write %s file: %s\n", format->description, name);
+        }
+    }
+    for (int i = 0; i < formats.count; i++) {
+        freeOutputBuffer(&outs[i]);
+    }
+    if (!ok) {
+        return 0;
+    }
+
+    if (job->debug) {
+        if (!writeCharBitmapFile(bitmap_data, outputTarget(options, names.text, tmp), job->id_text) ||
+            !commitOutput(job, options, tmp, names.text)) {
+            fprintf(stderr, "Error writing character bitmap file.\n");
+            return 0;
+        }
+    }
+
+    if (job->label) {
+        printEpromLabel(job->id_text, outputTarget(options, names.label, tmp));
+        if (!commitOutput(job, options, tmp, names.label)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// With an output index, set the job's input key and return true if every
+// output it would write was written for that key and is unchanged since.
+bool isJobCurrent(BatchJob* job, const BatchOptions* options) {
+    OutputNames names;
+    EncoderList formats;
+    char name[OUTPUT_PATH_MAX];
+
+    if (!options->index || !job->valid || !buildOutputNames(job->output_file, &names) ||
+        !getJobFormats(job, options, &formats)) {
+        return false;
+    }
+
+    job->key = getOutputKey(job->id_text, job->debug, job->label, &options->hex);
+    for (int i = 0; i < formats.count; i++) {
+        if (!buildOutputName(job->output_file, formats.formats[i]->suffix, name) ||
+            !isOutputCurrent(options->index, job->key, name)) {
+            return false;
+        }
+    }
+    return (!job->debug || isOutputCurrent(options->index, job->key, names.text)) &&
+           (!job->label || isOutputCurrent(options->index, job->key, names.label));
+}
+
+// Format all outputs for one generated job into the batched writer.
+static int queueJobOutputs(const BatchJob* job, int index, const uint8_t* eprom_data,
+                           const uint8_t* bitmap_data, const BatchOptions* options, FileWriter* writer,
+                           Arena* arena) {
+    OutputNames names;
+    EncoderList formats;
+    OutputBuffer outs[MAX_ENCODERS];
+    OutputBuffer* out = &writer->data;
+    char name[OUTPUT_PATH_MAX];
+
+    if (!buildOutputNames(job->output_file, &names) || !getJobFormats(job, options, &formats)) {
+        return 0;
+    }
+
+    memset(outs, 0, sizeof(outs));
+    for (int i = 0; i < formats.count; i++) {
+        outs[i].arena = arena;
+    }
+    uint64_t started = startStatsTimer();
+    int ok = encodeImage(eprom_data, EPROM_SIZE, &formats, &options->hex, outs);
+    stopStatsTimer(STATS_ENCODE, started);
+    countStatsRecords(outs, &formats);
+    for (int i = 0; ok && i < formats.count; i++) {
+        size_t start = out->length;
+        char* p = reserveOutputBuffer(out, outs[i].length);
+        if (p) {
+            memcpy(p, outs[i].data, outs[i].length);
+            out->length += outs[i].length;
+            countStatsBytes(outs[i].length);
+        }
+        ok = buildOutputName(job->output_file, formats.formats[i]->suffix, name) &&
+             queueWriterFile(writer, name, start, index);
+    }
+    for (int i = 0; i < formats.count; i++) {
+        freeOutputBuffer(&outs[i]);
+    }
+
+    if (job->debug) {
+        size_t start = out->length;
+        ok = ok && formatCharBitmap(bitmap_data, job->id_text, out) &&
+             queueWriterFile(writer, names.text, start, index);
+        countStatsBytes(out->length - start);
+    }
+
+    if (job->label) {
+        size_t start = out->length;
+        ok = ok && formatEpromLabel(job->id_text, out) &&
+             queueWriterFile(writer, names.label, start, index);
+        countStatsBytes(out->length - start);
+    }
+
+    return ok;
+}
+
+// Write the batch out once it is full (or always when last is set) and
+// report what it took.
+static void flushJobOutputs(FileWriter* writer, bool* status, bool last) {
+    if (!writer->count || (!last && !isWriterFull(writer))) {
+        return;
+    }
+    uint64_t started = startStatsTimer();
+    flushFileWriter(writer, status);
+    stopStatsTimer(STATS_FLUSH, started);
+    countStatsFiles(writer->batch.files);
+    printf("Write batch %d: %d files, %llu bytes, %ld syscalls (%s)\n", writer->batches,
+           writer->batch.files, (unsigned long long)writer->batch.bytes, writer->batch.syscalls,
+           getWriterName(writer->backend));
+}
+
+// Generate and write all outputs for one job using the caller's buffers.
+int runJob(const BatchJob* job, uint8_t* eprom_data, uint8_t* bitmap_data, const BatchOptions* options,
+           Arena* arena) {
+    if (!generateImage(job->id_text, eprom_data, job->debug ? bitmap_data : NULL)) {
+        return 0;
+    }
+    return writeJobOutputs(job, eprom_data, bitmap_data, options, arena);
+}
+
+static const BatchJob* sort_rows;
+
+static int compareRowOutputs(const void* a, const void* b) {
+    const BatchJob* x = &sort_rows[*(const int*)a];
+    const BatchJob* y = &sort_rows[*(const int*)b];
+    int cmp = strcmp(x->output_file, y->output_file);
+    return cmp ? cmp : x->line - y->line;
+}
+
+// Fail every row whose output file an earlier row already writes, so the
+// first row of a stem wins with any thread count (--watch keeps the same
+// one). Returns 0 if out of memory.
+static int rejectDuplicateOutputs(BatchJob* jobs, int count) {
+    int* order = (int*)malloc((count ? count : 1) * sizeof(int));
+    if (!order) {
+        perror("Error allocating memory for manifest");
+        return 0;
+    }
+    int valid = 0;
+    for (int i = 0; i < count; i++) {
+        if (jobs[i].valid) {
+            order[valid++] = i;
+        }
+    }
+    sort_rows = jobs;
+    qsort(order, valid, sizeof(int), compareRowOutputs);
+    for (int i = 1; i < valid; i++) {
+        BatchJob* first = &jobs[order[i - 1]];
+        BatchJob* row = &jobs[order[i]];
+        if (strcmp(first->output_file, row->output_file) == 0) {
+            fprintf(stderr, "Error: Manifest line %d: output %s is already written by line %d\n", row->line,
+                    row->output_file, first->line);
+            row->valid = false;
+            order[i] = order[i - 1];        // Later copies report the first row too
+        }
+    }
+    free(order);
+    return 1;
+}
+
+// Read every row of a manifest. Invalid rows are kept (valid = false) so the
+// summary can report them in manifest order.
+static BatchJob* loadManifest(const char* manifest_file, int* count) {
+    FILE* fp = fopen(manifest_file, "r");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open manifest %s\n", manifest_file);
+        return NULL;
+    }
+
+    BatchJob* jobs = NULL;
+    int capacity = 0;
+    int n = 0;
+    char line[MANIFEST_LINE_MAX];
+    int line_no = 0;
+
+    while (fgets(line, sizeof(line), fp)) {
+        BatchJob job;
+        line_no++;
+
+        int parsed = parseManifestLine(line, line_no, &job);
+        if (parsed == 0) {
+            continue;
+        }
+        if (parsed < 0) {
+            memset(&job, 0, sizeof(job));
+            job.line = line_no;
+        }
+        job.valid = (parsed > 0);
+
+        if (n == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            BatchJob* grown = (BatchJob*)realloc(jobs, capacity * sizeof(BatchJob));
+            if (!grown) {
+                perror("Error allocating memory for manifest");
+                free(jobs);
+                fclose(fp);
+                return NULL;
+            }
+            jobs = grown;
+        }
+        jobs[n++] = job;
+    }
+
+    fclose(fp);
+    if (!rejectDuplicateOutputs(jobs, n)) {
+        free(jobs);
+        return NULL;
+    }
+    *count = n;
+    if (!jobs) {
+        // Empty manifest, hand back a valid pointer with no jobs.
+        jobs = (BatchJob*)calloc(1, sizeof(BatchJob));
+    }
+    return jobs;
+}
+
+// Single threaded path, every job's buffers come from one arena reset
+// after the job.
+static void runSequential(const BatchJob* jobs, int count, const BatchOptions* options, bool* status,
+                          FileWriter* writer) {
+    Arena arena;
+    if (!initArena(&arena, JOB_ARENA_SIZE)) {
+        perror("Error allocating memory for batch buffers");
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (status[i] || !jobs[i].valid) {
+            continue;
+        }
+        beginAllocJob();
+        uint64_t job_started = beginStatsJob(jobs[i].line);
+        uint8_t* eprom_data = (uint8_t*)allocArena(&arena, EPROM_SIZE);
+        uint8_t* bitmap_data = (uint8_t*)allocArena(&arena, PIXELS_PER_LINE * TEXT_BITMAP_HEIGHT);
+        if (!eprom_data || !bitmap_data) {
+            perror("Error allocating memory for batch buffers");
+        } else if (!writer) {
+            status[i] = runJob(&jobs[i], eprom_data, bitmap_data, options, &arena);
+        } else if (generateImage(jobs[i].id_text, eprom_data, jobs[i].debug ? bitmap_data : NULL)) {
+            status[i] = queueJobOutputs(&jobs[i], i, eprom_data, bitmap_data, options, writer, &arena);
+            flushJobOutputs(writer, status, false);
+        }
+        resetArena(&arena);
+        endStatsJob(STATS_JOB, job_started);
+        endAllocJob();
+    }
+
+    freeArena(&arena);
+}
+
+/*
+ Multithreaded path.
+
+ Generator workers each own a deque of job indexes, initially an even share
+ of the manifest. A worker takes jobs from the front of its own deque and,
+ when that runs dry, steals the back half of another worker's deque. Each
+ generated image is placed in a slot from a bounded pool and queued for the
+ writer stage (the calling thread), which does all file I/O. The pool size
+ bounds memory, generation and writing overlap.
+
+ Every output file depends only on its own job, and the summary is printed
+ in manifest order, so results are the same for any number of threads.
+ */
+
+typedef struct {
+    pthread_mutex_t lock;
+    int head;                       // Next job for the owner
+    int tail;                       // One past the last job, thieves take from here
+} JobDeque;
+
+typedef struct {
+    int job;
+    bool ok;
+    uint8_t eprom[EPROM_SIZE];
+    uint8_t bitmap[PIXELS_PER_LINE * TEXT_BITMAP_HEIGHT];
+} ImageSlot;
+
+typedef struct BatchPool BatchPool;
+
+typedef struct {
+    BatchPool* pool;
+    int index;
+    pthread_t thread;
+    uint8_t bitmap[PIXELS_PER_LINE * TEXT_BITMAP_HEIGHT];  // Per worker scratch text bitmap
+} Worker;
+
+struct BatchPool {
+    const BatchJob* jobs;
+    const BatchOptions* options;
+    bool* status;
+    int threads;
+    JobDeque* deques;
+    Worker* workers;
+
+    // Bounded slot pool, free stack and ready FIFO share one lock.
+    pthread_mutex_t lock;
+    pthread_cond_t slot_free;
+    pthread_cond_t slot_ready;
+    ImageSlot* slots;
+    int num_slots;
+    int* free_stack;
+    int free_count;
+    int* ready_fifo;
+    int ready_head;
+    int ready_count;
+};
+
+// Take the next job from our own deque, -1 if empty.
+static int popOwnJob(JobDeque* deque) {
+    int job = -1;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head < deque->tail) {
+        job = deque->head++;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return job;
+}
+
+// Steal the back half of another worker's deque into ours, -1 if all empty.
+static int stealJobs(BatchPool* pool, int self) {
+    for (int i = 1; i < pool->threads; i++) {
+        JobDeque* victim = &pool->deques[(self + i) % pool->threads];
+        int lo = 0;
+        int hi = 0;
+
+        pthread_mutex_lock(&victim->lock);
+        int remaining = victim->tail - victim->head;
+        if (remaining > 0) {
+            hi = victim->tail;
+            lo = hi - (remaining + 1) / 2;
+            victim->tail = lo;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if (hi > lo) {
+            JobDeque* own = &pool->deques[self];
+            pthread_mutex_lock(&own->lock);
+            own->head = lo + 1;
+            own->tail = hi;
+            pthread_mutex_unlock(&own->lock);
+            return lo;
+        }
+    }
+    return -1;
+}
+
+static void* workerMain(void* arg) {
+    Worker* worker = (Worker*)arg;
+    BatchPool* pool = worker->pool;
+
+    for (;;) {
+        int job = popOwnJob(&pool->deques[worker->index]);
+        if (job < 0) {
+            job = stealJobs(pool, worker->index);
+        }
+        if (job < 0) {
+            break;
+        }
+        if (!pool->jobs[job].valid || pool->jobs[job].current) {
+            continue;
+        }
+
+        // Wait for a free slot.
+        pthread_mutex_lock(&pool->lock);
+        while (pool->free_count == 0) {
+            pthread_cond_wait(&pool->slot_free, &pool->lock);
+        }
+        int slot_index = pool->free_stack[--pool->free_count];
+        pthread_mutex_unlock(&pool->lock);
+
+        beginAllocJob();
+        uint64_t job_started = beginStatsJob(pool->jobs[job].line);
+        ImageSlot* slot = &pool->slots[slot_index];
+        slot->job = job;
+        slot->ok = generateImage(pool->jobs[job].id_text, slot->eprom,
+                                 pool->jobs[job].debug ? worker->bitmap : NULL);
+        if (slot->ok && pool->jobs[job].debug) {
+            memcpy(slot->bitmap, worker->bitmap, sizeof(slot->bitmap));
+        }
+        endStatsJob(STATS_GENERATE, job_started);
+        endAllocJob();
+
+        // Hand it to the writer.
+        pthread_mutex_lock(&pool->lock);
+        pool->ready_fifo[(pool->ready_head + pool->ready_count) % pool->num_slots] = slot_index;
+        pool->ready_count++;
+        pthread_cond_signal(&pool->slot_ready);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    return NULL;
+}
+
+static void runParallel(const BatchJob* jobs, int count, int threads, const BatchOptions* options, bool* status,
+                        FileWriter* writer) {
+    BatchPool pool;
+    Arena arena;                    // Writer stage outputs, reset after each job
+    memset(&pool, 0, sizeof(pool));
+    memset(&arena, 0, sizeof(arena));
+
+    int expected = 0;
+    for (int i = 0; i < count; i++) {
+        expected += jobs[i].valid && !jobs[i].current;
+    }
+
+    pool.jobs = jobs;
+    pool.options = options;
+    pool.status = status;
+    pool.threads = threads;
+    pool.num_slots = threads * 2 + 2;
+    pool.deques = (JobDeque*)calloc(threads, sizeof(JobDeque));
+    pool.workers = (Worker*)calloc(threads, sizeof(Worker));
+    pool.slots = (ImageSlot*)calloc(pool.num_slots, sizeof(ImageSlot));
+    pool.free_stack = (int*)calloc(pool.num_slots, sizeof(int));
+    pool.ready_fifo = (int*)calloc(pool.num_slots, sizeof(int));
+    if (!pool.deques || !pool.workers || !pool.slots || !pool.free_stack || !pool.ready_fifo ||
+        !initArena(&arena, JOB_ARENA_SIZE)) {
+        perror("Error allocating memory for batch workers");
+        goto cleanup;
+    }
+
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.slot_free, NULL);
+    pthread_cond_init(&pool.slot_ready, NULL);
+    for (int i = 0; i < pool.num_slots; i++) {
+        pool.free_stack[pool.free_count++] = i;
+    }
+
+    // Even share of the manifest for each worker to start with.
+    for (int t = 0; t < threads; t++) {
+        pthread_mutex_init(&pool.deques[t].lock, NULL);
+        pool.deques[t].head = (int)((long long)count * t / threads);
+        pool.deques[t].tail = (int)((long long)count * (t + 1) / threads);
+    }
+
+    int started = 0;
+    for (int t = 0; t < threads; t++) {
+        pool.workers[t].pool = &pool;
+        pool.workers[t].index = t;
+        if (pthread_create(&pool.workers[t].thread, NULL, workerMain, &pool.workers[t]) != 0) {
+            fprintf(stderr, "Error: Could not start worker thread %d\n", t);
+            break;
+        }
+        started++;
+    }
+
+    // Workers that failed to start leave their share to be stolen.
+    if (started > 0) {
+        // Writer stage, all file output happens on this thread.
+        for (int written = 0; written < expected; written++) {
+            pthread_mutex_lock(&pool.lock);
+            while (pool.ready_count == 0) {
+                pthread_cond_wait(&pool.slot_ready, &pool.lock);
+            }
+            int slot_index = pool.ready_fifo[pool.ready_head];
+            pool.ready_head = (pool.ready_head + 1) % pool.num_slots;
+            pool.ready_count--;
+            pthread_mutex_unlock(&pool.lock);
+
+            beginAllocJob();
+            ImageSlot* slot = &pool.slots[slot_index];
+            const BatchJob* job = &jobs[slot->job];
+            uint64_t job_started = beginStatsJob(job->line);
+            if (!slot->ok) {
+                fprintf(stderr, "Error: Pattern generation failed\n");
+            }
+            if (!writer) {
+                status[slot->job] = slot->ok && writeJobOutputs(job, slot->eprom, slot->bitmap, options, &arena);
+            } else {
+                status[slot->job] = slot->ok && queueJobOutputs(job, slot->job, slot->eprom, slot->bitmap,
+                                                                options, writer, &arena);
+            }
+            resetArena(&arena);
+
+            pthread_mutex_lock(&pool.lock);
+            pool.free_stack[pool.free_count++] = slot_index;
+            pthread_cond_signal(&pool.slot_free);
+            pthread_mutex_unlock(&pool.lock);
+
+            if (writer) {
+                flushJobOutputs(writer, status, false);
+            }
+            endStatsJob(STATS_JOB, job_started);
+            endAllocJob();
+        }
+    }
+
+    for (int t = 0; t < started; t++) {
+        pthread_join(pool.workers[t].thread, NULL);
+    }
+
+    for (int t = 0; t < threads; t++) {
+        pthread_mutex_destroy(&pool.deques[t].lock);
+    }
+    pthread_cond_destroy(&pool.slot_ready);
+    pthread_cond_destroy(&pool.slot_free);
+    pthread_mutex_destroy(&pool.lock);
+
+cleanup:
+    freeArena(&arena);
+    free(pool.ready_fifo);
+    free(pool.free_stack);
+    free(pool.slots);
+    free(pool.workers);
+    free(pool.deques);
+}
+
+// Number of online processors, used for -j 0.
+int getProcessorCount(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#else
+    return 1;
+#endif
+}
+
+// Run every job in a manifest file in this process, on one thread reusing
+// one set of buffers or spread over a pool of generator threads.
+int runManifest(const char* manifest_file, const BatchOptions* options) {
+    int count = 0;
+    BatchJob* jobs = loadManifest(manifest_file, &count);
+    if (!jobs) {
+        return 0;
+    }
+
+    bool* status = (bool*)calloc(count ? count : 1, sizeof(bool));
+    if (!status) {
+        perror("Error allocating memory for batch status");
+        free(jobs);
+        return 0;
+    }
+
+    // Up to date jobs are left out of generation and writing altogether.
+    int current = 0;
+    for (int i = 0; i < count; i++) {
+        jobs[i].current = status[i] = isJobCurrent(&jobs[i], options);
+        current += jobs[i].current;
+    }
+
+    // Room in the index for every output up front, so it is not grown part
+    // way through the run.
+    if (options->index) {
+        int outputs = 0;
+        EncoderList formats;
+        for (int i = 0; i < count; i++) {
+            if (jobs[i].valid && !jobs[i].current && getJobFormats(&jobs[i], options, &formats)) {
+                outputs += formats.count + 2;
+            }
+        }
+        if (!reserveOutputIndex(options->index, outputs)) {
+            perror("Error allocating memory for output index");
+            free(status);
+            free(jobs);
+            return 0;
+        }
+    }
+
+    int threads = options->threads;
+    if (threads <= 0) {
+        threads = getProcessorCount();
+    }
+    if (threads > count) {
+        threads = count > 0 ? count : 1;
+    }
+
+    FileWriter file_writer;
+    FileWriter* writer = NULL;
+    if (options->writer != WRITER_STDIO) {
+        if (!initFileWriter(&file_writer, options->writer, options->fsync)) {
+            free(status);
+            free(jobs);
+            return 0;
+        }
+        writer = &file_writer;
+    }
+
+    // Per file progress is replaced by one summary line per job.
+    bool was_quiet = quiet_enabled;
+    quiet_enabled = true;
+
+    double start = nowSeconds();
+    if (threads <= 1) {
+        runSequential(jobs, count, options, status, writer);
+    } else {
+        runParallel(jobs, count, threads, options, status, writer);
+    }
+    if (writer) {
+        flushJobOutputs(writer, status, true);
+    }
+    double elapsed = nowSeconds() - start;
+    quiet_enabled = was_quiet;
+
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        if (!jobs[i].valid) {
+            printf("%5d  FAIL  line %d: invalid manifest entry\n", i + 1, jobs[i].line);
+        } else {
+            printf("%5d  %-4s  %-14s  %s\n", i + 1, jobs[i].current ? "SAME" : status[i] ? "OK" : "FAIL",
+                   jobs[i].id_text, jobs[i].output_file);
+        }
+        failed += !status[i];
+    }
+
+    int done = count - failed;
+    printf("\nBatch complete: %d jobs, %d ok, %d failed in %.3f s", count, done, failed, elapsed);
+    if (elapsed > 0.0) {
+        printf(" (%.1f images/s)", (done - current) / elapsed);
+    }
+    if (threads > 1) {
+        printf(" on %d threads", threads);
+    }
+    printf("\n");
+    if (writer) {
+        printf("Writer: %s, %d batches, %d files, %llu bytes, %ld syscalls\n",
+               getWriterName(writer->backend), writer->batches, writer->total.files,
+               (unsigned long long)writer->total.bytes, writer->total.syscalls);
+        freeFileWriter(writer);
+    }
+    if (options->index) {
+        printf("Incremental: %d jobs up to date, %d files written, %d regenerated unchanged\n",
+               current, options->index->written, options->index->unchanged);
+    }
+    printAllocSummary();
+
+    free(status);
+    free(jobs);
+    return failed == 0;
+}
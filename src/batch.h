@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ batch.h  include for batch.c
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "patterns.h"
+#include "output.h"
+#include "incremental.h"
+#include "writer.h"
+#include "encoder.h"
+#include "arena.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Longest manifest line accepted
+#define MANIFEST_LINE_MAX  1024
+
+// One manifest row: ID text, output stem and per row options
+typedef struct {
+    int  line;                              // Manifest line number (for messages)
+    bool valid;                             // Row parsed and validated
+    char id_text[MAX_TEXT_LENGTH + 1];
+    char output_file[OUTPUT_PATH_MAX];
+    bool debug;                             // "debug"   - also write .dump and _id.txt
+    bool label;                             // "nolabel" - skip _eprom_label.html
+    bool current;                           // --incremental: outputs already up to date
+    uint64_t key;                           // --incremental: input key of the outputs
+} BatchJob;
+
+// Options shared by every job of a run
+typedef struct {
+    int        threads;                     // Generator threads, 0 = one per CPU
+    HexOptions hex;                         // Intel HEX record options
+    EncoderList formats;                    // -f image formats, ENCODER_DEFAULT when empty
+    OutputIndex* index;                     // --incremental output index, NULL otherwise
+    WriterBackend writer;                   // --writer, how outputs reach the disk
+    bool       fsync;                       // --fsync, batched writers sync every file
+} BatchOptions;
+
+// Manifest functions
+int parseManifestLine(const char* line, int line_no, BatchJob* job);
+int writeJobOutputs(const BatchJob* job, const uint8_t* eprom_data, const uint8_t* bitmap_data,
+                    const BatchOptions* options, Arena* arena);
+int runJob(const BatchJob* job, uint8_t* eprom_data, uint8_t* bitmap_data, const BatchOptions* options,
+           Arena* arena);
+int runManifest(const char* manifest_file, const BatchOptions* options);
+bool isJobCurrent(BatchJob* job, const BatchOptions* options);
+int getProcessorCount(void);
+
+#endif // BATCH_H
@@ -0,0 +1,512 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ bench.c  tcbench, times the generation and output paths of tcgen over a
+          corpus of random valid IDs (make bench).
+
+ Each benchmark runs over the whole corpus once per trial, after the
+ warm-up trials. A trial gives one ns/op figure, min and percentiles are
+ taken over the trials. The file writers go to a scratch directory, tmpfs
+ (/dev/shm) by default, so the disk is not what is measured.
+
+ Results are printed as a table, --json writes them for CI, and
+ --baseline compares the p50 of each benchmark against an earlier --json
+ file and fails when one is slower by more than --threshold percent.
+ */
+
+#include "patterns.h"
+#include "output.h"
+#include "encoder.h"
+#include "version.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <unistd.h>
+
+// tcbench does not link tcgen.c, the output functions only need quiet set.
+bool debug_enabled = false;
+bool quiet_enabled = true;
+
+#define BENCH_DEFAULT_IDS       1000
+#define BENCH_DEFAULT_TRIALS    20
+#define BENCH_DEFAULT_WARMUP    2
+#define BENCH_DEFAULT_SEED      1
+#define BENCH_DEFAULT_THRESHOLD 10.0    // Percent slower than baseline p50 that fails
+
+// Upper case characters a valid ID may use (see pt430ValidateText)
+static const char id_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 -:";
+
+typedef struct {
+    int       count;                    // IDs in the corpus
+    char    (*ids)[MAX_TEXT_LENGTH + 1];
+    uint8_t*  images;                   // count x EPROM_SIZE, generated from ids
+    uint8_t   bitmap[TEXT_BITMAP_WIDTH * TEXT_BITMAP_HEIGHT];
+    uint8_t   image[EPROM_SIZE];
+    char*     hex;                      // encodeHexImage output
+    size_t    hex_size;
+    OutputBuffer dump;
+    char      hex_file[OUTPUT_PATH_MAX];
+    char      bin_file[OUTPUT_PATH_MAX];
+    char      dump_file[OUTPUT_PATH_MAX];
+} BenchContext;
+
+// One operation on corpus entry index, returns the bytes it produced, 0 on error.
+typedef size_t (*BenchFunc)(BenchContext* ctx, int index);
+
+typedef struct {
+    const char* name;
+    const char* description;
+    BenchFunc   run;
+} Benchmark;
+
+typedef struct {
+    const char* name;
+    long   ops;
+    double mean;                        // ns/op
+    double min;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+    double bytes;                       // Bytes produced per op
+    double images;                      // Per second, from the mean
+    double mbytes;                      // MB per second, from the mean
+} BenchResult;
+
+// Monotonic time in nanoseconds.
+static double nowNanoseconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// xorshift64*, the corpus is the same for the same --seed.
+static uint64_t nextRandom(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+// Benchmarks
+
+static size_t benchTextBitmap(BenchContext* ctx, int index) {
+    generateTextBitmap(ctx->ids[index], ctx->bitmap);
+    return sizeof(ctx->bitmap);
+}
+
+static size_t benchEpromData(BenchContext* ctx, int index) {
+    return generateEpromData(ctx->image, NULL, ctx->ids[index]) ? EPROM_SIZE : 0;
+}
+
+static size_t benchHexEncode(BenchContext* ctx, int index) {
+    return encodeHexImage(ctx->images + (size_t)index * EPROM_SIZE, EPROM_SIZE, NULL, ctx->hex, ctx->hex_size);
+}
+
+static size_t benchDumpFormat(BenchContext* ctx, int index) {
+    ctx->dump.length = 0;
+    return formatRawHexDump(ctx->images + (size_t)index * EPROM_SIZE, EPROM_SIZE, &ctx->dump) ? ctx->dump.length : 0;
+}
+
+static size_t benchHexWrite(BenchContext* ctx, int index) {
+    return writeHexFile(ctx->images + (size_t)index * EPROM_SIZE, EPROM_SIZE, ctx->hex_file) ? ctx->hex_size : 0;
+}
+
+static size_t benchBinWrite(BenchContext* ctx, int index) {
+    return writeBinFile(ctx->images + (size_t)index * EPROM_SIZE, EPROM_SIZE, ctx->bin_file) ? EPROM_SIZE : 0;
+}
+
+static size_t benchDumpWrite(BenchContext* ctx, int index) {
+    return writeRawHexFile(ctx->images + (size_t)index * EPROM_SIZE, EPROM_SIZE, ctx->dump_file) ? ctx->dump.length : 0;
+}
+
+static const Benchmark benchmarks[] = {
+    { "text_bitmap", "generateTextBitmap, ID to 128x7 byte bitmap",     benchTextBitmap },
+    { "eprom_data",  "generateEpromData, ID to 8K image",               benchEpromData },
+    { "hex_encode",  "encodeHexImage, 8K image to Intel HEX in memory", benchHexEncode },
+    { "dump_format", "formatRawHexDump, 8K image to dump in memory",    benchDumpFormat },
+    { "hex_write",   "writeHexFile to the scratch directory",           benchHexWrite },
+    { "bin_write",   "writeBinFile to the scratch directory",           benchBinWrite },
+    { "dump_write",  "writeRawHexFile to the scratch directory",        benchDumpWrite },
+};
+
+#define NUM_BENCHMARKS  ((int)(sizeof(benchmarks) / sizeof(benchmarks[0])))
+
+// Set up the corpus, its images and the scratch file names.
+static int initBenchContext(BenchContext* ctx, int count, uint64_t seed, const char* dir) {
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->count = count;
+    ctx->ids = calloc((size_t)count, sizeof(*ctx->ids));
+    ctx->images = malloc((size_t)count * EPROM_SIZE);
+    ctx->hex_size = getHexEncodedSize(EPROM_SIZE, NULL);
+    ctx->hex = malloc(ctx->hex_size);
+    if (!ctx->ids || !ctx->images || !ctx->hex) {
+        fprintf(stderr, "Error: Could not allocate the benchmark corpus\n");
+        return 0;
+    }
+
+    // 1 to MAX_TEXT_LENGTH characters, no leading or trailing space, '-' or ':'.
+    uint64_t state = seed ? seed : BENCH_DEFAULT_SEED;
+    for (int i = 0; i < count; i++) {
+        int len = 1 + (int)(nextRandom(&state) % MAX_TEXT_LENGTH);
+        for (int c = 0; c < len; c++) {
+            int range = (int)sizeof(id_chars) - 1 - ((c == 0 || c == len - 1) ? 3 : 0);
+            ctx->ids[i][c] = id_chars[nextRandom(&state) % range];
+        }
+        ctx->ids[i][len] = '\0';
+        generateEpromData(ctx->images + (size_t)i * EPROM_SIZE, NULL, ctx->ids[i]);
+    }
+
+    if (!formatRawHexDump(ctx->images, EPROM_SIZE, &ctx->dump)) {
+        fprintf(stderr, "Error: Could not allocate the dump buffer\n");
+        return 0;
+    }
+
+    long pid = (long)getpid();
+    snprintf(ctx->hex_file, sizeof(ctx->hex_file), "%s/tcbench%ld.hex", dir, pid);
+    snprintf(ctx->bin_file, sizeof(ctx->bin_file), "%s/tcbench%ld.bin", dir, pid);
+    snprintf(ctx->dump_file, sizeof(ctx->dump_file), "%s/tcbench%ld.dump", dir, pid);
+    return 1;
+}
+
+static void freeBenchContext(BenchContext* ctx) {
+    if (ctx->hex_file[0]) {
+        remove(ctx->hex_file);
+        remove(ctx->bin_file);
+        remove(ctx->dump_file);
+    }
+    free(ctx->ids);
+    free(ctx->images);
+    free(ctx->hex);
+    freeOutputBuffer(&ctx->dump);
+}
+
+static int compareDouble(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest rank percentile of sorted samples.
+static double getPercentile(const double* sorted, int count, double percent) {
+    int rank = (int)(percent / 100.0 * count + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1];
+}
+
+// Warm up, then time trials passes over the corpus.
+static int runBenchmark(const Benchmark* bench, BenchContext* ctx, int trials, int warmup, BenchResult* result) {
+    double* samples = malloc((size_t)trials * sizeof(double));
+    double bytes = 0, total = 0;
+
+    if (!samples) {
+        fprintf(stderr, "Error: Could not allocate the trial samples\n");
+        return 0;
+    }
+    for (int trial = -warmup; trial < trials; trial++) {
+        double start = nowNanoseconds();
+        size_t produced = 0;
+        for (int i = 0; i < ctx->count; i++) {
+            size_t size = bench->run(ctx, i);
+            if (size == 0) {
+                fprintf(stderr, "Error: Benchmark %s failed on ID \"%s\"\n", bench->name, ctx->ids[i]);
+                free(samples);
+                return 0;
+            }
+            produced += size;
+        }
+        double elapsed = nowNanoseconds() - start;
+        if (trial >= 0) {
+            samples[trial] = elapsed / ctx->count;
+            total += samples[trial];
+            bytes = (double)produced / ctx->count;
+        }
+    }
+
+    qsort(samples, (size_t)trials, sizeof(double), compareDouble);
+    memset(result, 0, sizeof(*result));
+    result->name = bench->name;
+    result->ops = (long)trials * ctx->count;
+    result->mean = total / trials;
+    result->min = samples[0];
+    result->p50 = getPercentile(samples, trials, 50);
+    result->p90 = getPercentile(samples, trials, 90);
+    result->p99 = getPercentile(samples, trials, 99);
+    result->max = samples[trials - 1];
+    result->bytes = bytes;
+    result->images = result->mean > 0 ? 1e9 / result->mean : 0;
+    result->mbytes = result->images * bytes / 1e6;
+    free(samples);
+    return 1;
+}
+
+static void printResults(FILE* fp, const BenchResult* results, int count) {
+    fprintf(fp, "%-12s %10s %10s %10s %10s %10s %12s %10s\n",
+            "benchmark", "ns/op", "min", "p50", "p90", "p99", "images/s", "MB/s");
+    for (int i = 0; i < count; i++) {
+        const BenchResult* r = &results[i];
+        fprintf(fp, "%-12s %10.1f %10.1f %10.1f %10.1f %10.1f %12.0f %10.1f\n",
+                r->name, r->mean, r->min, r->p50, r->p90, r->p99, r->images, r->mbytes);
+    }
+}
+
+// JSON results, "-" is stdout.
+static int writeResultsJson(const char* filename, const BenchResult* results, int count,
+                            int ids, int trials, int warmup, unsigned long long seed) {
+    FILE* fp = strcmp(filename, "-") == 0 ? stdout : fopen(filename, "w");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open file %s for writing\n", filename);
+        return 0;
+    }
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"tool\": \"tcbench\",\n");
+    fprintf(fp, "  \"version\": \"%s\",\n", VERSION_STRING);
+    fprintf(fp, "  \"ids\": %d,\n", ids);
+    fprintf(fp, "  \"trials\": %d,\n", trials);
+    fprintf(fp, "  \"warmup\": %d,\n", warmup);
+    fprintf(fp, "  \"seed\": %llu,\n", seed);
+    fprintf(fp, "  \"results\": [\n");
+    for (int i = 0; i < count; i++) {
+        const BenchResult* r = &results[i];
+        fprintf(fp, "    { \"name\": \"%s\", \"ops\": %ld, \"ns_per_op\": %.1f, \"min_ns\": %.1f, "
+                    "\"p50_ns\": %.1f, \"p90_ns\": %.1f, \"p99_ns\": %.1f, \"max_ns\": %.1f, "
+                    "\"bytes_per_op\": %.0f, \"images_per_s\": %.0f, \"mb_per_s\": %.1f }%s\n",
+                r->name, r->ops, r->mean, r->min, r->p50, r->p90, r->p99, r->max,
+                r->bytes, r->images, r->mbytes, i < count - 1 ? "," : "");
+    }
+    fprintf(fp, "  ]\n");
+    fprintf(fp, "}\n");
+
+    if (fp != stdout && fclose(fp) != 0) {
+        fprintf(stderr, "Error: Could not write file %s\n", filename);
+        return 0;
+    }
+    return 1;
+}
+
+// p50 of benchmark name in a --json file, -1 when it is not there.
+static double getBaselineP50(const char* json, const char* name) {
+    char key[64];
+    snprintf(key, sizeof(key), "\"name\": \"%s\"", name);
+
+    const char* entry = strstr(json, key);
+    if (!entry) {
+        return -1;
+    }
+    const char* end = strchr(entry, '}');
+    const char* p50 = strstr(entry, "\"p50_ns\":");
+    double value;
+    if (!p50 || (end && p50 > end) || sscanf(p50 + 9, "%lf", &value) != 1) {
+        return -1;
+    }
+    return value;
+}
+
+// Compare p50 against the baseline file, returns the number of regressions
+// or -1 when the baseline can't be read.
+static int compareBaseline(FILE* out, const char* filename, const BenchResult* results, int count, double threshold) {
+    FILE* fp = fopen(filename, "rb");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open baseline %s\n", filename);
+        return -1;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char* json = size > 0 ? malloc((size_t)size + 1) : NULL;
+    if (!json || fread(json, 1, (size_t)size, fp) != (size_t)size) {
+        fprintf(stderr, "Error: Could not read baseline %s\n", filename);
+        free(json);
+        fclose(fp);
+        return -1;
+    }
+    json[size] = '\0';
+    fclose(fp);
+
+    int regressions = 0;
+    fprintf(out, "\nBaseline %s (p50, fails above +%.1f%%):\n", filename, threshold);
+    fprintf(out, "%-12s %10s %10s %9s\n", "benchmark", "baseline", "current", "change");
+    for (int i = 0; i < count; i++) {
+        const BenchResult* r = &results[i];
+        double base = getBaselineP50(json, r->name);
+        if (base <= 0) {
+            fprintf(out, "%-12s %10s %10.1f %9s  new\n", r->name, "-", r->p50, "-");
+            continue;
+        }
+        double change = (r->p50 - base) / base * 100.0;
+        int slower = change > threshold;
+        regressions += slower;
+        fprintf(out, "%-12s %10.1f %10.1f %+8.1f%%  %s\n", r->name, base, r->p50, change, slower ? "REGRESSION" : "ok");
+    }
+    free(json);
+    return regressions;
+}
+
+static void printBenchUsage(const char* progname) {
+    fprintf(stderr, "tcbench v%s - PT-430 EPROM generator benchmarks\n", VERSION_STRING);
+    fprintf(stderr, "Usage: %s [options]\n", progname);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -n, --ids <n>        IDs in the random corpus (default %d)\n", BENCH_DEFAULT_IDS);
+    fprintf(stderr, "  -t, --trials <n>     Timed passes over the corpus (default %d)\n", BENCH_DEFAULT_TRIALS);
+    fprintf(stderr, "  -w, --warmup <n>     Untimed passes first (default %d)\n", BENCH_DEFAULT_WARMUP);
+    fprintf(stderr, "  -s, --seed <n>       Corpus random seed (default %d)\n", BENCH_DEFAULT_SEED);
+    fprintf(stderr, "  -d, --dir <dir>      Scratch directory for the file writers\n");
+    fprintf(stderr, "  -b, --bench <list>   Comma separated benchmarks to run (default all)\n");
+    fprintf(stderr, "  -j, --json <file>    Write the results as JSON, - for stdout\n");
+    fprintf(stderr, "  -c, --baseline <f>   Compare p50 against an earlier --json file\n");
+    fprintf(stderr, "      --threshold <p>  Percent slower than baseline that fails (default %.0f)\n", BENCH_DEFAULT_THRESHOLD);
+    fprintf(stderr, "  -h, --help           Show this help\n");
+    fprintf(stderr, "\nBenchmarks:\n");
+    for (int i = 0; i < NUM_BENCHMARKS; i++) {
+        fprintf(stderr, "  %-12s %s\n", benchmarks[i].name, benchmarks[i].description);
+    }
+}
+
+// Is name in the comma separated list (NULL list selects everything).
+static int isSelected(const char* list, const char* name) {
+    if (!list) {
+        return 1;
+    }
+    size_t len = strlen(name);
+    for (const char* p = list; *p; ) {
+        const char* comma = strchr(p, ',');
+        size_t n = comma ? (size_t)(comma - p) : strlen(p);
+        if (n == len && strncmp(p, name, len) == 0) {
+            return 1;
+        }
+        p += n + (comma ? 1 : 0);
+    }
+    return 0;
+}
+
+// Default scratch directory, tmpfs when there is one.
+static const char* getScratchDir(void) {
+#ifdef _WIN32
+    const char* tmp = getenv("TEMP");
+    return tmp ? tmp : ".";
+#else
+    return access("/dev/shm", W_OK) == 0 ? "/dev/shm" : "/tmp";
+#endif
+}
+
+enum {
+    OPT_THRESHOLD = 256,
+};
+
+static const struct option bench_options[] = {
+    { "ids",        required_argument, NULL, 'n' },
+    { "trials",     required_argument, NULL, 't' },
+    { "warmup",     required_argument, NULL, 'w' },
+    { "seed",       required_argument, NULL, 's' },
+    { "dir",        required_argument, NULL, 'd' },
+    { "bench",      required_argument, NULL, 'b' },
+    { "json",       required_argument, NULL, 'j' },
+    { "baseline",   required_argument, NULL, 'c' },
+    { "threshold",  required_argument, NULL, OPT_THRESHOLD },
+    { "help",       no_argument,       NULL, 'h' },
+    { NULL,         0,                 NULL, 0 }
+};
+
+int main(int argc, char* argv[]) {
+    int ids = BENCH_DEFAULT_IDS;
+    int trials = BENCH_DEFAULT_TRIALS;
+    int warmup = BENCH_DEFAULT_WARMUP;
+    unsigned long long seed = BENCH_DEFAULT_SEED;
+    double threshold = BENCH_DEFAULT_THRESHOLD;
+    const char* dir = getScratchDir();
+    const char* selected = NULL;
+    const char* json_file = NULL;
+    const char* baseline_file = NULL;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "n:t:w:s:d:b:j:c:h", bench_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n': ids = atoi(optarg); break;
+            case 't': trials = atoi(optarg); break;
+            case 'w': warmup = atoi(optarg); break;
+            case 's': seed = strtoull(optarg, NULL, 0); break;
+            case 'd': dir = optarg; break;
+            case 'b': selected = optarg; break;
+            case 'j': json_file = optarg; break;
+            case 'c': baseline_file = optarg; break;
+            case OPT_THRESHOLD: threshold = atof(optarg); break;
+            case 'h':
+                printBenchUsage(argv[0]);
+                return 0;
+            default:
+                printBenchUsage(argv[0]);
+                return 1;
+        }
+    }
+    if (ids < 1 || trials < 1 || warmup < 0 || threshold < 0) {
+        fprintf(stderr, "Error: --ids and --trials must be at least 1, --warmup and --threshold not negative\n");
+        return 1;
+    }
+    int matches = 0;
+    for (int i = 0; i < NUM_BENCHMARKS; i++) {
+        matches += isSelected(selected, benchmarks[i].name);
+    }
+    if (matches == 0) {
+        fprintf(stderr, "Error: No benchmark matches '%s'\n", selected);
+        return 1;
+    }
+
+    BenchContext ctx;
+    if (!initBenchContext(&ctx, ids, seed, dir)) {
+        freeBenchContext(&ctx);
+        return 1;
+    }
+
+    // The table goes to stderr when the JSON is on stdout.
+    FILE* info = (json_file && strcmp(json_file, "-") == 0) ? stderr : stdout;
+    fprintf(info, "tcbench v%s: %d IDs, %d trials, %d warm-up, seed %llu, scratch %s\n\n",
+            VERSION_STRING, ids, trials, warmup, seed, dir);
+
+    BenchResult results[NUM_BENCHMARKS];
+    int count = 0;
+    int ok = 1;
+    for (int i = 0; i < NUM_BENCHMARKS && ok; i++) {
+        if (isSelected(selected, benchmarks[i].name)) {
+            ok = runBenchmark(&benchmarks[i], &ctx, trials, warmup, &results[count]);
+            count += ok;
+        }
+    }
+    freeBenchContext(&ctx);
+    if (!ok) {
+        return 1;
+    }
+
+    printResults(info, results, count);
+    if (json_file && !writeResultsJson(json_file, results, count, ids, trials, warmup, seed)) {
+        return 1;
+    }
+    if (baseline_file) {
+        int regressions = compareBaseline(info, baseline_file, results, count, threshold);
+        if (regressions != 0) {
+            if (regressions > 0) {
+                fprintf(info, "\n%d benchmark%s slower than the baseline\n", regressions, regressions == 1 ? "" : "s");
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
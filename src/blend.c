@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ blend.c  text overlay kernel, puts COLOR_WHITE on a 128 pixel EPROM line
+          wherever the packed text mask (TextMask row) has a bit set and
+          keeps the background pixel elsewhere.
+
+ Kernels:
+   - scalar: 8 pixels per step with 64 bit words, any CPU.
+   - SSE2:   16 pixels per step, mask bits spread to bytes with AND/CMPEQ.
+   - AVX2:   32 pixels per step, mask bytes spread with PSHUFB.
+ The SIMD kernels are built with target attributes, so the program itself
+ needs no -m flags, and the best kernel the CPU supports is picked on first
+ use. checkBlendKernel() compares a kernel byte for byte with the per pixel
+ reference, tcgen --selftest reports it for each kernel.
+ */
+
+#include "blend.h"
+#include "patterns.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BLEND_X86 1
+#include <immintrin.h>
+#endif
+
+typedef void (*BlendRowFunc)(uint8_t* dst, const uint8_t* background, const uint64_t mask[2]);
+
+// Byte j holds bit j, compared against the mask byte copied to all 8 bytes.
+#define BIT_SELECT  0x8040201008040201ULL
+#define BYTE_COPY   0x0101010101010101ULL
+
+// Per pixel reference, the way the overlay was first written.
+static void blendRowReference(uint8_t* dst, const uint8_t* background, const uint64_t mask[2]) {
+    for (int pixel = 0; pixel < PIXELS_PER_LINE; pixel++) {
+        bool text = (mask[pixel / 64] >> (pixel % 64)) & 1;
+        dst[pixel] = text ? COLOR_WHITE : background[pixel];
+    }
+}
+
+// Eight bytes of 0xFF/0x00, in memory order, for the eight bits of a mask byte.
+static inline uint64_t spreadBits(uint64_t bits) {
+    uint64_t v = (bits * BYTE_COPY) & BIT_SELECT;
+    v = ((v + 0x7F7F7F7F7F7F7F7FULL) & 0x8080808080808080ULL) >> 7;
+    v *= 0xFF;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+static void blendRowScalar(uint8_t* dst, const uint8_t* background, const uint64_t mask[2]) {
+    const uint64_t white = COLOR_WHITE * BYTE_COPY;
+    for (int i = 0; i < PIXELS_PER_LINE / 8; i++) {
+        uint64_t pixels, select = spreadBits((mask[i / 8] >> ((i % 8) * 8)) & 0xFF);
+        memcpy(&pixels, background + i * 8, 8);
+        pixels = (pixels & ~select) | (white & select);
+        memcpy(dst + i * 8, &pixels, 8);
+    }
+}
+
+#ifdef BLEND_X86
+__attribute__((target("sse2")))
+static void blendRowSse2(uint8_t* dst, const uint8_t* background, const uint64_t mask[2]) {
+    const __m128i select = _mm_set1_epi64x((long long)BIT_SELECT);
+    const __m128i white = _mm_set1_epi8((char)COLOR_WHITE);
+    for (int i = 0; i < PIXELS_PER_LINE / 16; i++) {
+        uint64_t bits = mask[i / 4] >> ((i % 4) * 16);
+        __m128i m = _mm_set_epi64x((long long)(((bits >> 8) & 0xFF) * BYTE_COPY),
+                                   (long long)((bits & 0xFF) * BYTE_COPY));
+        m = _mm_cmpeq_epi8(_mm_and_si128(m, select), select);
+        __m128i pixels = _mm_loadu_si128((const __m128i*)(background + i * 16));
+        pixels = _mm_or_si128(_mm_and_si128(m, white), _mm_andnot_si128(m, pixels));
+        _mm_storeu_si128((__m128i*)(dst + i * 16), pixels);
+    }
+}
+
+__attribute__((target("avx2")))
+static void blendRowAvx2(uint8_t* dst, const uint8_t* background, const uint64_t mask[2]) {
+    // Mask byte k to pixels 8k-8k+7, PSHUFB works within each 128 bit lane
+    // and both lanes hold all four mask bytes.
+    const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const __m256i select = _mm256_set1_epi64x((long long)BIT_SELECT);
+    const __m256i white = _mm256_set1_epi8((char)COLOR_WHITE);
+    for (int i = 0; i < PIXELS_PER_LINE / 32; i++) {
+        uint32_t bits = (uint32_t)(mask[i / 2] >> ((i % 2) * 32));
+        __m256i m = _mm256_shuffle_epi8(_mm256_set1_epi32((int)bits), spread);
+        m = _mm256_cmpeq_epi8(_mm256_and_si256(m, select), select);
+        __m256i pixels = _mm256_loadu_si256((const __m256i*)(background + i * 32));
+        pixels = _mm256_blendv_epi8(pixels, white, m);
+        _mm256_storeu_si256((__m256i*)(dst + i * 32), pixels);
+    }
+}
+#endif
+
+static const BlendRowFunc blend_rows[NUM_BLEND_KERNELS] = {
+    blendRowScalar,
+#ifdef BLEND_X86
+    blendRowSse2,
+    blendRowAvx2,
+#else
+    NULL,
+    NULL,
+#endif
+};
+
+static const char* const blend_names[NUM_BLEND_KERNELS] = { "scalar", "sse2", "avx2" };
+
+// Selected kernel, -1 until first use. Worker threads may race to pick it,
+// they all pick the same one.
+static int blend_kernel = -1;
+
+bool isBlendKernelSupported(BlendKernel kernel) {
+    switch (kernel) {
+        case BLEND_SCALAR:
+            return true;
+#ifdef BLEND_X86
+        case BLEND_SSE2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse2");
+        case BLEND_AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+const char* getBlendKernelName(BlendKernel kernel) {
+    if (kernel < 0 || kernel >= NUM_BLEND_KERNELS) {
+        return "unknown";
+    }
+    return blend_names[kernel];
+}
+
+// Kernel in use, the widest one the CPU supports unless one was set.
+BlendKernel getBlendKernel(void) {
+    int kernel = __atomic_load_n(&blend_kernel, __ATOMIC_RELAXED);
+    if (kernel < 0) {
+        kernel = BLEND_SCALAR;
+        for (int k = NUM_BLEND_KERNELS - 1; k > BLEND_SCALAR; k--) {
+            if (isBlendKernelSupported((BlendKernel)k)) {
+                kernel = k;
+                break;
+            }
+        }
+        __atomic_store_n(&blend_kernel, kernel, __ATOMIC_RELAXED);
+    }
+    return (BlendKernel)kernel;
+}
+
+// Force a kernel, false if this CPU or build cannot run it.
+bool setBlendKernel(BlendKernel kernel) {
+    if (!isBlendKernelSupported(kernel)) {
+        return false;
+    }
+    __atomic_store_n(&blend_kernel, (int)kernel, __ATOMIC_RELAXED);
+    return true;
+}
+
+// COLOR_WHITE where the mask bit is set, background elsewhere, 128 pixels.
+// dst may be the background.
+void blendTextRow(uint8_t* dst, const uint8_t* background, const uint64_t mask[2]) {
+    blend_rows[getBlendKernel()](dst, background, mask);
+}
+
+// xorshift64, repeatable test data.
+static uint64_t nextRandom(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+// Check kernel, which must be supported, against the per pixel reference on
+// SELFTEST_ROWS random and edge case rows, then whole images against the
+// scalar kernel. The selected kernel is left as it was. Returns true if
+// every check passed.
+bool checkBlendKernel(BlendKernel kernel) {
+    static const char* const ids[] = {
+        "VK3DG GEELONG", "ABCDEFGHIJKLMN", "1", "IIIIIIIIIIIIII", "12:34-56 WWMM", "a b c",
+    };
+    BlendKernel selected = getBlendKernel();
+    uint8_t background[PIXELS_PER_LINE], expected[PIXELS_PER_LINE], actual[PIXELS_PER_LINE];
+    uint8_t reference_image[EPROM_SIZE], image[EPROM_SIZE];
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    bool ok = true;
+
+    for (int row = 0; row < SELFTEST_ROWS && ok; row++) {
+        uint64_t mask[2];
+        for (int i = 0; i < PIXELS_PER_LINE; i += 8) {
+            uint64_t r = nextRandom(&state);
+            memcpy(background + i, &r, 8);
+        }
+        // Empty, full and single pixel masks first, then random.
+        if (row == 0) {
+            mask[0] = mask[1] = 0;
+        } else if (row == 1) {
+            mask[0] = mask[1] = ~0ULL;
+        } else if (row < 2 + PIXELS_PER_LINE) {
+            int pixel = row - 2;
+            mask[0] = pixel < 64 ? 1ULL << pixel : 0;
+            mask[1] = pixel < 64 ? 0 : 1ULL << (pixel - 64);
+        } else {
+            mask[0] = nextRandom(&state);
+            mask[1] = nextRandom(&state);
+        }
+
+        blendRowReference(expected, background, mask);
+        blend_rows[kernel](actual, background, mask);
+        if (memcmp(expected, actual, PIXELS_PER_LINE) != 0) {
+            ok = false;
+        }
+        // In place, as generateEpromData uses it.
+        memcpy(actual, background, PIXELS_PER_LINE);
+        blend_rows[kernel](actual, actual, mask);
+        if (memcmp(expected, actual, PIXELS_PER_LINE) != 0) {
+            ok = false;
+        }
+    }
+
+    // Whole images through generateEpromData.
+    for (size_t i = 0; i < sizeof(ids) / sizeof(ids[0]) && ok; i++) {
+        setBlendKernel(BLEND_SCALAR);
+        generateEpromData(reference_image, NULL, ids[i]);
+        setBlendKernel(kernel);
+        generateEpromData(image, NULL, ids[i]);
+        if (memcmp(reference_image, image, EPROM_SIZE) != 0) {
+            ok = false;
+        }
+    }
+
+    setBlendKernel(selected);
+    return ok;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ blend.h  include for blend.c
+ */
+
+#ifndef BLEND_H
+#define BLEND_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SELFTEST_ROWS  100000      // Rows checkBlendKernel() blends per kernel
+
+// Text blend kernels
+typedef enum {
+    BLEND_SCALAR,                    // Portable, 8 pixels per step
+    BLEND_SSE2,                      // 16 pixels per step
+    BLEND_AVX2,                      // 32 pixels per step
+    NUM_BLEND_KERNELS
+} BlendKernel;
+
+// Text blend functions
+void blendTextRow(uint8_t* dst, const uint8_t* background, const uint64_t mask[2]);
+BlendKernel getBlendKernel(void);
+bool setBlendKernel(BlendKernel kernel);
+bool isBlendKernelSupported(BlendKernel kernel);
+const char* getBlendKernelName(BlendKernel kernel);
+bool checkBlendKernel(BlendKernel kernel);
+
+#endif // BLEND_H
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ compare.c  compares two EPROM images and groups the differences by the
+            pattern regions of patterns.h.
+
+ Equal data is skipped 16 bytes at a time with SSE2 (8 bytes at a time with
+ plain 64 bit words elsewhere), only blocks that differ are looked at byte
+ by byte.
+ */
+
+#include "compare.h"
+
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Record one differing byte.
+static void recordMismatch(CompareResult* result, uint32_t addr, uint8_t expected, uint8_t actual,
+                           MismatchCallback callback, void* context) {
+    int region = getRegionIndex(addr);
+    if (result->region_mismatches[region]++ == 0) {
+        result->region_first[region] = addr;
+    }
+    result->mismatches++;
+    if (callback) {
+        callback(addr, expected, actual, context);
+    }
+}
+
+// Compare two images, returns the number of differing bytes. Bytes past the
+// end of the shorter image are not counted, the sizes are in result.
+size_t compareImages(const uint8_t* expected, size_t size_expected,
+                     const uint8_t* actual, size_t size_actual,
+                     CompareResult* result, MismatchCallback callback, void* context) {
+    size_t length = size_expected < size_actual ? size_expected : size_actual;
+    size_t i = 0;
+
+    memset(result, 0, sizeof(*result));
+    result->compared = length;
+    result->size_expected = size_expected;
+    result->size_actual = size_actual;
+
+#ifdef __SSE2__
+    for (; i + 16 <= length; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(expected + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(actual + i));
+        unsigned diff = ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) & 0xFFFF;
+        while (diff) {
+            int bit = __builtin_ctz(diff);
+            recordMismatch(result, (uint32_t)(i + bit), expected[i + bit], actual[i + bit], callback, context);
+            diff &= diff - 1;
+        }
+    }
+#else
+    for (; i + 8 <= length; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, expected + i, 8);
+        memcpy(&b, actual + i, 8);
+        if (a != b) {
+            for (size_t j = i; j < i + 8; j++) {
+                if (expected[j] != actual[j]) {
+                    recordMismatch(result, (uint32_t)j, expected[j], actual[j], callback, context);
+                }
+            }
+        }
+    }
+#endif
+
+    for (; i < length; i++) {
+        if (expected[i] != actual[i]) {
+            recordMismatch(result, (uint32_t)i, expected[i], actual[i], callback, context);
+        }
+    }
+
+    return result->mismatches;
+}
+
+// Print mismatch counts per region.
+void printCompareReport(FILE* fp, const CompareResult* result) {
+    if (result->size_expected != result->size_actual) {
+        fprintf(fp, "  Size differs: expected %zu bytes, found %zu bytes (compared %zu)\n",
+                result->size_expected, result->size_actual, result->compared);
+    }
+    if (result->mismatches == 0) {
+        return;
+    }
+
+    fprintf(fp, "  %-36s %8s  %s\n", "Region", "Bytes", "First");
+    for (int region = 0; region < NUM_REGIONS; region++) {
+        if (result->region_mismatches[region]) {
+            fprintf(fp, "  %-36s %8zu  0x%04X\n", getRegionName(region),
+                    result->region_mismatches[region], result->region_first[region]);
+        }
+    }
+    fprintf(fp, "  %-36s %8zu\n", "Total", result->mismatches);
+}
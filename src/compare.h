@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ compare.h  include for compare.c
+ */
+
+#ifndef COMPARE_H
+#define COMPARE_H
+
+#include "patterns.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Called for each differing byte, in address order.
+typedef void (*MismatchCallback)(uint32_t addr, uint8_t expected, uint8_t actual, void* context);
+
+// Result of comparing two images
+typedef struct {
+    size_t   compared;                      // Bytes compared (shorter image)
+    size_t   size_expected;
+    size_t   size_actual;
+    size_t   mismatches;                    // Differing bytes
+    size_t   region_mismatches[NUM_REGIONS];
+    uint32_t region_first[NUM_REGIONS];     // First differing address per region
+} CompareResult;
+
+// Image comparison functions
+size_t compareImages(const uint8_t* expected, size_t size_expected,
+                     const uint8_t* actual, size_t size_actual,
+                     CompareResult* result, MismatchCallback callback, void* context);
+void printCompareReport(FILE* fp, const CompareResult* result);
+
+#endif // COMPARE_H
@@ -0,0 +1,339 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ cvbs.c  synthesises the PAL composite signal of a pattern sample by sample
+         at 4 x fsc (17.734475 MHz), as the SAA1043/SAA1044 and the RGB
+         encoder of the PT-430 would put it on the output.
+
+ Signal:
+   - 625 lines, 1135 samples per line, lines 313 and 625 have 1137 so a
+     frame is 709379 samples and the subcarrier keeps its 25 Hz offset.
+   - Broad and equalising pulses per BT.470 in lines 1-5, 311-318, 623-625.
+   - Sync -300 mV, blanking and black 0 mV, white 700 mV.
+   - Burst 300 mV p-p at 135/225 degrees, lines 7-309 and 320-622 (no
+     Bruch sequence, the burst blanking is the same in every field).
+   - Chroma U sin + V cos, V inverted on alternate lines (PAL switch).
+
+ At 4 x fsc the subcarrier is exactly four samples per cycle, so a sample
+ only needs the line content, the V-switch and the sample index modulo 4.
+ Each line shape is expanded into a table of level codes, the codes go
+ through a colour x phase lookup table, and the result for every V-switch
+ and start phase is kept. A frame is then a run of line copies.
+ */
+
+#include "cvbs.h"
+#include "render.h"
+#include "debug.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+// Line timing in samples at 4 x fsc
+#define SAMPLES_SYNC         83      // 4.7 us line sync
+#define SAMPLES_EQUALISING   42      // 2.35 us
+#define SAMPLES_BROAD        484     // 27.3 us
+#define SAMPLES_HALF_LINE    567     // Second half line pulse starts here
+#define SAMPLES_BURST_START  99      // 5.6 us after sync
+#define SAMPLES_BURST        40      // 10 cycles
+#define SAMPLES_ACTIVE_START 186     // 10.5 us
+#define SAMPLES_ACTIVE       922     // 52 us
+
+// Levels in volts
+#define LEVEL_SYNC           -0.300
+#define LEVEL_WHITE_V        0.700
+#define BURST_AMPLITUDE      0.150
+
+// Level codes, 0-15 are the EPROM data nibble.
+#define CODE_BLANK           16
+#define CODE_SYNC            17
+#define CODE_BURST           18
+#define NUM_CODES            19
+
+// Line templates, one per counter state plus the blanking interval shapes.
+enum {
+    TEMPLATE_ACTIVE = 0,                        // + counter state, 16 of them
+    TEMPLATE_BLANK = COUNTER_STATES,            // Sync and burst
+    TEMPLATE_BLANK_NO_BURST,
+    TEMPLATE_BROAD_BROAD,
+    TEMPLATE_BROAD_EQUALISING,
+    TEMPLATE_EQUALISING_EQUALISING,
+    TEMPLATE_EQUALISING_BROAD,
+    TEMPLATE_EQUALISING_NONE,                   // Line 318
+    TEMPLATE_ACTIVE_EQUALISING,                 // Line 623, half a line of picture
+    NUM_TEMPLATES
+};
+
+#define FIELD_2_START        313     // Frame line of the field 2 vertical reset
+#define V_SWITCHES           2
+#define PHASES               4
+
+// Template used for frame line 1-625.
+static int getLineTemplate(int line) {
+    if (line <= 2 || line == 314 || line == 315) return TEMPLATE_BROAD_BROAD;
+    if (line == 3) return TEMPLATE_BROAD_EQUALISING;
+    if (line == 4 || line == 5 || line == 311 || line == 312 ||
+        line == 316 || line == 317 || line >= 624) return TEMPLATE_EQUALISING_EQUALISING;
+    if (line == 313) return TEMPLATE_EQUALISING_BROAD;
+    if (line == 318) return TEMPLATE_EQUALISING_NONE;
+    if (line == 623) return TEMPLATE_ACTIVE_EQUALISING;
+
+    // The counters restart at each vertical reset, field 2 runs the same
+    // field line sequence as field 1.
+    int field_line = line < FIELD_2_START ? line : line - FIELD_2_START;
+    if (field_line >= FIELD_FIRST_ACTIVE && field_line < FIELD_FIRST_ACTIVE + FIELD_ACTIVE_LINES) {
+        return TEMPLATE_ACTIVE + getCounterState(field_line);
+    }
+    if ((line >= 7 && line <= 309) || (line >= 320 && line <= 622)) {
+        return TEMPLATE_BLANK;
+    }
+    return TEMPLATE_BLANK_NO_BURST;
+}
+
+static int getLineLength(int line) {
+    return (line == FIELD_2_START || line == FRAME_LINES) ? CVBS_LINE_MAX : CVBS_LINE_SAMPLES;
+}
+
+// Level code sequence of a template.
+static void buildLineCodes(int template, const uint8_t* pattern_data, uint8_t codes[CVBS_LINE_MAX]) {
+    memset(codes, CODE_BLANK, CVBS_LINE_MAX);
+
+    switch (template) {
+        case TEMPLATE_BROAD_BROAD:
+            memset(codes, CODE_SYNC, SAMPLES_BROAD);
+            memset(codes + SAMPLES_HALF_LINE, CODE_SYNC, SAMPLES_BROAD);
+            return;
+        case TEMPLATE_BROAD_EQUALISING:
+            memset(codes, CODE_SYNC, SAMPLES_BROAD);
+            memset(codes + SAMPLES_HALF_LINE, CODE_SYNC, SAMPLES_EQUALISING);
+            return;
+        case TEMPLATE_EQUALISING_EQUALISING:
+            memset(codes, CODE_SYNC, SAMPLES_EQUALISING);
+            memset(codes + SAMPLES_HALF_LINE, CODE_SYNC, SAMPLES_EQUALISING);
+            return;
+        case TEMPLATE_EQUALISING_BROAD:
+            memset(codes, CODE_SYNC, SAMPLES_EQUALISING);
+            memset(codes + SAMPLES_HALF_LINE, CODE_SYNC, SAMPLES_BROAD);
+            return;
+        case TEMPLATE_EQUALISING_NONE:
+            memset(codes, CODE_SYNC, SAMPLES_EQUALISING);
+            return;
+        default:
+            break;
+    }
+
+    // Lines with a normal line sync.
+    memset(codes, CODE_SYNC, SAMPLES_SYNC);
+    if (template == TEMPLATE_BLANK_NO_BURST) {
+        return;
+    }
+    memset(codes + SAMPLES_BURST_START, CODE_BURST, SAMPLES_BURST);
+    if (template == TEMPLATE_BLANK) {
+        return;
+    }
+
+    // 128 EPROM pixels across the active line.
+    const uint8_t* data = pattern_data + (template == TEMPLATE_ACTIVE_EQUALISING
+                                          ? COUNTER_LINE_16 : template - TEMPLATE_ACTIVE) * PIXELS_PER_LINE;
+    int active_end = template == TEMPLATE_ACTIVE_EQUALISING
+                     ? SAMPLES_HALF_LINE : SAMPLES_ACTIVE_START + SAMPLES_ACTIVE;
+    for (int i = SAMPLES_ACTIVE_START; i < active_end; i++) {
+        codes[i] = data[(i - SAMPLES_ACTIVE_START) * PIXELS_PER_LINE / SAMPLES_ACTIVE] & 0x0F;
+    }
+    if (template == TEMPLATE_ACTIVE_EQUALISING) {
+        memset(codes + SAMPLES_HALF_LINE, CODE_SYNC, SAMPLES_EQUALISING);
+    }
+}
+
+// Signal level in volts of every code at each of the four subcarrier phases,
+// V-switch +1 (v_sign 1) or -1.
+static void buildLevelTable(int v_sign, float table[NUM_CODES][PHASES]) {
+    // sin and cos of the subcarrier at sample phase 0-3
+    static const int sin_phase[PHASES] = { 0, 1, 0, -1 };
+    static const int cos_phase[PHASES] = { 1, 0, -1, 0 };
+
+    for (int code = 0; code < NUM_CODES; code++) {
+        double y = 0.0, u = 0.0, v = 0.0;
+        if (code < 16) {
+            uint8_t rgb[3];
+            nibbleToRgb((uint8_t)code, rgb);
+            double r = rgb[0] / 255.0, g = rgb[1] / 255.0, b = rgb[2] / 255.0;
+            double luma = 0.299 * r + 0.587 * g + 0.114 * b;
+            y = LEVEL_WHITE_V * luma;
+            u = LEVEL_WHITE_V * 0.493 * (b - luma);
+            v = LEVEL_WHITE_V * 0.877 * (r - luma);
+        } else if (code == CODE_SYNC) {
+            y = LEVEL_SYNC;
+        } else if (code == CODE_BURST) {
+            // 135 degrees, the PAL switch turns it to 225.
+            u = -BURST_AMPLITUDE * 0.70710678;
+            v =  BURST_AMPLITUDE * 0.70710678;
+        }
+        for (int k = 0; k < PHASES; k++) {
+            table[code][k] = (float)(y + u * sin_phase[k] + v_sign * v * cos_phase[k]);
+        }
+    }
+}
+
+static uint8_t* getLine(const CvbsSynth* synth, int template, int v_switch, int phase) {
+    size_t index = ((size_t)template * V_SWITCHES + v_switch) * PHASES + phase;
+    return synth->lines + index * CVBS_LINE_MAX * synth->sample_size;
+}
+
+// Render every template at both V-switch states and all four start phases.
+int initCvbs(CvbsSynth* synth, const uint8_t* image, int pattern, CvbsFormat format) {
+    float table[V_SWITCHES][NUM_CODES][PHASES];
+    uint8_t codes[CVBS_LINE_MAX];
+
+    if (!image || pattern < 0 || pattern >= NUM_PATTERNS) {
+        fprintf(stderr, "Error: Invalid composite synthesis request\n");
+        return 0;
+    }
+
+    memset(synth, 0, sizeof(*synth));
+    synth->format = format;
+    synth->sample_size = format == CVBS_FLOAT32 ? sizeof(float) : sizeof(int16_t);
+    synth->lines = (uint8_t*)malloc((size_t)NUM_TEMPLATES * V_SWITCHES * PHASES *
+                                    CVBS_LINE_MAX * synth->sample_size);
+    if (!synth->lines) {
+        perror("Error allocating memory for composite lines");
+        return 0;
+    }
+
+    buildLevelTable(1, table[0]);
+    buildLevelTable(-1, table[1]);
+
+    const uint8_t* pattern_data = image + pattern * PATTERN_SIZE;
+    for (int template = 0; template < NUM_TEMPLATES; template++) {
+        buildLineCodes(template, pattern_data, codes);
+        for (int s = 0; s < V_SWITCHES; s++) {
+            for (int phase = 0; phase < PHASES; phase++) {
+                void* line = getLine(synth, template, s, phase);
+                if (format == CVBS_FLOAT32) {
+                    float* out = (float*)line;
+                    for (int i = 0; i < CVBS_LINE_MAX; i++) {
+                        out[i] = table[s][codes[i]][(phase + i) & 3];
+                    }
+                } else {
+                    int16_t* out = (int16_t*)line;
+                    for (int i = 0; i < CVBS_LINE_MAX; i++) {
+                        double level = table[s][codes[i]][(phase + i) & 3] * CVBS_INT16_SCALE;
+                        out[i] = (int16_t)(level < 0 ? level - 0.5 : level + 0.5);
+                    }
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+// Next frame, CVBS_FRAME_SAMPLES samples into out. Subcarrier phase and
+// V-switch run on from the previous frame.
+size_t synthCvbsFrame(CvbsSynth* synth, void* out) {
+    uint8_t* p = (uint8_t*)out;
+    for (int line = 1; line <= FRAME_LINES; line++) {
+        int length = getLineLength(line);
+        const uint8_t* src = getLine(synth, getLineTemplate(line),
+                                     (int)(synth->line_count & 1), (int)(synth->sample & 3));
+        memcpy(p, src, length * synth->sample_size);
+        p += length * synth->sample_size;
+        synth->sample += length;
+        synth->line_count++;
+    }
+    return CVBS_FRAME_SAMPLES;
+}
+
+void freeCvbs(CvbsSynth* synth) {
+    free(synth->lines);
+    synth->lines = NULL;
+}
+
+// Sample format from the file extension: .f32 is float, .s16 and .raw int16.
+int getCvbsFormat(const char* filename, CvbsFormat* format) {
+    const char* ext = strrchr(filename, '.');
+    if (ext && strcasecmp(ext, ".f32") == 0) {
+        *format = CVBS_FLOAT32;
+        return 1;
+    }
+    if (ext && (strcasecmp(ext, ".s16") == 0 || strcasecmp(ext, ".raw") == 0)) {
+        *format = CVBS_INT16;
+        return 1;
+    }
+    fprintf(stderr, "Error: Unknown sample format for %s (use .s16, .raw or .f32)\n", filename);
+    return 0;
+}
+
+// Write seconds of composite signal for pattern (0-3) of image.
+int writeCvbsFile(const char* filename, const uint8_t* image, int pattern, double seconds) {
+    CvbsFormat format;
+    CvbsSynth synth;
+    struct timespec t0, t1;
+
+    if (!getCvbsFormat(filename, &format)) {
+        return 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (!initCvbs(&synth, image, pattern, format)) {
+        return 0;
+    }
+
+    uint8_t* frame = (uint8_t*)malloc((size_t)CVBS_FRAME_SAMPLES * synth.sample_size);
+    if (!frame) {
+        perror("Error allocating memory for composite frame");
+        freeCvbs(&synth);
+        return 0;
+    }
+    FILE* fp = fopen(filename, "wb");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open file %s for writing\n", filename);
+        free(frame);
+        freeCvbs(&synth);
+        return 0;
+    }
+
+    // Whole frames, the last one cut to length.
+    uint64_t total = (uint64_t)(seconds * CVBS_SAMPLE_RATE + 0.5);
+    uint64_t written = 0;
+    int ok = 1;
+    while (ok && written < total) {
+        size_t count = synthCvbsFrame(&synth, frame);
+        if (count > total - written) {
+            count = (size_t)(total - written);
+        }
+        ok = fwrite(frame, synth.sample_size, count, fp) == count;
+        written += count;
+    }
+    if (fclose(fp) != 0) {
+        ok = 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    free(frame);
+    freeCvbs(&synth);
+
+    if (!ok) {
+        fprintf(stderr, "Error: Failed writing composite samples to %s\n", filename);
+        return 0;
+    }
+    if (!quiet_enabled) {
+        double elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+        printf("CVBS written: %s (%llu samples, %.3f s of signal at %.6f MHz, %s) in %.3f s\n",
+               filename, (unsigned long long)total, total / CVBS_SAMPLE_RATE, CVBS_SAMPLE_RATE / 1e6,
+               format == CVBS_FLOAT32 ? "float32" : "int16", elapsed);
+    }
+    return 1;
+}
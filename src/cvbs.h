@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ cvbs.h  include for cvbs.c
+ */
+
+#ifndef CVBS_H
+#define CVBS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// PAL composite sampled at 4 x fsc
+#define CVBS_SAMPLE_RATE     17734475.0          // Hz, 4 x 4.43361875 MHz
+#define CVBS_LINE_SAMPLES    1135                // Samples per line
+#define CVBS_LINE_MAX        1137                // Lines 313 and 625 carry 2 more
+#define CVBS_FRAME_SAMPLES   709379              // 625 x 1135 + 4
+#define CVBS_INT16_SCALE     32767.0             // int16 counts per volt, +/-1 V full scale
+
+// Sample formats
+typedef enum {
+    CVBS_INT16,                      // Signed 16 bit, native endian
+    CVBS_FLOAT32,                    // Volts, native endian float
+} CvbsFormat;
+
+// Synthesiser state, every possible line is rendered once by initCvbs.
+typedef struct {
+    CvbsFormat format;
+    size_t   sample_size;
+    uint8_t* lines;                  // [template][V-switch][phase][CVBS_LINE_MAX]
+    uint64_t sample;                 // Samples produced, subcarrier phase
+    uint64_t line_count;             // Lines produced, V-switch
+} CvbsSynth;
+
+// Composite synthesis functions
+int initCvbs(CvbsSynth* synth, const uint8_t* image, int pattern, CvbsFormat format);
+size_t synthCvbsFrame(CvbsSynth* synth, void* out);
+void freeCvbs(CvbsSynth* synth);
+int getCvbsFormat(const char* filename, CvbsFormat* format);
+int writeCvbsFile(const char* filename, const uint8_t* image, int pattern, double seconds);
+
+#endif // CVBS_H
@@ -14,7 +14,7 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
- debug.h  global debug flag.
+ debug.h  global debug and quiet flags.
  */
 
 #ifndef DEBUG_H
@@ -26,4 +26,7 @@
 // global debug flag Declaration
 extern bool debug_enabled; 
 
+// global quiet flag Declaration, suppresses per-file progress output (batch mode)
+extern bool quiet_enabled;
+
 #endif
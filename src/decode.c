@@ -0,0 +1,630 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ decode.c  reads the station ID text back out of an EPROM dump
+           (tcgen --decode <file|dir>).
+
+ Text pixels are COLOR_WHITE over the colour bars of the TEXT_START rows.
+ Each pixel is voted over its six copies (3 patterns x 2 fields), and where
+ the bar underneath is itself white (pixels 16-31) the pixel is unknown.
+
+ The text is centred on its length, so each length 1-14 gives the first
+ cell. From there each cell's five columns are packed into a key (7 bits
+ a column, as in font_data) and looked up in a hash of the font_data
+ glyphs; a cell with unknown or damaged pixels takes the glyph closest on
+ its known pixels. 'I' and '1' are drawn narrow, their keys are the glyph
+ shifted a column left, and lower case 'i' is the full width 'I'. The
+ length whose text explains the known pixels best wins, the confidence is
+ the overlap of its pixels with the observed ones, reduced for cells no
+ glyph fits better than another. The text is then generated again, and
+ only an ID whose image is the dump byte for byte scores 100%.
+
+ Dumps from other generators place and space their text differently, so
+ the text is also read as runs of text columns, each matched wherever it
+ sits on its key with the blank left columns trimmed, and spaces taken
+ from the gaps. That reading is kept only when it explains more pixels.
+
+ A directory scan decodes every dump on -j threads (a .bin is mapped, not
+ read) and writes a CSV of file, ID, confidence and checksum, with the
+ number of other dumps carrying the same ID.
+ */
+
+#include "decode.h"
+#include "batch.h"
+#include "loader.h"
+#include "output.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define DECODE_CELL_WIDTH   CHAR_WIDTH
+#define DECODE_SLOTS        64              // Glyph hash slots, power of two
+#define CELL_KNOWN          ((1ULL << (7 * DECODE_CELL_WIDTH)) - 1)
+
+// Characters of font_data, in order. 'I' and '1' are keyed narrow, the
+// full width 'I' is added as 'i'.
+static const char font_chars[] = " ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-:";
+#define FONT_GLYPHS   ((int)sizeof(font_chars) - 1)
+#define DECODE_GLYPHS (FONT_GLYPHS + 1)
+
+typedef struct {
+    uint64_t key;                           // Five 7 bit columns, column 0 lowest
+    uint64_t trimmed;                       // key without its blank left columns
+    uint8_t  lead;                          // Blank left columns
+    char     c;
+    uint8_t  advance;
+} DecodeGlyph;
+
+static DecodeGlyph decode_glyphs[DECODE_GLYPHS];
+static uint8_t decode_slots[DECODE_SLOTS];  // Glyph + 1 by key, 0 is empty
+static uint8_t trimmed_slots[DECODE_SLOTS]; // Glyph + 1 by trimmed key
+static pthread_once_t decode_once = PTHREAD_ONCE_INIT;
+
+static int hashSlot(uint64_t key) {
+    return (int)((key * 0x9E3779B97F4A7C15ULL) >> 58) & (DECODE_SLOTS - 1);
+}
+
+// Glyph keys from font_data. 'I' and '1' are drawn narrow, a column left of
+// the cell, so those two are keyed shifted and advance 5. Lower case 'i' is
+// drawn from the full width 'I' glyph. Trimmed, it is the narrow 'I', so it
+// is left out of the trimmed keys and segment reading gives 'I'.
+static void initDecodeGlyphs(void) {
+    int count = 0;
+    for (int g = 0; g < FONT_GLYPHS; g++) {
+        char c = font_chars[g];
+        uint64_t key = 0;
+        for (int col = 0; col < DECODE_CELL_WIDTH; col++) {
+            key |= (uint64_t)(font_data[g * DECODE_CELL_WIDTH + col] & 0x7F) << (7 * col);
+        }
+        DecodeGlyph glyph = { key, key, 0, c, CHAR_WIDTH + TEXT_INTER_SPACE };
+        if (c == 'I') {
+            decode_glyphs[count++] = (DecodeGlyph){ key, 0, 0, 'i', CHAR_WIDTH + TEXT_INTER_SPACE };
+        }
+        if (c == 'I' || c == '1') {
+            glyph.key = key >> 7;
+            glyph.advance = CHAR_WIDTH;
+        }
+        glyph.trimmed = glyph.key;
+        while (glyph.trimmed && !(glyph.trimmed & 0x7F)) {
+            glyph.trimmed >>= 7;
+            glyph.lead++;
+        }
+        decode_glyphs[count++] = glyph;
+    }
+
+    for (int g = 0; g < count; g++) {
+        int slot = hashSlot(decode_glyphs[g].key);
+        while (decode_slots[slot]) {
+            slot = (slot + 1) & (DECODE_SLOTS - 1);
+        }
+        decode_slots[slot] = (uint8_t)(g + 1);
+
+        if (!decode_glyphs[g].trimmed) {
+            continue;                       // Space and 'i', never a segment
+        }
+        slot = hashSlot(decode_glyphs[g].trimmed);
+        while (trimmed_slots[slot]) {
+            slot = (slot + 1) & (DECODE_SLOTS - 1);
+        }
+        trimmed_slots[slot] = (uint8_t)(g + 1);
+    }
+}
+
+// Exact match of a fully known cell, by its key or its trimmed key. NULL if
+// no glyph has it.
+static const DecodeGlyph* findGlyph(uint64_t key, bool trimmed) {
+    const uint8_t* slots = trimmed ? trimmed_slots : decode_slots;
+    for (int slot = hashSlot(key); slots[slot]; slot = (slot + 1) & (DECODE_SLOTS - 1)) {
+        const DecodeGlyph* glyph = &decode_glyphs[slots[slot] - 1];
+        if ((trimmed ? glyph->trimmed : glyph->key) == key) {
+            return glyph;
+        }
+    }
+    return NULL;
+}
+
+// Glyph closest to key on the known pixels, *ties counts the other glyphs
+// just as close.
+static const DecodeGlyph* findNearestGlyph(uint64_t key, uint64_t key_known, bool trimmed, int* distance,
+                                           int* ties) {
+    const DecodeGlyph* best = NULL;
+    *distance = 36;
+    *ties = 0;
+    for (int g = 0; g < DECODE_GLYPHS; g++) {
+        const DecodeGlyph* glyph = &decode_glyphs[g];
+        if (trimmed && !glyph->trimmed) {
+            continue;                       // Space or 'i', never a segment
+        }
+        int d = __builtin_popcountll(((trimmed ? glyph->trimmed : glyph->key) ^ key) & key_known);
+        if (d < *distance) {
+            *distance = d;
+            best = glyph;
+            *ties = 0;
+        } else if (d == *distance) {
+            (*ties)++;
+        }
+    }
+    return best;
+}
+
+static bool getBit(const uint64_t row[2], int pixel) {
+    return pixel >= 0 && pixel < PIXELS_PER_LINE && ((row[pixel / 64] >> (pixel % 64)) & 1);
+}
+
+static void setBit(uint64_t row[2], int pixel) {
+    if (pixel >= 0 && pixel < PIXELS_PER_LINE) {
+        row[pixel / 64] |= 1ULL << (pixel % 64);
+    }
+}
+
+// Columns x to x + 4 of mask as a glyph key. Pixels off the line read known
+// and clear.
+static uint64_t getCellKey(const TextMask* mask, int x, bool off_line) {
+    uint64_t key = 0;
+    for (int col = 0; col < DECODE_CELL_WIDTH; col++) {
+        for (int line = 0; line < TEXT_BITMAP_HEIGHT; line++) {
+            int pixel = x + col;
+            bool bit = (pixel < 0 || pixel >= PIXELS_PER_LINE) ? off_line : getBit(mask->rows[line], pixel);
+            key |= (uint64_t)bit << (7 * col + line);
+        }
+    }
+    return key;
+}
+
+static int countBits(uint64_t v) {
+    return __builtin_popcountll(v);
+}
+
+// Glyph columns of key drawn into mask from pixel x.
+static void drawKey(TextMask* mask, uint64_t key, int x) {
+    for (int col = 0; col < DECODE_CELL_WIDTH; col++) {
+        for (int line = 0; line < TEXT_BITMAP_HEIGHT; line++) {
+            if ((key >> (7 * col + line)) & 1) {
+                setBit(mask->rows[line], x + col);
+            }
+        }
+    }
+}
+
+// Errors and confidence of the text drawn for id against the observed text.
+// Returns the known pixels it gets wrong.
+static int scoreDecode(const TextMask* text, const TextMask* known, const TextMask* drawn, DecodedId* id) {
+    int errors = 0, overlap = 0, either = 0;
+    for (int line = 0; line < TEXT_BITMAP_HEIGHT; line++) {
+        for (int w = 0; w < 2; w++) {
+            uint64_t k = known->rows[line][w];
+            errors += countBits((drawn->rows[line][w] ^ text->rows[line][w]) & k);
+            overlap += countBits(drawn->rows[line][w] & text->rows[line][w] & k);
+            either += countBits((drawn->rows[line][w] | text->rows[line][w]) & k);
+        }
+    }
+    id->errors = errors;
+    id->confidence = either ? (double)overlap / either * (id->cells - id->undecided) / id->cells : 0.0;
+    return errors;
+}
+
+// Text and known pixel masks of image, voted over the six text row copies.
+static void readTextMask(const uint8_t* image, TextMask* text, TextMask* known) {
+    static const int sections[] = { PATTERN_BARS, PATTERN_RED, PATTERN_PULSE };
+    const uint8_t* base = getBaseImage();
+
+    memset(text, 0, sizeof(*text));
+    memset(known, 0, sizeof(*known));
+    for (int line = 0; line < TEXT_BITMAP_HEIGHT; line++) {
+        for (int pixel = 0; pixel < PIXELS_PER_LINE; pixel++) {
+            int copies = 0, white = 0;
+            for (int section = 0; section < 3; section++) {
+                for (int field = 0; field < 2; field++) {
+                    int addr = sections[section] + TEXT_START + line * 256 + field * 128 + pixel;
+                    if (base[addr] != COLOR_WHITE) {
+                        copies++;
+                        white += image[addr] == COLOR_WHITE;
+                    }
+                }
+            }
+            if (copies && 2 * white != copies) {
+                setBit(known->rows[line], pixel);
+                if (2 * white > copies) {
+                    setBit(text->rows[line], pixel);
+                }
+            }
+        }
+    }
+}
+
+// Decode the text as length characters, into id. Returns the known pixels
+// the text gets wrong.
+static int decodeLength(const TextMask* text, const TextMask* known, int length, DecodedId* id) {
+    int available_width = PIXELS_PER_LINE - (2 * TEXT_KEEPOUT);
+    int text_width = length * (CHAR_WIDTH + TEXT_INTER_SPACE) - TEXT_INTER_SPACE;
+    int x = TEXT_KEEPOUT + (available_width - text_width) / 2 + 1;
+    TextMask drawn;
+
+    memset(id, 0, sizeof(*id));
+    memset(&drawn, 0, sizeof(drawn));
+    id->cells = length;
+    for (int i = 0; i < length; i++) {
+        uint64_t key = getCellKey(text, x, false);
+        uint64_t key_known = getCellKey(known, x, true);
+        const DecodeGlyph* glyph = key_known == CELL_KNOWN ? findGlyph(key, false) : NULL;
+
+        if (!glyph) {
+            // Nearest glyph on the known pixels, a tie with another character is undecided.
+            int distance, ties;
+            glyph = findNearestGlyph(key, key_known, false, &distance, &ties);
+            if (ties) {
+                id->undecided++;
+            }
+            id->id_text[i] = ties ? DECODE_UNKNOWN_CHAR : glyph->c;
+        } else {
+            id->id_text[i] = glyph->c;
+        }
+        drawKey(&drawn, glyph->key, x);
+        x += glyph->advance;
+    }
+    return scoreDecode(text, known, &drawn, id);
+}
+
+// Text as the runs of text columns between blank ones, each matched on its
+// trimmed key wherever it sits. Spaces come from the width of the gaps.
+// Reads dumps whose text is not placed or spaced as this generator does it.
+static int decodeSegments(const TextMask* text, const TextMask* known, DecodedId* id) {
+    TextMask drawn;
+    int next_cell = -1;                     // Where the next glyph cell would start
+
+    memset(id, 0, sizeof(*id));
+    memset(&drawn, 0, sizeof(drawn));
+    for (int x = 0; x < PIXELS_PER_LINE && id->cells < MAX_TEXT_LENGTH; ) {
+        uint64_t key = getCellKey(text, x, false);
+        if (!(key & 0x7F)) {
+            x++;
+            continue;
+        }
+        int width = 1;
+        while (width < DECODE_CELL_WIDTH && x + width < PIXELS_PER_LINE && ((key >> (7 * width)) & 0x7F)) {
+            width++;
+        }
+        uint64_t mask = (1ULL << (7 * width)) - 1;
+        key &= mask;
+        uint64_t key_known = getCellKey(known, x, true) & mask;
+
+        const DecodeGlyph* glyph = key_known == mask ? findGlyph(key, true) : NULL;
+        char c;
+        if (glyph) {
+            c = glyph->c;
+        } else {
+            int distance, ties;
+            glyph = findNearestGlyph(key, key_known, true, &distance, &ties);
+            c = ties || distance > DECODE_CELL_WIDTH ? DECODE_UNKNOWN_CHAR : glyph->c;
+        }
+
+        int cell = x - glyph->lead;
+        if (next_cell >= 0) {
+            int spaces = (cell - next_cell + (CHAR_WIDTH + TEXT_INTER_SPACE) / 2) / (CHAR_WIDTH + TEXT_INTER_SPACE);
+            while (spaces-- > 0 && id->cells < MAX_TEXT_LENGTH - 1) {
+                id->id_text[id->cells++] = ' ';
+            }
+        }
+        id->undecided += c == DECODE_UNKNOWN_CHAR;
+        id->id_text[id->cells++] = c;
+        drawKey(&drawn, glyph->trimmed, x);
+        next_cell = cell + glyph->advance;
+        x += width;
+    }
+    if (id->cells == 0) {
+        return -1;
+    }
+    return scoreDecode(text, known, &drawn, id);
+}
+
+// Read the ID text out of image (the first 8K). Returns 0 when the text
+// rows hold no text.
+int decodeImageId(const uint8_t* image, size_t size, DecodedId* id) {
+    TextMask text, known;
+    DecodedId candidate;
+
+    memset(id, 0, sizeof(*id));
+    if (size < EPROM_SIZE) {
+        return 0;
+    }
+    pthread_once(&decode_once, initDecodeGlyphs);
+    readTextMask(image, &text, &known);
+    if (!(text.rows[0][0] | text.rows[0][1] | text.rows[1][0] | text.rows[1][1] | text.rows[2][0] |
+          text.rows[2][1] | text.rows[3][0] | text.rows[3][1] | text.rows[4][0] | text.rows[4][1] |
+          text.rows[5][0] | text.rows[5][1] | text.rows[6][0] | text.rows[6][1])) {
+        return 0;
+    }
+
+    // Fewest errors, then fewest undecided cells, then the shortest text:
+    // spaces either end give the same pixels.
+    int best_errors = -1;
+    for (int length = 1; length <= MAX_TEXT_LENGTH; length++) {
+        int errors = decodeLength(&text, &known, length, &candidate);
+        if (best_errors < 0 || errors < best_errors ||
+            (errors == best_errors && candidate.undecided < id->undecided)) {
+            best_errors = errors;
+            *id = candidate;
+        }
+    }
+
+    // Text placed or spaced some other way is explained better by its runs
+    // of columns. On a tie the centred text stands, it also counts the cells
+    // hidden in the white bar.
+    int errors = decodeSegments(&text, &known, &candidate);
+    if (errors >= 0 && errors < best_errors) {
+        *id = candidate;
+    }
+
+    // 100% only for an ID that generates this very image.
+    uint8_t regenerated[EPROM_SIZE];
+    id->exact = !id->undecided && generateEpromData(regenerated, NULL, id->id_text) &&
+                memcmp(regenerated, image, EPROM_SIZE) == 0;
+    if (!id->exact && id->confidence > DECODE_INEXACT_MAX) {
+        id->confidence = DECODE_INEXACT_MAX;
+    }
+    return 1;
+}
+
+// 16 bit sum of the image bytes, the checksum EPROM programmers show.
+uint16_t getImageChecksum(const uint8_t* image, size_t size) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < size; i++) {
+        sum += image[i];
+    }
+    return (uint16_t)sum;
+}
+
+// Decode one dump and print its ID.
+int runDecode(const char* filename) {
+    LoadedImage image;
+    DecodedId id;
+
+    if (!loadImageFile(filename, &image)) {
+        return 0;
+    }
+    int ok = decodeImageId(image.data, image.size, &id);
+    if (ok) {
+        printf("%s: \"%s\"  confidence %.0f%%  checksum %04X\n", filename, id.id_text, id.confidence * 100,
+               getImageChecksum(image.data, image.size));
+        if (!id.exact && !id.undecided) {
+            printf("  \"%s\" does not generate this image, the dump is damaged or not from tcgen\n", id.id_text);
+        }
+        if (id.undecided) {
+            printf("  %d of %d characters could not be told apart ('%c')\n", id.undecided, id.cells,
+                   DECODE_UNKNOWN_CHAR);
+        }
+    } else {
+        printf("%s: no ID text found\n", filename);
+    }
+    freeLoadedImage(&image);
+    return ok;
+}
+
+// One dump of a directory scan
+typedef struct {
+    char      path[OUTPUT_PATH_MAX];
+    bool      loaded;
+    bool      decoded;
+    size_t    size;
+    uint16_t  checksum;
+    DecodedId id;
+    int       duplicates;                   // Other dumps with the same ID
+} DecodeJob;
+
+// Dumps first, first + step ... of the scan, for one thread.
+typedef struct {
+    DecodeJob* jobs;
+    int count;
+    int first;
+    int step;
+    bool started;                           // Running on its own thread
+    pthread_t thread;
+} DecodeWorker;
+
+static void* decodeDumps(void* arg) {
+    DecodeWorker* worker = (DecodeWorker*)arg;
+    for (int i = worker->first; i < worker->count; i += worker->step) {
+        DecodeJob* job = &worker->jobs[i];
+        LoadedImage image;
+        if (!loadImageFile(job->path, &image)) {
+            continue;
+        }
+        job->loaded = true;
+        job->size = image.size;
+        job->checksum = getImageChecksum(image.data, image.size);
+        job->decoded = decodeImageId(image.data, image.size, &job->id);
+        freeLoadedImage(&image);
+    }
+    return NULL;
+}
+
+static bool isDumpFile(const char* name) {
+    const char* ext = strrchr(name, '.');
+    return ext && (strcasecmp(ext, ".bin") == 0 || strcasecmp(ext, ".hex") == 0 ||
+                   strcasecmp(ext, ".ihx") == 0 || strcasecmp(ext, ".ihex") == 0);
+}
+
+static int compareJobPaths(const void* a, const void* b) {
+    return strcmp(((const DecodeJob*)a)->path, ((const DecodeJob*)b)->path);
+}
+
+static const DecodeJob* sort_jobs;
+
+static int compareJobIds(const void* a, const void* b) {
+    int r = strcmp(sort_jobs[*(const int*)a].id.id_text, sort_jobs[*(const int*)b].id.id_text);
+    return r ? r : *(const int*)a - *(const int*)b;
+}
+
+// File name as a CSV field, quoted when it has to be.
+static void printCsvField(FILE* fp, const char* field) {
+    if (!strpbrk(field, ",\"\n")) {
+        fputs(field, fp);
+        return;
+    }
+    fputc('"', fp);
+    for (; *field; field++) {
+        if (*field == '"') {
+            fputc('"', fp);
+        }
+        fputc(*field, fp);
+    }
+    fputc('"', fp);
+}
+
+// Decode every dump in dir on up to threads threads (0 = one per CPU) and
+// write the CSV to csv_file ("-" is stdout).
+int runDecodeScan(const char* dir, const char* csv_file, int threads) {
+    DIR* d = opendir(dir);
+    if (!d) {
+        fprintf(stderr, "Error: Could not open directory %s\n", dir);
+        return 0;
+    }
+
+    DecodeJob* jobs = NULL;
+    int count = 0, capacity = 0;
+    struct dirent* entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (!isDumpFile(entry->d_name)) {
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            DecodeJob* grown = (DecodeJob*)realloc(jobs, sizeof(DecodeJob) * capacity);
+            if (!grown) {
+                perror("Error allocating memory for scan");
+                closedir(d);
+                free(jobs);
+                return 0;
+            }
+            jobs = grown;
+        }
+        DecodeJob* job = &jobs[count];
+        memset(job, 0, sizeof(*job));
+        if (snprintf(job->path, sizeof(job->path), "%s/%s", dir, entry->d_name) < (int)sizeof(job->path)) {
+            count++;
+        }
+    }
+    closedir(d);
+    if (count == 0) {
+        fprintf(stderr, "Error: No .bin or .hex dumps in %s\n", dir);
+        free(jobs);
+        return 0;
+    }
+    qsort(jobs, count, sizeof(DecodeJob), compareJobPaths);
+
+    if (threads <= 0) {
+        threads = getProcessorCount();
+    }
+    if (threads > count) {
+        threads = count;
+    }
+    DecodeWorker* workers = (DecodeWorker*)calloc(threads, sizeof(DecodeWorker));
+    int* order = (int*)malloc(sizeof(int) * count);
+    if (!workers || !order) {
+        perror("Error allocating memory for scan");
+        free(workers);
+        free(order);
+        free(jobs);
+        return 0;
+    }
+
+    // Worker 0, and any that cannot be started, run on this thread.
+    for (int t = 0; t < threads; t++) {
+        workers[t].jobs = jobs;
+        workers[t].count = count;
+        workers[t].first = t;
+        workers[t].step = threads;
+        workers[t].started = t > 0 && pthread_create(&workers[t].thread, NULL, decodeDumps, &workers[t]) == 0;
+    }
+    for (int t = 0; t < threads; t++) {
+        if (!workers[t].started) {
+            decodeDumps(&workers[t]);
+        }
+    }
+    for (int t = 0; t < threads; t++) {
+        if (workers[t].started) {
+            pthread_join(workers[t].thread, NULL);
+        }
+    }
+
+    // Decoded IDs sorted, each run of equal IDs is a set of duplicates.
+    int decoded = 0;
+    for (int i = 0; i < count; i++) {
+        if (jobs[i].decoded) {
+            order[decoded++] = i;
+        }
+    }
+    sort_jobs = jobs;
+    qsort(order, decoded, sizeof(int), compareJobIds);
+    int duplicate_ids = 0;
+    for (int i = 0, j; i < decoded; i = j) {
+        for (j = i + 1; j < decoded && strcmp(jobs[order[i]].id.id_text, jobs[order[j]].id.id_text) == 0; j++) {
+        }
+        for (int k = i; k < j; k++) {
+            jobs[order[k]].duplicates = j - i - 1;
+        }
+        duplicate_ids += j - i > 1;
+    }
+
+    bool to_stdout = strcmp(csv_file, "-") == 0;
+    FILE* fp = to_stdout ? stdout : fopen(csv_file, "w");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open file %s for writing\n", csv_file);
+        free(workers);
+        free(order);
+        free(jobs);
+        return 0;
+    }
+    fprintf(fp, "file,id,confidence,checksum,size,duplicates,exact\n");
+    for (int i = 0; i < count; i++) {
+        const DecodeJob* job = &jobs[i];
+        printCsvField(fp, job->path);
+        if (job->decoded) {
+            fprintf(fp, ",%s,%.2f,%04X,%zu,%d,%d\n", job->id.id_text, job->id.confidence, job->checksum,
+                    job->size, job->duplicates, job->id.exact);
+        } else if (job->loaded) {
+            fprintf(fp, ",,0.00,%04X,%zu,0,0\n", job->checksum, job->size);
+        } else {
+            fprintf(fp, ",,,,,,\n");
+        }
+    }
+    int ok = !ferror(fp);
+    if (!to_stdout) {
+        ok &= fclose(fp) == 0;
+    }
+
+    FILE* status_out = to_stdout ? stderr : stdout;
+    fprintf(status_out, "\nScanned %d dumps in %s: %d decoded, %d IDs on more than one dump\n", count, dir,
+            decoded, duplicate_ids);
+    for (int i = 0, j; i < decoded; i = j) {
+        const char* id_text = jobs[order[i]].id.id_text;
+        for (j = i + 1; j < decoded && strcmp(id_text, jobs[order[j]].id.id_text) == 0; j++) {
+        }
+        if (j - i > 1) {
+            fprintf(status_out, "  Duplicate \"%s\" on %d dumps\n", id_text, j - i);
+        }
+    }
+
+    free(workers);
+    free(order);
+    free(jobs);
+    return ok;
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ decode.h  include for decode.c
+ */
+
+#ifndef DECODE_H
+#define DECODE_H
+
+#include "patterns.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define DECODE_UNKNOWN_CHAR  '?'        // Cell no glyph fits better than another
+#define DECODE_INEXACT_MAX   0.99       // Best confidence of an ID that does not regenerate the dump
+
+// ID text read back out of an image
+typedef struct {
+    char   id_text[MAX_TEXT_LENGTH + 1];    // '?' where a cell is undecided
+    double confidence;                      // 0 to 1
+    int    cells;                           // Character cells, spaces included
+    int    undecided;                       // Cells printed as '?'
+    int    errors;                          // Known text pixels the ID does not explain
+    bool   exact;                           // Generating id_text gives the dump's first 8K
+} DecodedId;
+
+// ID decoding functions
+int decodeImageId(const uint8_t* image, size_t size, DecodedId* id);
+uint16_t getImageChecksum(const uint8_t* image, size_t size);
+int runDecode(const char* filename);
+int runDecodeScan(const char* dir, const char* csv_file, int threads);
+
+#endif // DECODE_H
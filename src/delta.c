@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ delta.c  page write delta for reprogramming a 28C64 EEPROM in circuit.
+
+ Changing the ID only changes the text rows, so rather than rewrite all
+ 8K the delta writes just the changed bytes, grouped by the part's page
+ write window: every byte loaded into one page costs a single write cycle.
+ The text rows sit in six copies (3 patterns x 2 fields), so on a 28C64B
+ (64 byte pages, 10 ms) one changed character is about 30 pages and a new
+ ID of another length up to most of the 128 in the part.
+ The AT28C64 in docs/datasheets has byte writes only (1 ms, 200 us for the
+ E part), there every changed byte is a write cycle.
+
+ Patch file, text:
+
+    # comments: part, IDs, changed bytes, pages and estimated time
+    old <hash of the image it applies to>
+    new <hash of the image it produces>
+    P <page> <address> <data>
+
+ one P record per run of changed bytes, page and address in hex, data as
+ hex pairs. Hashes are FNV-1a 64 of the whole 8K image, so applying checks
+ it starts from the right image and ends at exactly the new one.
+ */
+
+#include "delta.h"
+#include "compare.h"
+#include "encoder.h"
+#include "version.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <inttypes.h>
+
+static const EepromPart eeprom_parts[] = {
+    { "28C64B",  64, 10.0 },        // AT28C64B and most later 28C64 parts
+    { "28C64",    1,  1.0 },        // AT28C64, docs/datasheets/28C64.pdf
+    { "28C64E",   1,  0.2 },        // AT28C64E fast byte write
+};
+
+#define NUM_PARTS  (int)(sizeof(eeprom_parts) / sizeof(eeprom_parts[0]))
+
+// Part by name, case insensitive, NULL if unknown.
+const EepromPart* findEepromPart(const char* name) {
+    for (int i = 0; i < NUM_PARTS; i++) {
+        if (strcasecmp(name, eeprom_parts[i].name) == 0) {
+            return &eeprom_parts[i];
+        }
+    }
+    return NULL;
+}
+
+// Part list for the usage text.
+void printEepromParts(FILE* fp) {
+    for (int i = 0; i < NUM_PARTS; i++) {
+        if (eeprom_parts[i].page_size > 1) {
+            fprintf(fp, "  %-8s %d byte pages, %.1f ms write cycle\n", eeprom_parts[i].name,
+                    eeprom_parts[i].page_size, eeprom_parts[i].write_ms);
+        } else {
+            fprintf(fp, "  %-8s byte write, %.1f ms write cycle\n", eeprom_parts[i].name, eeprom_parts[i].write_ms);
+        }
+    }
+}
+
+static uint64_t hashImage(const uint8_t* image) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < EPROM_SIZE; i++) {
+        h = (h ^ image[i]) * 0x100000001B3ULL;
+    }
+    return h;
+}
+
+// MismatchCallback, extends the last run or starts one. Runs never cross a
+// page boundary, a byte starting a new page is a new write cycle.
+static void addChangedByte(uint32_t addr, uint8_t expected, uint8_t actual, void* context) {
+    DeltaPlan* plan = (DeltaPlan*)context;
+    uint32_t page = addr / plan->part->page_size;
+    (void)expected;
+    (void)actual;
+
+    if (plan->run_count) {
+        DeltaRun* last = &plan->runs[plan->run_count - 1];
+        uint32_t last_page = last->addr / plan->part->page_size;
+        if (page == last_page) {
+            if (last->addr + last->length == addr) {
+                last->length++;
+            } else {
+                DeltaRun run = { (uint16_t)addr, 1 };
+                plan->runs[plan->run_count++] = run;
+            }
+            plan->bytes++;
+            return;
+        }
+    }
+    DeltaRun run = { (uint16_t)addr, 1 };
+    plan->runs[plan->run_count++] = run;
+    plan->pages++;
+    plan->bytes++;
+}
+
+// Runs of changed bytes from old_image to new_image, by page of part.
+void planDelta(const uint8_t* old_image, const uint8_t* new_image, const EepromPart* part, DeltaPlan* plan) {
+    CompareResult result;
+
+    memset(plan, 0, sizeof(*plan));
+    plan->part = part;
+    plan->old_hash = hashImage(old_image);
+    plan->new_hash = hashImage(new_image);
+    compareImages(old_image, EPROM_SIZE, new_image, EPROM_SIZE, &result, addChangedByte, plan);
+}
+
+// Milliseconds to write the delta, one write cycle per page touched.
+double getDeltaTime(const DeltaPlan* plan) {
+    return plan->pages * plan->part->write_ms;
+}
+
+// Milliseconds to write the whole part.
+double getFullWriteTime(const EepromPart* part) {
+    return (double)(EPROM_SIZE / part->page_size) * part->write_ms;
+}
+
+// Patch text for plan, data from new_image. old_name and new_name only go
+// in the comments.
+int formatDeltaPatch(const DeltaPlan* plan, const uint8_t* new_image, const char* old_name, const char* new_name,
+                     OutputBuffer* out) {
+    static const char hex_digits[] = "0123456789ABCDEF";
+    const EepromPart* part = plan->part;
+
+    printOutputBuffer(out, "# tcgen %s delta for %s, %d byte write window, %.1f ms write cycle\n",
+                      VERSION_STRING, part->name, part->page_size, part->write_ms);
+    printOutputBuffer(out, "# %s -> %s\n", old_name, new_name);
+    printOutputBuffer(out, "# %d bytes changed, %d write cycles, %.1f ms estimated (%.1f ms for the whole part)\n",
+                      plan->bytes, plan->pages, getDeltaTime(plan), getFullWriteTime(part));
+    printOutputBuffer(out, "old %016" PRIx64 "\n", plan->old_hash);
+    printOutputBuffer(out, "new %016" PRIx64 "\n", plan->new_hash);
+
+    for (int i = 0; i < plan->run_count; i++) {
+        const DeltaRun* run = &plan->runs[i];
+        printOutputBuffer(out, "P %03X %04X ", run->addr / part->page_size, run->addr);
+        char* p = reserveOutputBuffer(out, (size_t)run->length * 2 + 1);
+        if (!p) {
+            return 0;
+        }
+        for (int j = 0; j < run->length; j++) {
+            uint8_t b = new_image[run->addr + j];
+            *p++ = hex_digits[b >> 4];
+            *p++ = hex_digits[b & 0x0F];
+        }
+        *p = '\n';
+        out->length += (size_t)run->length * 2 + 1;
+    }
+    return !out->failed;
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Apply patch_file to image (EPROM_SIZE bytes) in place. The image must
+// hash to the patch's old image, and the result must hash to its new one.
+int applyDeltaPatch(const char* patch_file, uint8_t* image) {
+    FILE* fp = fopen(patch_file, "r");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open patch %s\n", patch_file);
+        return 0;
+    }
+
+    char line[16 + EPROM_SIZE * 2];
+    int line_no = 0;
+    int have = 0;                   // 1 old, 2 new
+    uint64_t old_hash = 0, new_hash = 0;
+    int ok = 1;
+    while (ok && fgets(line, sizeof(line), fp)) {
+        unsigned page, addr;
+        int data_start = 0;
+        line_no++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!line[0] || line[0] == '#') {
+            continue;
+        }
+        if (sscanf(line, "old %16" SCNx64, &old_hash) == 1) {
+            have |= 1;
+            if (hashImage(image) != old_hash) {
+                fprintf(stderr, "Error: %s does not apply to this image\n", patch_file);
+                ok = 0;
+            }
+        } else if (sscanf(line, "new %16" SCNx64, &new_hash) == 1) {
+            have |= 2;
+        } else if (have == 3 && sscanf(line, "P %x %x %n", &page, &addr, &data_start) == 2 && data_start) {
+            const char* p = line + data_start;
+            size_t len = strlen(p);
+            if (len == 0 || len % 2 || addr + len / 2 > EPROM_SIZE) {
+                ok = 0;
+            }
+            for (size_t i = 0; ok && i < len; i += 2) {
+                int hi = hexValue(p[i]), lo = hexValue(p[i + 1]);
+                if (hi < 0 || lo < 0) {
+                    ok = 0;
+                } else {
+                    image[addr + i / 2] = (uint8_t)(hi << 4 | lo);
+                }
+            }
+            if (!ok) {
+                fprintf(stderr, "Error: %s line %d: bad record\n", patch_file, line_no);
+            }
+        } else {
+            fprintf(stderr, "Error: %s line %d: not a delta record\n", patch_file, line_no);
+            ok = 0;
+        }
+    }
+    fclose(fp);
+
+    if (ok && have != 3) {
+        fprintf(stderr, "Error: %s has no old and new image hashes\n", patch_file);
+        ok = 0;
+    }
+    if (ok && hashImage(image) != new_hash) {
+        fprintf(stderr, "Error: Patched image does not verify against %s\n", patch_file);
+        ok = 0;
+    }
+    return ok;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ delta.h  include for delta.c
+ */
+
+#ifndef DELTA_H
+#define DELTA_H
+
+#include "patterns.h"
+#include "output.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DELTA_PART_DEFAULT  "28C64B"
+
+// EEPROM programmed in circuit
+typedef struct {
+    const char* name;
+    int         page_size;          // Bytes written per write cycle, 1 for byte write parts
+    double      write_ms;           // Write cycle time, tWC
+} EepromPart;
+
+// Changed bytes [addr, addr + length), inside one page
+typedef struct {
+    uint16_t addr;
+    uint16_t length;
+} DeltaRun;
+
+// Page write plan from an old image to a new one
+typedef struct {
+    const EepromPart* part;
+    int      bytes;                 // Changed bytes
+    int      pages;                 // Write cycles
+    int      run_count;
+    DeltaRun runs[EPROM_SIZE];      // Worst case, byte write with every byte changed
+    uint64_t old_hash;
+    uint64_t new_hash;
+} DeltaPlan;
+
+// Delta functions
+const EepromPart* findEepromPart(const char* name);
+void printEepromParts(FILE* fp);
+void planDelta(const uint8_t* old_image, const uint8_t* new_image, const EepromPart* part, DeltaPlan* plan);
+double getDeltaTime(const DeltaPlan* plan);
+double getFullWriteTime(const EepromPart* part);
+int formatDeltaPatch(const DeltaPlan* plan, const uint8_t* new_image, const char* old_name, const char* new_name,
+                     OutputBuffer* out);
+int applyDeltaPatch(const char* patch_file, uint8_t* image);
+
+#endif // DELTA_H
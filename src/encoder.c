@@ -0,0 +1,637 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ encoder.c  output format encoders and the single pass driver behind -f.
+
+ encodeImage() walks the image once, ENCODER_CHUNK_SIZE bytes at a time,
+ and hands each chunk to every requested encoder, which appends its output
+ to its own buffer. Record based formats cut the chunks into records with
+ consumeRecords(), so the output does not depend on the chunk size.
+
+ Formats:
+   hex   Intel HEX, -r bytes per record, type-04 records above 64K (or
+         always with -x), the same as writeHexFileEx()
+   bin   raw image
+   srec  Motorola S-records: S0 header, S1 data and S9 end record, or
+         S2/S8 for images above 64K
+   tek   Tektronix hex, /AAAALLCC<data>CC records and a /000000<cc> end
+   dump  annotated dump, as writeRawHexFile()
+
+ A new format is one EncoderFormat entry in encoder_formats[].
+
+ The OutputBuffer helpers and the Intel HEX and dump line formatting live
+ here too, so libpt430 (pt430.c) can encode without the file writers of
+ output.c. Nothing here prints; parsing and listing -f formats for the
+ command line is in output.c.
+ */
+
+#include "encoder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <string.h>
+
+// Nibble to ASCII hex lookup
+static const char hex_digits[16] = {
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+};
+
+static char* putHexByte(char* p, uint8_t value) {
+    *p++ = hex_digits[value >> 4];
+    *p++ = hex_digits[value & 0x0F];
+    return p;
+}
+
+// Output buffers
+
+// Hand the buffered bytes to the sink and empty the buffer.
+int drainOutputBuffer(OutputBuffer* buf) {
+    if (buf->sink && buf->length > 0 && !buf->failed) {
+        if (!buf->sink(buf->context, buf->data, buf->length)) {
+            buf->failed = true;
+        }
+        buf->length = 0;
+    }
+    return !buf->failed;
+}
+
+// Room for size more bytes at the end of buf, NULL (and failed set) when
+// out of memory. The caller adds what it used to buf->length. A fixed
+// buffer is drained to its sink to make room and never grows.
+char* reserveOutputBuffer(OutputBuffer* buf, size_t size) {
+    if (buf->failed) {
+        return NULL;
+    }
+    if (buf->capacity - buf->length < size) {
+        if (buf->fixed) {
+            if (!drainOutputBuffer(buf) || buf->capacity - buf->length < size) {
+                buf->failed = true;
+                return NULL;
+            }
+            return buf->data + buf->length;
+        }
+        size_t capacity = buf->capacity ? buf->capacity : 4096;
+        while (capacity - buf->length < size) capacity *= 2;
+        char* grown = buf->arena ? (char*)growArena(buf->arena, buf->data, buf->length, capacity)
+                                 : (char*)realloc(buf->data, capacity);
+        if (!grown) {
+            buf->failed = true;
+            return NULL;
+        }
+        buf->data = grown;
+        buf->capacity = capacity;
+    }
+    return buf->data + buf->length;
+}
+
+// Arena buffers go with the next resetArena().
+void freeOutputBuffer(OutputBuffer* buf) {
+    if (!buf->fixed && !buf->arena) {
+        free(buf->data);
+    }
+    memset(buf, 0, sizeof(*buf));
+}
+
+// printf onto the end of buf.
+void printOutputBuffer(OutputBuffer* buf, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    char* end = reserveOutputBuffer(buf, 256);
+    int n = end ? vsnprintf(end, 256, format, args) : -1;
+    va_end(args);
+
+    if (n >= 256) {
+        va_start(args, format);
+        end = reserveOutputBuffer(buf, (size_t)n + 1);
+        if (end) vsnprintf(end, (size_t)n + 1, format, args);
+        va_end(args);
+    }
+    if (end && n >= 0) {
+        buf->length += (size_t)n;
+    } else {
+        buf->failed = true;
+    }
+}
+
+// Encode one Intel HEX record ":LLAAAATT<data>CC\n" at out, return end.
+char* encodeHexRecord(char* out, uint8_t type, uint16_t addr, const uint8_t* data, int count) {
+    uint8_t checksum = count + (addr >> 8) + (addr & 0xFF) + type;
+    uint8_t head[4] = { (uint8_t)count, (uint8_t)(addr >> 8), (uint8_t)(addr & 0xFF), type };
+
+    *out++ = ':';
+    for (int i = 0; i < 4; i++) {
+        out = putHexByte(out, head[i]);
+    }
+    for (int i = 0; i < count; i++) {
+        out = putHexByte(out, data[i]);
+        checksum += data[i];
+    }
+    checksum = (uint8_t)(0x100 - checksum);
+    out = putHexByte(out, checksum);
+    *out++ = '\n';
+    return out;
+}
+
+typedef int (*EmitRecord)(Encoder* enc, uint32_t addr, const uint8_t* data, int count);
+
+// Data bytes in the record starting at addr.
+static int recordSize(const Encoder* enc, uint32_t addr) {
+    uint32_t size = (uint32_t)enc->record_len;
+    if (enc->boundary && size > enc->boundary - (addr & (enc->boundary - 1))) {
+        size = enc->boundary - (addr & (enc->boundary - 1));
+    }
+    if (size > enc->length - addr) {
+        size = enc->length - addr;
+    }
+    return (int)size;
+}
+
+// Cut a chunk into records. Whole records are emitted straight from the
+// chunk, a record split over two chunks is collected in enc->record first.
+static int consumeRecords(Encoder* enc, const uint8_t* chunk, size_t size, EmitRecord emit) {
+    while (size > 0) {
+        if (enc->record_fill == 0) {
+            enc->record_addr = enc->addr;
+        }
+        int want = recordSize(enc, enc->record_addr);
+
+        if (enc->record_fill == 0 && size >= (size_t)want) {
+            if (!emit(enc, enc->addr, chunk, want)) return 0;
+            chunk += want;
+            size -= want;
+            enc->addr += want;
+            continue;
+        }
+
+        size_t n = (size_t)(want - enc->record_fill);
+        if (n > size) n = size;
+        memcpy(enc->record + enc->record_fill, chunk, n);
+        enc->record_fill += (int)n;
+        enc->addr += (uint32_t)n;
+        chunk += n;
+        size -= n;
+        if (enc->record_fill == want) {
+            enc->record_fill = 0;
+            if (!emit(enc, enc->record_addr, enc->record, want)) return 0;
+        }
+    }
+    return 1;
+}
+
+// Emit a partly filled last record.
+static int flushRecord(Encoder* enc, EmitRecord emit) {
+    int count = enc->record_fill;
+    enc->record_fill = 0;
+    return count == 0 || emit(enc, enc->record_addr, enc->record, count);
+}
+
+// Intel HEX
+
+static int emitHexRecord(Encoder* enc, uint32_t addr, const uint8_t* data, int count) {
+    // Exact size, so encodeHexImage() fits a getHexEncodedSize() buffer.
+    bool new_segment = (addr >> 16) != enc->segment;
+    bool address_record = new_segment && ((addr >> 16) != 0 || enc->options->linear_address);
+    char* out = reserveOutputBuffer(enc->out, (address_record ? HEX_RECORD_SIZE(2) : 0) + HEX_RECORD_SIZE(count));
+    if (!out) {
+        return 0;
+    }
+    char* p = out;
+    if (new_segment) {
+        enc->segment = addr >> 16;
+        if (address_record) {
+            uint8_t upper[2] = { (uint8_t)(enc->segment >> 8), (uint8_t)(enc->segment & 0xFF) };
+            p = encodeHexRecord(p, 0x04, 0, upper, 2);
+        }
+    }
+    p = encodeHexRecord(p, 0x00, (uint16_t)(addr & 0xFFFF), data, count);
+    enc->out->length += p - out;
+    return 1;
+}
+
+static int hexInit(Encoder* enc) {
+    enc->record_len = enc->options->record_len;
+    enc->boundary = 0x10000;
+    enc->segment = 0xFFFFFFFF;
+    return 1;
+}
+
+#define HEX_RUN_SIZE  2048        // Most output reserved at once for a run of records
+
+// Runs of whole records inside the current 64K segment are encoded straight
+// from the chunk under one reservation, anything else (a new segment, a
+// record split between chunks) goes through consumeRecords().
+static int hexConsume(Encoder* enc, const uint8_t* chunk, size_t size) {
+    size_t len = (size_t)enc->record_len;
+    size_t run = HEX_RUN_SIZE / HEX_RECORD_SIZE(len);
+    if (run == 0) run = 1;
+
+    while (enc->record_fill == 0 && size >= len && (enc->addr >> 16) == enc->segment) {
+        size_t count = (0x10000 - (enc->addr & 0xFFFF)) / len;    // Records before the boundary
+        if (count > size / len) count = size / len;
+        if (count > run) count = run;
+        if (count == 0) {
+            break;
+        }
+        char* out = reserveOutputBuffer(enc->out, count * HEX_RECORD_SIZE(len));
+        if (!out) {
+            return 0;
+        }
+        char* p = out;
+        for (size_t i = 0; i < count; i++) {
+            p = encodeHexRecord(p, 0x00, (uint16_t)(enc->addr & 0xFFFF), chunk, (int)len);
+            enc->addr += (uint32_t)len;
+            chunk += len;
+        }
+        enc->out->length += p - out;
+        size -= count * len;
+    }
+    return consumeRecords(enc, chunk, size, emitHexRecord);
+}
+
+static int hexFinish(Encoder* enc) {
+    if (!flushRecord(enc, emitHexRecord)) {
+        return 0;
+    }
+    char* out = reserveOutputBuffer(enc->out, HEX_RECORD_SIZE(0));
+    if (!out) {
+        return 0;
+    }
+    enc->out->length += encodeHexRecord(out, 0x01, 0, NULL, 0) - out;
+    return 1;
+}
+
+// Binary
+
+static int binConsume(Encoder* enc, const uint8_t* chunk, size_t size) {
+    char* out = reserveOutputBuffer(enc->out, size);
+    if (!out) {
+        return 0;
+    }
+    memcpy(out, chunk, size);
+    enc->out->length += size;
+    return 1;
+}
+
+// Motorola S-records
+
+#define SREC_HEADER  "tcgen"
+
+// "S<type><count><address><data><checksum>\n", the count covers address,
+// data and checksum, the checksum is the ones complement of their sum.
+static int putSrecRecord(Encoder* enc, char type, uint32_t addr, const uint8_t* data, int count) {
+    char* out = reserveOutputBuffer(enc->out, 2 + 2 * (1 + 4 + count + 1) + 1);
+    if (!out) {
+        return 0;
+    }
+    uint8_t length = (uint8_t)(enc->addr_size + count + 1);
+    uint8_t sum = length;
+    char* p = out;
+
+    *p++ = 'S';
+    *p++ = type;
+    p = putHexByte(p, length);
+    for (int shift = (enc->addr_size - 1) * 8; shift >= 0; shift -= 8) {
+        uint8_t b = (uint8_t)(addr >> shift);
+        p = putHexByte(p, b);
+        sum += b;
+    }
+    for (int i = 0; i < count; i++) {
+        p = putHexByte(p, data[i]);
+        sum += data[i];
+    }
+    p = putHexByte(p, (uint8_t)~sum);
+    *p++ = '\n';
+    enc->out->length += p - out;
+    return 1;
+}
+
+static int emitSrecData(Encoder* enc, uint32_t addr, const uint8_t* data, int count) {
+    return putSrecRecord(enc, enc->addr_size == 2 ? '1' : '2', addr, data, count);
+}
+
+static int srecInit(Encoder* enc) {
+    enc->addr_size = enc->length > 0x10000 ? 3 : 2;
+    enc->record_len = enc->options->record_len;
+    if (enc->record_len > 255 - enc->addr_size - 1) {
+        enc->record_len = 255 - enc->addr_size - 1;
+    }
+
+    // The header record always has a 16 bit address.
+    int addr_size = enc->addr_size;
+    enc->addr_size = 2;
+    int ok = putSrecRecord(enc, '0', 0, (const uint8_t*)SREC_HEADER, (int)strlen(SREC_HEADER));
+    enc->addr_size = addr_size;
+    return ok;
+}
+
+static int srecConsume(Encoder* enc, const uint8_t* chunk, size_t size) {
+    return consumeRecords(enc, chunk, size, emitSrecData);
+}
+
+static int srecFinish(Encoder* enc) {
+    return flushRecord(enc, emitSrecData) &&
+           putSrecRecord(enc, enc->addr_size == 2 ? '9' : '8', 0, NULL, 0);
+}
+
+// Tektronix hex
+
+// Sum of the hex digits of a byte, for the Tektronix checksums.
+static uint8_t nibbleSum(uint8_t b) {
+    return (uint8_t)((b >> 4) + (b & 0x0F));
+}
+
+// "/<address><count><checksum><data><checksum>\n", the first checksum is
+// over the address and count digits, the second over the data digits.
+// The end record has no data and no second checksum.
+static int emitTekRecord(Encoder* enc, uint32_t addr, const uint8_t* data, int count) {
+    char* out = reserveOutputBuffer(enc->out, 1 + 2 * (2 + 1 + 1 + count + 1) + 1);
+    if (!out) {
+        return 0;
+    }
+    uint8_t head[3] = { (uint8_t)(addr >> 8), (uint8_t)(addr & 0xFF), (uint8_t)count };
+    uint8_t sum = 0;
+    char* p = out;
+
+    *p++ = '/';
+    for (int i = 0; i < 3; i++) {
+        p = putHexByte(p, head[i]);
+        sum += nibbleSum(head[i]);
+    }
+    p = putHexByte(p, sum);
+    if (count > 0) {
+        sum = 0;
+        for (int i = 0; i < count; i++) {
+            p = putHexByte(p, data[i]);
+            sum += nibbleSum(data[i]);
+        }
+        p = putHexByte(p, sum);
+    }
+    *p++ = '\n';
+    enc->out->length += p - out;
+    return 1;
+}
+
+static int tekInit(Encoder* enc) {
+    enc->record_len = enc->options->record_len;
+    return 1;
+}
+
+static int tekConsume(Encoder* enc, const uint8_t* chunk, size_t size) {
+    return consumeRecords(enc, chunk, size, emitTekRecord);
+}
+
+static int tekFinish(Encoder* enc) {
+    return flushRecord(enc, emitTekRecord) && emitTekRecord(enc, 0, NULL, 0);
+}
+
+// Dump file header, the layout of the image.
+int formatDumpHeader(int length, OutputBuffer* out) {
+    // Write header with pattern information
+    printOutputBuffer(out, "// PRACTEL PT-430b 27C64-150 buffer dump\n");
+    printOutputBuffer(out, "// Size: %d bytes (0x%04X)\n", length, length);
+    printOutputBuffer(out, "// Format: Raw hex dump, 16 bytes per line\n");
+    printOutputBuffer(out, "//\n");
+    printOutputBuffer(out, "// Address Pattern Layout:\n");
+    printOutputBuffer(out, "// 0x0000-0x07FF: Pattern 1 - Color Bars (A11=0, A12=0) [CENTER POSITION]\n");
+    printOutputBuffer(out, "//   - 0x0000-0x007F: Initial pattern = Color Bar pattern\n");
+    printOutputBuffer(out, "//   - 0x0080-0x077F: Main pattern area Color Bar overlayed with ID\n");
+    printOutputBuffer(out, "//   - 0x0780-0x07FF: Line 16 pattern = Color Bar\n");
+    printOutputBuffer(out, "//\n");
+    printOutputBuffer(out, "// 0x0800-0x0FFF: Pattern 2 - Split Field Red (A11=1, A12=0) [RIGHT POSITION]\n");
+    printOutputBuffer(out, "//   - 0x0800-0x087F: Initial pattern= Color Bar pattern\n");
+    printOutputBuffer(out, "//   - 0x0880-0x0F7F: Main pattern area Color Bar overlayed with ID\n");
+    printOutputBuffer(out, "//   - 0x0F80-0x0FFF: Line 16 pattern = Red\n");
+    printOutputBuffer(out, "//\n");
+    printOutputBuffer(out, "// 0x1000-0x17FF: Pattern 3 - Pulse & Bar (A11=0, A12=1) [LEFT POSITION]\n");
+    printOutputBuffer(out, "//   - 0x1000-0x107F: Initial pattern = Color Bar pattern\n");
+    printOutputBuffer(out, "//   - 0x1080-0x177F: Main pattern area Color Bar overlayed with ID\n");
+    printOutputBuffer(out, "//   - 0x1780-0x17FF: Line 16 pattern = Pulse & Bar\n");
+    printOutputBuffer(out, "//\n");
+    printOutputBuffer(out, "// 0x1800-0x1FFF: Pattern 4 - Color Black (A11=1, A12=1) [NOT USED]\n");
+    printOutputBuffer(out, "//   - 0x1800-0x187F: Initial pattern = Color Black\n");
+    printOutputBuffer(out, "//   - 0x1880-0x1F7F: Main pattern area Color Black (NO ID Overlay)\n");
+    printOutputBuffer(out, "//   - 0x1F80-0x1FFF: Line 16 pattern = Color Black\n");
+    printOutputBuffer(out, "//\n");
+    printOutputBuffer(out, "// Addr   0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F\n");
+    printOutputBuffer(out, "//-------------------------------------------------------\n");
+
+    return !out->failed;
+}
+
+// One dump line of up to 16 bytes at addr, preceded by the region heading
+// when addr starts a region.
+int formatDumpLine(const uint8_t* data, int addr, int count, OutputBuffer* out) {
+    switch (addr) {
+        case 0x0000:
+            printOutputBuffer(out, "\n// (0x0000-0x007F) Pattern 1 - Color Bars Initial Pattern\n\n");
+            break;
+        case 0x0080:
+            printOutputBuffer(out, "\n// (0x0080-0x077F) Pattern 1 - Color Bars Main Pattern with Text\n\n");
+            break;
+        case 0x0780:
+            printOutputBuffer(out, "\n// (0x0780-0x07FF) Pattern 1 - Color Bars Line 16\n\n");
+            break;
+        case 0x0800:
+            printOutputBuffer(out, "\n// (0x0800-0x087F) Pattern 2 - Split Field Bars Initial Pattern [Color Bars]\n\n");
+            break;
+        case 0x0880:
+            printOutputBuffer(out, "\n// (0x0880-0x08FF) Pattern 2 - Split Field Bars Main Pattern with Text [Color Bars]\n\n");
+            break;
+        case 0x0F80:
+            printOutputBuffer(out, "\n// (0x0F80-0x0FFF) Pattern 2 - Split Field Bars Line 16 [RED]\n\n");
+            break;
+        case 0x1000:
+            printOutputBuffer(out, "\n// (0x1000-0x107F) Pattern 3 - Pulse & Bar Initial Pattern [Color Bars]\n\n");
+            break;
+        case 0x1080:
+            printOutputBuffer(out, "\n// (0x1080-0x177F) Pattern 3 - Pulse & Bar Main Pattern with Text [Color Bars]\n\n");
+            break;
+        case 0x1780:
+            printOutputBuffer(out, "\n// (0x1780-0x17FF) Pattern 3 - Pulse & Bar Line 16 [Pulse & Bar]\n\n");
+            break;
+        case 0x1800:
+            printOutputBuffer(out, "\n// (0x1800-0x187F) Pattern 4 - Color Black Initial Pattern [Black]\n\n");
+            break;
+        case 0x1880:
+            printOutputBuffer(out, "\n// (0x1880-0x1F7F) Pattern 4 - Color Black Main Pattern no id overlay [Black]\n\n");
+            break;
+        case 0x1F80:
+            printOutputBuffer(out, "\n// (0x1F80-0x1FFF) Pattern 4 - Color Black Line 16 [Black]\n");
+    }
+
+    // "    AAAA: " + 16 x "XX " + "  |" + 16 ASCII + "|\n"
+    char* line = reserveOutputBuffer(out, 10 + 16 * 3 + 3 + 16 + 2 + 1);
+    if (!line) {
+        return 0;
+    }
+    char* p = line + sprintf(line, "    %04X: ", addr);
+    for (int i = 0; i < count; i++) {
+        *p++ = hex_digits[data[i] >> 4];
+        *p++ = hex_digits[data[i] & 0x0F];
+        *p++ = ' ';
+    }
+    memcpy(p, "  |", 3);  // Separator between hex and ASCII
+    p += 3;
+    for (int i = 0; i < count; i++) {
+        char c = data[i];
+        *p++ = (isprint(c)) ? c : '.'; // Use isprint() for printable characters
+    }
+    *p++ = '|';
+    *p++ = '\n';
+    out->length += p - line;
+    return !out->failed;
+}
+
+// Format the raw hex dump (no Intel HEX formatting) used for EPROM comparision.
+int formatRawHexDump(const uint8_t* data, int length, OutputBuffer* out) {
+    int ok = formatDumpHeader(length, out);
+    for (int addr = 0; ok && addr < length; addr += 16) {
+        ok = formatDumpLine(data + addr, addr, (length - addr < 16) ? length - addr : 16, out);
+    }
+    return ok;
+}
+
+// Annotated dump, one 16 byte line per record.
+
+static int emitDumpLine(Encoder* enc, uint32_t addr, const uint8_t* data, int count) {
+    return formatDumpLine(data, (int)addr, count, enc->out);
+}
+
+static int dumpInit(Encoder* enc) {
+    enc->record_len = 16;
+    return formatDumpHeader((int)enc->length, enc->out);
+}
+
+static int dumpConsume(Encoder* enc, const uint8_t* chunk, size_t size) {
+    return consumeRecords(enc, chunk, size, emitDumpLine);
+}
+
+static int dumpFinish(Encoder* enc) {
+    return flushRecord(enc, emitDumpLine);
+}
+
+static const EncoderFormat encoder_formats[] = {
+    { "hex",  ".hex",  "Intel HEX",                 false, 0,         hexInit,  hexConsume,  hexFinish  },
+    { "bin",  ".bin",  "Binary",                    true,  0,         NULL,     binConsume,  NULL       },
+    { "srec", ".srec", "Motorola S-record",         false, 0x1000000, srecInit, srecConsume, srecFinish },
+    { "tek",  ".tek",  "Tektronix hex",             false, 0x10000,   tekInit,  tekConsume,  tekFinish  },
+    { "dump", ".dump", "Raw hex dump with ASCII",   false, 0,         dumpInit, dumpConsume, dumpFinish },
+};
+
+#define NUM_ENCODER_FORMATS  ((int)(sizeof(encoder_formats) / sizeof(encoder_formats[0])))
+
+// Format index of the table, NULL past the end.
+const EncoderFormat* getEncoderFormat(int index) {
+    return (index >= 0 && index < NUM_ENCODER_FORMATS) ? &encoder_formats[index] : NULL;
+}
+
+const EncoderFormat* findEncoderFormat(const char* name) {
+    for (int i = 0; i < NUM_ENCODER_FORMATS; i++) {
+        if (strcmp(encoder_formats[i].name, name) == 0) {
+            return &encoder_formats[i];
+        }
+    }
+    return NULL;
+}
+
+// First format of the list that cannot address length bytes, NULL if all can.
+const EncoderFormat* findEncoderLimit(const EncoderList* list, uint32_t length) {
+    for (int i = 0; i < list->count; i++) {
+        if (list->formats[i]->max_length && length > list->formats[i]->max_length) {
+            return list->formats[i];
+        }
+    }
+    return NULL;
+}
+
+// Encode the image into every format of the list in one pass, format i is
+// appended to outs[i].
+int encodeImage(const uint8_t* data, uint32_t length, const EncoderList* list,
+                const HexOptions* options, OutputBuffer outs[]) {
+    HexOptions defaults = { HEX_RECORD_DEFAULT, false };
+    Encoder encoders[MAX_ENCODERS];
+    int ok = 1;
+
+    if (!options) {
+        options = &defaults;
+    }
+    if (findEncoderLimit(list, length)) {
+        return 0;
+    }
+
+    for (int i = 0; i < list->count; i++) {
+        Encoder* enc = &encoders[i];
+        memset(enc, 0, sizeof(*enc));
+        enc->format = list->formats[i];
+        enc->options = options;
+        enc->out = &outs[i];
+        enc->length = length;
+        ok = ok && (!enc->format->init || enc->format->init(enc));
+    }
+
+    for (uint32_t addr = 0; ok && addr < length; addr += ENCODER_CHUNK_SIZE) {
+        size_t size = (length - addr < ENCODER_CHUNK_SIZE) ? length - addr : ENCODER_CHUNK_SIZE;
+        for (int i = 0; ok && i < list->count; i++) {
+            ok = encoders[i].format->consume(&encoders[i], data + addr, size);
+        }
+    }
+
+    for (int i = 0; ok && i < list->count; i++) {
+        ok = !encoders[i].format->finish || encoders[i].format->finish(&encoders[i]);
+    }
+    for (int i = 0; i < list->count; i++) {
+        ok = drainOutputBuffer(&outs[i]) && ok;
+    }
+    return ok;
+}
+
+// Size in bytes of the Intel HEX text for length bytes of data.
+size_t getHexEncodedSize(int length, const HexOptions* options) {
+    HexOptions defaults = { HEX_RECORD_DEFAULT, false };
+    if (!options) {
+        options = &defaults;
+    }
+
+    size_t size = 0;
+    uint32_t segment = 0xFFFFFFFF;
+    for (uint32_t addr = 0; addr < (uint32_t)length; ) {
+        if ((addr >> 16) != segment) {
+            segment = addr >> 16;
+            if (segment != 0 || options->linear_address) {
+                size += HEX_RECORD_SIZE(2);
+            }
+        }
+        uint32_t bytes = length - addr;
+        uint32_t to_boundary = 0x10000 - (addr & 0xFFFF);
+        if (bytes > (uint32_t)options->record_len) bytes = options->record_len;
+        if (bytes > to_boundary) bytes = to_boundary;
+        size += HEX_RECORD_SIZE(bytes);
+        addr += bytes;
+    }
+    return size + HEX_RECORD_SIZE(0);       // End of file record
+}
+
+// Encode data as Intel HEX into memory, out must hold getHexEncodedSize()
+// bytes. Returns the encoded size, no terminating NUL is written.
+size_t encodeHexImage(const uint8_t* data, int length, const HexOptions* options, char* out, size_t out_size) {
+    EncoderList list = { { findEncoderFormat("hex") }, 1 };
+    OutputBuffer buf = { out, 0, out_size, false, true, NULL, NULL };
+
+    return encodeImage(data, (uint32_t)length, &list, options, &buf) ? buf.length : 0;
+}
+
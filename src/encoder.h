@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ encoder.h  include for encoder.c
+ */
+
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include "output.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define ENCODER_CHUNK_SIZE  4096    // Image bytes handed to every encoder at a time
+#define MAX_ENCODERS        8       // Formats in one -f list
+#define ENCODER_DEFAULT     "hex,bin"
+
+typedef struct Encoder Encoder;
+
+// An output format. init and finish may be NULL, consume sees the image in
+// address order, ENCODER_CHUNK_SIZE bytes at a time.
+typedef struct {
+    const char* name;               // -f name
+    const char* suffix;             // Added to the output file name
+    const char* description;
+    bool        binary;             // Written without text mode line endings
+    uint32_t    max_length;         // Largest image the addresses can reach, 0 = any
+    int  (*init)(Encoder* enc);
+    int  (*consume)(Encoder* enc, const uint8_t* chunk, size_t size);
+    int  (*finish)(Encoder* enc);
+} EncoderFormat;
+
+// Encoder state, one per format for each image.
+struct Encoder {
+    const EncoderFormat* format;
+    const HexOptions*    options;
+    OutputBuffer*        out;
+    uint32_t length;                // Image size
+    uint32_t addr;                  // Address of the next byte consumed
+    int      record_len;            // Data bytes per record, record formats
+    uint32_t boundary;              // Records do not cross a multiple of this power of two, 0 = none
+    uint32_t segment;               // Intel HEX 64K segment of the last record
+    int      addr_size;             // S-record address bytes
+    uint32_t record_addr;           // Address of record[0]
+    int      record_fill;
+    uint8_t  record[HEX_RECORD_MAX];
+};
+
+typedef struct {
+    const EncoderFormat* formats[MAX_ENCODERS];
+    int count;
+} EncoderList;
+
+// Output buffer and record formatting, shared with output.c
+char* reserveOutputBuffer(OutputBuffer* buf, size_t size);
+int drainOutputBuffer(OutputBuffer* buf);
+void freeOutputBuffer(OutputBuffer* buf);
+void printOutputBuffer(OutputBuffer* buf, const char* format, ...);
+char* encodeHexRecord(char* out, uint8_t type, uint16_t addr, const uint8_t* data, int count);
+size_t getHexEncodedSize(int length, const HexOptions* options);
+size_t encodeHexImage(const uint8_t* data, int length, const HexOptions* options, char* out, size_t out_size);
+int formatDumpHeader(int length, OutputBuffer* out);
+int formatDumpLine(const uint8_t* data, int addr, int count, OutputBuffer* out);
+int formatRawHexDump(const uint8_t* data, int length, OutputBuffer* out);
+
+// Encoder functions
+const EncoderFormat* getEncoderFormat(int index);
+const EncoderFormat* findEncoderFormat(const char* name);
+const EncoderFormat* findEncoderLimit(const EncoderList* list, uint32_t length);
+int encodeImage(const uint8_t* data, uint32_t length, const EncoderList* list,
+                const HexOptions* options, OutputBuffer outs[]);
+
+// Format lists of the command line and encoded image files, in output.c
+// with the other file writers
+int parseEncoderList(const char* names, EncoderList* list);
+int addEncoderFormat(EncoderList* list, const EncoderFormat* format);
+void printEncoderFormats(FILE* fp);
+int writeEncodedFiles(const uint8_t* data, uint32_t length, const EncoderList* list,
+                      const HexOptions* options, const char* output_file, Arena* arena);
+
+#endif // ENCODER_H
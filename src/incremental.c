@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ incremental.c  content addressed output index for --incremental.
+
+ Every output file is recorded with the key of the inputs that produced it
+ and a hash of its content. The key covers the generator version, the
+ layout constants, font and base image, the ID text and the output options.
+ A job whose files all carry the current key and still hash to what was
+ written is skipped without generating anything. Files that are written go
+ to a temporary name first; if the content is the same as the file already
+ there the temporary is dropped and the old file (and its time stamp) is
+ left alone, otherwise it is renamed over the old file.
+
+ Index file, one line per output file:
+   <key> <content hash> <size> <path>
+ with the key and hash as 16 hex digits.
+ */
+
+#include "incremental.h"
+#include "patterns.h"
+#include "version.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#define FNV_OFFSET  0xCBF29CE484222325ULL
+#define FNV_PRIME   0x100000001B3ULL
+
+static uint64_t hashBytes(uint64_t h, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * FNV_PRIME;
+    }
+    return h;
+}
+
+// Include the terminating NUL so adjacent strings cannot run together.
+static uint64_t hashString(uint64_t h, const char* s) {
+    return hashBytes(h, s, strlen(s) + 1);
+}
+
+// Key of everything that decides the content of a job's output files.
+uint64_t getOutputKey(const char* id_text, bool debug, bool label, const HexOptions* hex) {
+    static const int32_t layout[] = {
+        EPROM_SIZE, PIXELS_PER_LINE, LINES_PER_FIELD, TEXT_LINES, PATTERN_SIZE,
+        PATTERN_BARS, PATTERN_RED, PATTERN_PULSE, PATTERN_BLACK,
+        TEXT_START, LINE_16_OFFSET, CHAR_WIDTH, TEXT_BITMAP_HEIGHT, TEXT_INTER_SPACE,
+        TEXT_KEEPOUT, MAX_TEXT_LENGTH, BAR_WIDTH, NUM_BARS, PULSE_OFFSET, BAR_POSITION,
+        MAGENTA_BAR, COLOR_WHITE, COLOR_BLACK,
+    };
+    int32_t options[4] = { hex->record_len, hex->linear_address, debug, label };
+    size_t atlas_size;
+
+    uint64_t h = hashString(FNV_OFFSET, VERSION_STRING);
+    h = hashBytes(h, layout, sizeof(layout));
+    const void* atlas = getGlyphAtlas(&atlas_size);
+    h = hashBytes(h, atlas, atlas_size);
+    h = hashBytes(h, getBaseImage(), EPROM_SIZE);
+    h = hashString(h, id_text);
+    return hashBytes(h, options, sizeof(options));
+}
+
+// Content hash and size of a file, 0 if it cannot be read.
+static int hashFile(const char* path, uint64_t* hash, uint64_t* size) {
+    // Read with a plain fd, a FILE would allocate a buffer per output.
+    int fd = open(path, O_RDONLY | O_BINARY);
+    if (fd < 0) {
+        return 0;
+    }
+    uint8_t buffer[16384];
+    uint64_t h = FNV_OFFSET, total = 0;
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        h = hashBytes(h, buffer, (size_t)n);
+        total += (uint64_t)n;
+    }
+    int ok = (n == 0);
+    close(fd);
+    *hash = h;
+    *size = total;
+    return ok;
+}
+
+static size_t slotOf(const OutputIndex* index, const char* path) {
+    return (size_t)hashString(FNV_OFFSET, path) & index->slot_mask;
+}
+
+static IndexEntry* findEntry(const OutputIndex* index, const char* path) {
+    if (!index->slots) {
+        return NULL;
+    }
+    for (size_t s = slotOf(index, path); index->slots[s]; s = (s + 1) & index->slot_mask) {
+        IndexEntry* e = &index->entries[index->slots[s] - 1];
+        if (strcmp(e->path, path) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+// Grow the index to hold capacity entries and rehash them.
+static int growIndex(OutputIndex* index, int capacity) {
+    IndexEntry* entries = (IndexEntry*)realloc(index->entries, capacity * sizeof(IndexEntry));
+    int* slots = (int*)calloc((size_t)capacity * 2, sizeof(int));
+    if (!entries || !slots) {
+        if (entries) index->entries = entries;
+        free(slots);
+        return 0;
+    }
+    index->entries = entries;
+    index->capacity = capacity;
+    free(index->slots);
+    index->slots = slots;
+    index->slot_mask = (size_t)capacity * 2 - 1;
+    for (int i = 0; i < index->count; i++) {
+        size_t s = slotOf(index, index->entries[i].path);
+        while (index->slots[s]) s = (s + 1) & index->slot_mask;
+        index->slots[s] = i + 1;
+    }
+    return 1;
+}
+
+// Make room for count more entries up front, so a run that adds them does
+// not grow the index part way through.
+int reserveOutputIndex(OutputIndex* index, int count) {
+    int capacity = index->capacity ? index->capacity : 256;
+    while (capacity - index->count < count) {
+        capacity *= 2;
+    }
+    return capacity == index->capacity || growIndex(index, capacity);
+}
+
+// Entry for path, added if new. NULL when out of memory.
+static IndexEntry* addEntry(OutputIndex* index, const char* path) {
+    IndexEntry* e = findEntry(index, path);
+    if (e) {
+        return e;
+    }
+
+    if (index->count == index->capacity &&
+        !growIndex(index, index->capacity ? index->capacity * 2 : 256)) {
+        return NULL;
+    }
+
+    e = &index->entries[index->count++];
+    memset(e, 0, sizeof(*e));
+    strcpy(e->path, path);
+    size_t s = slotOf(index, path);
+    while (index->slots[s]) s = (s + 1) & index->slot_mask;
+    index->slots[s] = index->count;
+    return e;
+}
+
+// Load the index, a missing file is an empty index.
+int loadOutputIndex(const char* filename, OutputIndex* index) {
+    memset(index, 0, sizeof(*index));
+    if (strlen(filename) >= sizeof(index->file)) {
+        fprintf(stderr, "Error: Index file name too long: %s\n", filename);
+        return 0;
+    }
+    strcpy(index->file, filename);
+
+    FILE* fp = fopen(filename, "r");
+    if (!fp) {
+        return 1;
+    }
+
+    char line[OUTPUT_PATH_MAX + 64];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned long long key, hash, size;
+        int path_start = 0;
+        line_no++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '#' || !line[0]) {
+            continue;
+        }
+        if (sscanf(line, "%16llx %16llx %llu %n", &key, &hash, &size, &path_start) != 3 ||
+            !path_start || !line[path_start] || strlen(line + path_start) >= OUTPUT_PATH_MAX) {
+            fprintf(stderr, "Warning: %s line %d ignored\n", filename, line_no);
+            continue;
+        }
+        IndexEntry* e = addEntry(index, line + path_start);
+        if (!e) {
+            perror("Error allocating memory for output index");
+            fclose(fp);
+            freeOutputIndex(index);
+            return 0;
+        }
+        e->key = key;
+        e->hash = hash;
+        e->size = size;
+    }
+    fclose(fp);
+    return 1;
+}
+
+// Write the index back if it changed, through a temporary file.
+int saveOutputIndex(OutputIndex* index) {
+    if (!index->dirty) {
+        return 1;
+    }
+
+    char tmp[OUTPUT_PATH_MAX + 16];
+    getTempName(index->file, tmp, sizeof(tmp));
+    FILE* fp = fopen(tmp, "w");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open file %s for writing\n", tmp);
+        return 0;
+    }
+    fprintf(fp, "# tcgen %s output index: key, content hash, size, path\n", VERSION_STRING);
+    for (int i = 0; i < index->count; i++) {
+        const IndexEntry* e = &index->entries[i];
+        fprintf(fp, "%016llx %016llx %llu %s\n", (unsigned long long)e->key,
+                (unsigned long long)e->hash, (unsigned long long)e->size, e->path);
+    }
+    int ok = !ferror(fp);
+    ok &= fclose(fp) == 0;
+
+#ifdef _WIN32
+    remove(index->file);
+#endif
+    if (!ok || rename(tmp, index->file) != 0) {
+        fprintf(stderr, "Error: Could not write output index %s\n", index->file);
+        remove(tmp);
+        return 0;
+    }
+    index->dirty = false;
+    return 1;
+}
+
+void freeOutputIndex(OutputIndex* index) {
+    free(index->entries);
+    free(index->slots);
+    index->entries = NULL;
+    index->slots = NULL;
+    index->count = index->capacity = 0;
+}
+
+// True if path was written for key and still has the content written then.
+bool isOutputCurrent(const OutputIndex* index, uint64_t key, const char* path) {
+    const IndexEntry* e = findEntry(index, path);
+    uint64_t hash, size;
+    return e && e->key == key && hashFile(path, &hash, &size) && size == e->size && hash == e->hash;
+}
+
+// Temporary name next to path, so the rename stays on one file system.
+const char* getTempName(const char* path, char* tmp, size_t tmp_size) {
+    snprintf(tmp, tmp_size, "%s.tmp%ld", path, (long)getpid());
+    return tmp;
+}
+
+// Put a freshly written temporary in place of path, unless path already
+// holds the same content. The index records the key and content either way.
+int commitOutputFile(OutputIndex* index, uint64_t key, const char* tmp, const char* path) {
+    uint64_t hash, size, old_hash, old_size;
+
+    if (!hashFile(tmp, &hash, &size)) {
+        fprintf(stderr, "Error: Could not read back %s\n", tmp);
+        remove(tmp);
+        return 0;
+    }
+
+    if (hashFile(path, &old_hash, &old_size) && old_size == size && old_hash == hash) {
+        remove(tmp);
+        index->unchanged++;
+    } else {
+#ifdef _WIN32
+        remove(path);
+#endif
+        if (rename(tmp, path) != 0) {
+            fprintf(stderr, "Error: Could not replace %s\n", path);
+            remove(tmp);
+            return 0;
+        }
+        index->written++;
+    }
+
+    IndexEntry* e = addEntry(index, path);
+    if (!e) {
+        perror("Error allocating memory for output index");
+        return 0;
+    }
+    if (e->key != key || e->hash != hash || e->size != size) {
+        e->key = key;
+        e->hash = hash;
+        e->size = size;
+        index->dirty = true;
+    }
+    return 1;
+}
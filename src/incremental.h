@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ incremental.h  include for incremental.c
+ */
+
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include "output.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define INDEX_FILE_DEFAULT  ".tcgen_index"     // In the current directory
+
+// One output file as last written
+typedef struct {
+    uint64_t key;                   // Input key of the job that wrote it
+    uint64_t hash;                  // FNV-1a of the file content
+    uint64_t size;
+    char     path[OUTPUT_PATH_MAX];
+} IndexEntry;
+
+// Output index, entries found by path through an open addressing table.
+typedef struct {
+    char        file[OUTPUT_PATH_MAX];
+    IndexEntry* entries;
+    int         count;
+    int         capacity;
+    int*        slots;              // Entry number + 1, 0 is empty
+    size_t      slot_mask;
+    bool        dirty;
+    int         written;            // Files replaced this run
+    int         unchanged;          // Files regenerated with the same content
+} OutputIndex;
+
+// Incremental output functions
+int loadOutputIndex(const char* filename, OutputIndex* index);
+int saveOutputIndex(OutputIndex* index);
+void freeOutputIndex(OutputIndex* index);
+int reserveOutputIndex(OutputIndex* index, int count);
+uint64_t getOutputKey(const char* id_text, bool debug, bool label, const HexOptions* hex);
+bool isOutputCurrent(const OutputIndex* index, uint64_t key, const char* path);
+const char* getTempName(const char* path, char* tmp, size_t tmp_size);
+int commitOutputFile(OutputIndex* index, uint64_t key, const char* tmp, const char* path);
+
+#endif // INCREMENTAL_H
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ layout.c  banked images for larger EPROMs (27C128 up).
+
+ Units modified with a bank select switch on the upper address lines run
+ from a larger EPROM holding several complete 8K images, one per switch
+ position. A layout file lists the ID of each bank in order, one per line:
+
+    # Bank 0 up
+    VK3DG GEELONG
+    "VK3EHT"
+    VK3XKA_FIELD
+
+ Blank lines and lines starting with '#' are ignored, quotes and
+ underscores are handled as for -t. Every bank is the shared base image
+ with its own text rows, generated on -j threads.
+ */
+
+#include "layout.h"
+#include "batch.h"
+#include "tcgen.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+
+static const EpromDevice eprom_devices[] = {
+    { "27C64",   0x02000 },
+    { "27C128",  0x04000 },
+    { "27C256",  0x08000 },
+    { "27C512",  0x10000 },
+    { "27C010",  0x20000 },
+    { "27C020",  0x40000 },
+};
+
+#define NUM_DEVICES  (int)(sizeof(eprom_devices) / sizeof(eprom_devices[0]))
+
+_Static_assert(0x40000 / EPROM_SIZE == LAYOUT_MAX_BANKS, "largest device must hold LAYOUT_MAX_BANKS banks");
+
+// Device by part name, case insensitive, NULL if unknown.
+const EpromDevice* findEpromDevice(const char* name) {
+    for (int i = 0; i < NUM_DEVICES; i++) {
+        if (strcasecmp(name, eprom_devices[i].name) == 0) {
+            return &eprom_devices[i];
+        }
+    }
+    return NULL;
+}
+
+int getDeviceBanks(const EpromDevice* device) {
+    return (int)(device->size / EPROM_SIZE);
+}
+
+// Device list for the usage text.
+void printEpromDevices(FILE* fp) {
+    for (int i = 0; i < NUM_DEVICES; i++) {
+        int banks = getDeviceBanks(&eprom_devices[i]);
+        fprintf(fp, "  %-8s %3u K, %2d bank%s\n", eprom_devices[i].name, eprom_devices[i].size / 1024, banks,
+                banks == 1 ? "" : "s");
+    }
+}
+
+// Read the bank IDs of filename. device_name picks the part, NULL takes the
+// smallest one that holds every bank.
+int loadLayoutFile(const char* filename, const char* device_name, EpromLayout* layout) {
+    memset(layout, 0, sizeof(*layout));
+
+    FILE* fp = fopen(filename, "r");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open layout %s\n", filename);
+        return 0;
+    }
+
+    char line[MANIFEST_LINE_MAX];
+    int line_no = 0;
+    int ok = 1;
+    while (ok && fgets(line, sizeof(line), fp)) {
+        line_no++;
+
+        char* p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        size_t len = strcspn(p, "\r\n");
+        while (len > 0 && (p[len-1] == ' ' || p[len-1] == '\t')) len--;
+        p[len] = '\0';
+        if (!*p || *p == '#') {
+            continue;
+        }
+
+        char text[MANIFEST_LINE_MAX];
+        normalizeIdText(p, text, sizeof(text));
+        if (layout->banks == LAYOUT_MAX_BANKS) {
+            fprintf(stderr, "Error: Layout line %d: more than %d banks\n", line_no, LAYOUT_MAX_BANKS);
+            ok = 0;
+        } else if (!text[0] || !validateText(text)) {
+            fprintf(stderr, "Error: Layout line %d: invalid ID text\n", line_no);
+            ok = 0;
+        } else {
+            strcpy(layout->id_text[layout->banks++], text);
+        }
+    }
+    fclose(fp);
+
+    if (!ok) {
+        return 0;
+    }
+    if (layout->banks == 0) {
+        fprintf(stderr, "Error: Layout %s lists no banks\n", filename);
+        return 0;
+    }
+
+    if (device_name) {
+        layout->device = findEpromDevice(device_name);
+        if (!layout->device) {
+            fprintf(stderr, "Error: Unknown device %s\n", device_name);
+            return 0;
+        }
+    } else {
+        for (int i = 0; i < NUM_DEVICES && !layout->device; i++) {
+            if (getDeviceBanks(&eprom_devices[i]) >= layout->banks) {
+                layout->device = &eprom_devices[i];
+            }
+        }
+    }
+
+    if (getDeviceBanks(layout->device) < layout->banks) {
+        int banks = getDeviceBanks(layout->device);
+        fprintf(stderr, "Error: %d banks do not fit a %s (%d bank%s)\n", layout->banks,
+                layout->device->name, banks, banks == 1 ? "" : "s");
+        return 0;
+    }
+    return 1;
+}
+
+// Banks first, first + step ... of the listed IDs, for one thread.
+typedef struct {
+    const EpromLayout* layout;
+    uint8_t* image;
+    int first;
+    int step;
+    bool ok;
+    bool started;                   // Running on its own thread
+    pthread_t thread;
+} BankWorker;
+
+static void* generateBanks(void* arg) {
+    BankWorker* worker = (BankWorker*)arg;
+    worker->ok = true;
+    for (int b = worker->first; b < worker->layout->banks; b += worker->step) {
+        worker->ok &= generateEpromData(worker->image + (size_t)b * EPROM_SIZE, NULL,
+                                        worker->layout->id_text[b]);
+    }
+    return NULL;
+}
+
+// Fill image (layout->device->size bytes) with every bank, on up to threads
+// threads (0 = one per CPU).
+int generateLayoutImage(const EpromLayout* layout, uint8_t* image, int threads) {
+    BankWorker workers[LAYOUT_MAX_BANKS];
+
+    if (threads <= 0) {
+        threads = getProcessorCount();
+    }
+    if (threads > layout->banks) {
+        threads = layout->banks;
+    }
+
+    // Worker 0, and any that cannot be started, run on this thread.
+    memset(workers, 0, sizeof(workers));
+    for (int t = 0; t < threads; t++) {
+        workers[t].layout = layout;
+        workers[t].image = image;
+        workers[t].first = t;
+        workers[t].step = threads;
+        workers[t].started = t > 0 && pthread_create(&workers[t].thread, NULL, generateBanks, &workers[t]) == 0;
+    }
+    for (int t = 0; t < threads; t++) {
+        if (!workers[t].started) {
+            generateBanks(&workers[t]);
+        }
+    }
+
+    int ok = 1;
+    for (int t = 0; t < threads; t++) {
+        if (workers[t].started) {
+            pthread_join(workers[t].thread, NULL);
+        }
+        ok &= workers[t].ok;
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: Pattern generation failed\n");
+        return 0;
+    }
+
+    // Banks past the list repeat it.
+    for (int b = layout->banks; b < getDeviceBanks(layout->device); b++) {
+        memcpy(image + (size_t)b * EPROM_SIZE, image + (size_t)(b % layout->banks) * EPROM_SIZE, EPROM_SIZE);
+    }
+    return 1;
+}
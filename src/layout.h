@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ layout.h  include for layout.c
+ */
+
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include "patterns.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define LAYOUT_MAX_BANKS  32        // 27C020, 32 x 8K
+
+// EPROM part a layout is programmed into
+typedef struct {
+    const char* name;               // "27C256"
+    uint32_t    size;               // Bytes, a whole number of EPROM_SIZE banks
+} EpromDevice;
+
+// Banked image: bank b is a complete 8K image at b * EPROM_SIZE, picked by
+// the bank select switch on A13 and up. Banks past the listed IDs repeat
+// the list, as the switch sees them with unused select lines left floating.
+typedef struct {
+    const EpromDevice* device;
+    int  banks;                                         // IDs listed, 1 to device banks
+    char id_text[LAYOUT_MAX_BANKS][MAX_TEXT_LENGTH + 1];
+} EpromLayout;
+
+// Layout functions
+const EpromDevice* findEpromDevice(const char* name);
+int getDeviceBanks(const EpromDevice* device);
+int loadLayoutFile(const char* filename, const char* device_name, EpromLayout* layout);
+int generateLayoutImage(const EpromLayout* layout, uint8_t* image, int threads);
+void printEpromDevices(FILE* fp);
+
+#endif // LAYOUT_H
@@ -0,0 +1,444 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ live.c  live ID text (tcgen --live), a clock or changing caption sent to
+         an EPROM emulator as the bytes that changed, not the whole 8K.
+
+ The image stays resident with the packed text mask it was built from. A
+ new text is rasterized to a mask (7 rows of 128 bits) and XORed with the
+ old one, only the pixels that differ are blended again and copied to the
+ six text row copies. A clock second changing one digit is a 5 pixel span
+ in each of 7 rows, six times over. Characters keep their cell as long as
+ the advances before them do, a narrow '1' coming or going moves the rest
+ of the line and the delta grows to match.
+
+ tcgen --emulate is a stand-in for the emulator: it applies each frame to
+ its own copy and checks it against a full generateEpromData() of the
+ frame's text.
+
+ Wire format is in live.h.
+ */
+
+#include "live.h"
+#include "encoder.h"
+#include "blend.h"
+#include "tcgen.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#endif
+
+static const int text_sections[] = { PATTERN_BARS, PATTERN_RED, PATTERN_PULSE };
+
+// Image and mask for text.
+void initLiveImage(LiveImage* live, const char* text) {
+    memset(live, 0, sizeof(*live));
+    generateEpromData(live->image, NULL, text);
+    rasterizeText(text, &live->mask);
+    snprintf(live->text, sizeof(live->text), "%s", text);
+}
+
+// Changed pixel spans of one row, spans closer than LIVE_MERGE_GAP joined.
+static int findSpans(const uint64_t diff[2], uint8_t starts[], uint8_t ends[]) {
+    int count = 0;
+    for (int p = 0; p < PIXELS_PER_LINE; p++) {
+        if (!((diff[p / 64] >> (p % 64)) & 1)) {
+            continue;
+        }
+        if (count && p - ends[count - 1] <= LIVE_MERGE_GAP) {
+            ends[count - 1] = (uint8_t)(p + 1);
+        } else {
+            starts[count] = (uint8_t)p;
+            ends[count] = (uint8_t)(p + 1);
+            count++;
+        }
+    }
+    return count;
+}
+
+// Move the image to text, delta receives the changed ranges. Returns the
+// number of changed bytes.
+int updateLiveImage(LiveImage* live, const char* text, LiveDelta* delta) {
+    const uint8_t* base = getBaseImage();
+    uint8_t starts[TEXT_BITMAP_HEIGHT][PIXELS_PER_LINE / 2];
+    uint8_t ends[TEXT_BITMAP_HEIGHT][PIXELS_PER_LINE / 2];
+    int spans[TEXT_BITMAP_HEIGHT];
+    TextMask mask;
+
+    delta->range_count = 0;
+    delta->bytes = 0;
+    rasterizeText(text, &mask);
+    snprintf(live->text, sizeof(live->text), "%s", text);
+
+    // New rows in the colour bar block, only where the mask changed.
+    for (int line = 0; line < TEXT_BITMAP_HEIGHT; line++) {
+        uint64_t diff[2] = { live->mask.rows[line][0] ^ mask.rows[line][0],
+                             live->mask.rows[line][1] ^ mask.rows[line][1] };
+        spans[line] = findSpans(diff, starts[line], ends[line]);
+        if (spans[line]) {
+            int offset = PATTERN_BARS + TEXT_START + line * 256;
+            uint8_t row[PIXELS_PER_LINE];
+            blendTextRow(row, base + offset, mask.rows[line]);
+            for (int s = 0; s < spans[line]; s++) {
+                memcpy(live->image + offset + starts[line][s], row + starts[line][s], ends[line][s] - starts[line][s]);
+            }
+        }
+    }
+    live->mask = mask;
+
+    // Copies in address order, the colour bar rows themselves included.
+    for (int section = 0; section < 3; section++) {
+        for (int line = 0; line < TEXT_BITMAP_HEIGHT; line++) {
+            const uint8_t* row = live->image + PATTERN_BARS + TEXT_START + line * 256;
+            for (int field = 0; field < 2; field++) {
+                int offset = text_sections[section] + TEXT_START + line * 256 + field * 128;
+                for (int s = 0; s < spans[line]; s++) {
+                    int length = ends[line][s] - starts[line][s];
+                    if (live->image + offset != row) {
+                        memcpy(live->image + offset + starts[line][s], row + starts[line][s], length);
+                    }
+                    LiveRange range = { (uint16_t)(offset + starts[line][s]), (uint16_t)length };
+                    delta->ranges[delta->range_count++] = range;
+                    delta->bytes += length;
+                }
+            }
+        }
+    }
+    return delta->bytes;
+}
+
+static void putBe16(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static void putBe32(uint8_t* p, uint32_t v) {
+    putBe16(p, v >> 16);
+    putBe16(p + 2, v);
+}
+
+static uint32_t getBe16(const uint8_t* p) {
+    return (uint32_t)p[0] << 8 | p[1];
+}
+
+static uint32_t getBe32(const uint8_t* p) {
+    return getBe16(p) << 16 | getBe16(p + 2);
+}
+
+// Append the frame for delta, NULL sends the whole image.
+int formatLiveFrame(LiveImage* live, const LiveDelta* delta, OutputBuffer* out) {
+    size_t text_length = strlen(live->text);
+    int count = delta ? delta->range_count : 1;
+    size_t size = 11 + text_length + (size_t)count * 4 + (delta ? (size_t)delta->bytes : EPROM_SIZE);
+
+    uint8_t* p = (uint8_t*)reserveOutputBuffer(out, size);
+    if (!p) {
+        return 0;
+    }
+    putBe32(p, LIVE_MAGIC);
+    putBe32(p + 4, live->sequence++);
+    p[8] = (uint8_t)text_length;
+    memcpy(p + 9, live->text, text_length);
+    p += 9 + text_length;
+    putBe16(p, count);
+    p += 2;
+    for (int i = 0; i < count; i++) {
+        LiveRange range = { 0, EPROM_SIZE };
+        if (delta) {
+            range = delta->ranges[i];
+        }
+        putBe16(p, range.addr);
+        putBe16(p + 2, range.length);
+        memcpy(p + 4, live->image + range.addr, range.length);
+        p += 4 + range.length;
+    }
+    out->length += size;
+    return 1;
+}
+
+// Whole buffer to fd, across partial writes.
+static int writeFrame(int fd, const char* data, size_t size) {
+    while (size) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        data += n;
+        size -= (size_t)n;
+    }
+    return 1;
+}
+
+// Exactly size bytes from fd. Returns 0 at end of stream before any byte,
+// -1 on an error or a stream ending part way.
+static int readFrame(int fd, uint8_t* data, size_t size) {
+    size_t got = 0;
+    while (got < size) {
+        ssize_t n = read(fd, data + got, size - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            return got == 0 && n == 0 ? 0 : -1;
+        }
+        got += (size_t)n;
+    }
+    return 1;
+}
+
+#ifndef _WIN32
+static int openLiveSocket(const char* socket_path, bool listening) {
+    struct sockaddr_un addr;
+    struct stat st;
+
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: Socket path too long: %s\n", socket_path);
+        return -1;
+    }
+    if (listening && stat(socket_path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "Error: %s exists and is not a socket\n", socket_path);
+            return -1;
+        }
+        unlink(socket_path);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("Error creating socket");
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+    if (!listening) {
+        if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            fprintf(stderr, "Error: Could not connect to %s: %s\n", socket_path, strerror(errno));
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // The emulator takes one stream.
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 1) < 0) {
+        fprintf(stderr, "Error: Could not listen on %s: %s\n", socket_path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    fprintf(stderr, "Waiting for a live stream on %s\n", socket_path);
+    int conn = accept(fd, NULL, NULL);
+    if (conn < 0) {
+        perror("Error accepting connection");
+    }
+    close(fd);
+    unlink(socket_path);
+    return conn;
+}
+#else
+static int openLiveSocket(const char* socket_path, bool listening) {
+    (void)socket_path;
+    (void)listening;
+    fprintf(stderr, "Error: Live streams over sockets are not supported on Windows, use a pipe\n");
+    return -1;
+}
+#endif
+
+// Sleep to the next whole second of the wall clock, the clock ticks with it.
+static void waitNextSecond(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+#ifndef _WIN32
+    struct timespec wait = { 0, 1000000000L - now.tv_nsec };
+    while (nanosleep(&wait, &wait) < 0 && errno == EINTR) {
+    }
+#else
+    usleep((1000000000L - now.tv_nsec) / 1000);
+#endif
+}
+
+// Next text: the local time for a clock, else the next valid caption line
+// from stdin. Returns 0 at the end of the captions.
+static int nextLiveText(bool clock, char* text) {
+    if (clock) {
+        // Same clock as waitNextSecond(), time() can still read the last second.
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        time_t now = ts.tv_sec;
+        struct tm local;
+#ifndef _WIN32
+        localtime_r(&now, &local);
+#else
+        local = *localtime(&now);
+#endif
+        strftime(text, MAX_TEXT_LENGTH + 1, "%H:%M:%S", &local);
+        return 1;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), stdin)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        normalizeIdText(line, text, MAX_TEXT_LENGTH + 1);
+        if (validateText(text)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Stream the clock or the captions to target. frames 0 runs until the
+// captions end or the reader goes away.
+int runLiveStream(const char* target, bool clock, long frames) {
+    static LiveImage live;
+    static LiveDelta delta;
+    char text[MAX_TEXT_LENGTH + 1];
+
+    int fd = strcmp(target, "-") == 0 ? STDOUT_FILENO : openLiveSocket(target, false);
+    if (fd < 0) {
+        return 0;
+    }
+#ifdef SIGPIPE
+    // The emulator going away ends the stream, it is not an error.
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    OutputBuffer out = { 0 };
+    long sent = 0;
+    uint64_t wire_bytes = 0;
+    int ok = 1;
+    while ((frames == 0 || sent < frames) && nextLiveText(clock, text)) {
+        out.length = 0;
+        if (sent == 0) {
+            initLiveImage(&live, text);
+            ok = formatLiveFrame(&live, NULL, &out);
+        } else {
+            updateLiveImage(&live, text, &delta);
+            ok = formatLiveFrame(&live, &delta, &out);
+        }
+        if (!ok) {
+            perror("Error allocating memory for live frame");
+            break;
+        }
+        if (!writeFrame(fd, out.data, out.length)) {
+            ok = (errno == EPIPE);
+            break;
+        }
+        if (!quiet_enabled) {
+            fprintf(stderr, "Frame %ld  %-14s  %zu bytes\n", sent, text, out.length);
+        }
+        wire_bytes += out.length;
+        sent++;
+        if (clock && (frames == 0 || sent < frames)) {
+            waitNextSecond();
+        }
+    }
+
+    if (sent && !quiet_enabled) {
+        fprintf(stderr, "Sent %ld frames, %llu bytes (%llu as whole images)\n", sent,
+                (unsigned long long)wire_bytes, (unsigned long long)sent * EPROM_SIZE);
+    }
+    freeOutputBuffer(&out);
+    if (fd != STDOUT_FILENO) {
+        close(fd);
+    }
+    return ok;
+}
+
+// Apply every frame from source and check the copy against a full
+// regeneration of the frame's text. Returns 0 on a bad frame or a mismatch.
+int runLiveEmulator(const char* source) {
+    static uint8_t image[EPROM_SIZE];
+    static uint8_t expected[EPROM_SIZE];
+    uint8_t header[9];
+    char text[256];
+    bool loaded = false;
+    bool truncated = false;
+    long frames = 0;
+    int ok = 1;
+
+    int fd = strcmp(source, "-") == 0 ? STDIN_FILENO : openLiveSocket(source, true);
+    if (fd < 0) {
+        return 0;
+    }
+
+    int got = 0;
+    while (ok && (got = readFrame(fd, header, sizeof(header))) > 0) {
+        uint8_t count_bytes[2];
+        uint32_t sequence = getBe32(header + 4);
+        size_t text_length = header[8];
+        if (getBe32(header) != LIVE_MAGIC) {
+            fprintf(stderr, "Error: Not a live frame at frame %ld\n", frames + 1);
+            ok = 0;
+            break;
+        }
+        if (readFrame(fd, (uint8_t*)text, text_length) <= 0 || readFrame(fd, count_bytes, 2) <= 0) {
+            truncated = true;
+            break;
+        }
+        text[text_length] = '\0';
+
+        uint32_t count = getBe16(count_bytes);
+        uint32_t bytes = 0;
+        for (uint32_t i = 0; ok && i < count; i++) {
+            uint8_t range[4];
+            if (readFrame(fd, range, 4) <= 0) {
+                truncated = true;
+                break;
+            }
+            uint32_t addr = getBe16(range), length = getBe16(range + 2);
+            if (addr + length > EPROM_SIZE) {
+                fprintf(stderr, "Error: Frame %u range 0x%04X+%u is outside the image\n",
+                        (unsigned)sequence, (unsigned)addr, (unsigned)length);
+                ok = 0;
+            } else if (readFrame(fd, image + addr, length) <= 0) {
+                truncated = true;
+                break;
+            }
+            loaded |= (addr == 0 && length == EPROM_SIZE);
+            bytes += length;
+        }
+        if (!ok || truncated) {
+            break;
+        }
+        frames++;
+
+        generateEpromData(expected, NULL, text);
+        bool same = loaded && memcmp(image, expected, EPROM_SIZE) == 0;
+        printf("Frame %u  %-14s  %3u ranges %5u bytes  %s\n", (unsigned)sequence, text, (unsigned)count,
+               (unsigned)bytes, same ? "OK" : "MISMATCH");
+        fflush(stdout);
+        ok = same;
+    }
+    if (got < 0 || truncated) {
+        fprintf(stderr, "Error: Live stream ended part way through a frame\n");
+        ok = 0;
+    }
+
+    printf("%ld frames applied, %s\n", frames, ok ? "image matches a full regeneration" : "FAILED");
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+    return ok;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ live.h  include for live.c
+
+ Wire format, all integers big endian:
+   frame  u32 LIVE_MAGIC, u32 sequence, u8 text length, the ID text,
+          u16 range count, then per range u16 address, u16 length, length
+          bytes of image data
+ The first frame of a stream is the whole image as one range, every later
+ frame only the bytes its text changed (no ranges if nothing changed).
+ */
+
+#ifndef LIVE_H
+#define LIVE_H
+
+#include "patterns.h"
+#include "output.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LIVE_MAGIC        0x50544C56u   // "PTLV"
+#define LIVE_MERGE_GAP    4             // Unchanged bytes a range spans rather than split, one range header
+#define LIVE_TEXT_COPIES  6             // Text row copies, 3 patterns x 2 fields
+#define LIVE_MAX_RANGES   (TEXT_BITMAP_HEIGHT * LIVE_TEXT_COPIES * PIXELS_PER_LINE / 2)
+
+// Changed image bytes [addr, addr + length)
+typedef struct {
+    uint16_t addr;
+    uint16_t length;
+} LiveRange;
+
+// Ranges of one update, ascending address
+typedef struct {
+    int       range_count;
+    int       bytes;
+    LiveRange ranges[LIVE_MAX_RANGES];
+} LiveDelta;
+
+// Resident image and the text mask it was built from
+typedef struct {
+    uint8_t  image[EPROM_SIZE];
+    TextMask mask;
+    char     text[MAX_TEXT_LENGTH + 1];
+    uint32_t sequence;                  // Frames formatted so far
+} LiveImage;
+
+// Live image functions
+void initLiveImage(LiveImage* live, const char* text);
+int updateLiveImage(LiveImage* live, const char* text, LiveDelta* delta);
+int formatLiveFrame(LiveImage* live, const LiveDelta* delta, OutputBuffer* out);
+
+// Live stream and the emulator stand-in that receives it, "-" is stdout or
+// stdin, anything else a Unix socket the emulator listens on
+int runLiveStream(const char* target, bool clock, long frames);
+int runLiveEmulator(const char* source);
+
+#endif // LIVE_H
@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ loader.c  reads EPROM images back from Intel HEX and binary files, such as
+           the vendor eprom/AM27C64.hex, field dumps and earlier tcgen output.
+
+ Intel HEX is parsed in one pass over the file contents with every record
+ checksum verified. Record types 00 (data), 01 (end of file), 02 (extended
+ segment address) and 04 (extended linear address) are handled, 03 and 05
+ (start address) are ignored. Bytes not covered by any record read as 0xFF
+ like an erased EPROM. Binary files are mapped read only where possible.
+ */
+
+#include "loader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+// ASCII hex digit value, -1 for anything else.
+static inline int hexValue(unsigned char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Read a whole file into a malloc'd buffer.
+static char* readWholeFile(const char* filename, size_t* length) {
+    int fd = open(filename, O_RDONLY | O_BINARY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not open file %s for reading\n", filename);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        fprintf(stderr, "Error: Could not stat file %s\n", filename);
+        close(fd);
+        return NULL;
+    }
+
+    char* buffer = (char*)malloc((size_t)st.st_size + 1);
+    if (!buffer) {
+        perror("Error allocating memory for file");
+        close(fd);
+        return NULL;
+    }
+
+    size_t total = 0;
+    while (total < (size_t)st.st_size) {
+        ssize_t n = read(fd, buffer + total, (size_t)st.st_size - total);
+        if (n <= 0) break;
+        total += (size_t)n;
+    }
+    close(fd);
+
+    buffer[total] = '\0';
+    *length = total;
+    return buffer;
+}
+
+// Make sure image holds at least size bytes, new space reads as erased.
+static int growImage(LoadedImage* image, size_t* capacity, size_t size) {
+    if (size > LOADER_MAX_SIZE) {
+        return 0;
+    }
+    if (size > *capacity) {
+        size_t grown = *capacity ? *capacity : 0x2000;
+        while (grown < size) grown *= 2;
+        if (grown > LOADER_MAX_SIZE) grown = LOADER_MAX_SIZE;
+
+        uint8_t* data = (uint8_t*)realloc(image->data, grown);
+        if (!data) {
+            return 0;
+        }
+        memset(data + *capacity, ERASED_BYTE, grown - *capacity);
+        image->data = data;
+        *capacity = grown;
+    }
+    if (size > image->size) {
+        image->size = size;
+    }
+    return 1;
+}
+
+// Load an Intel HEX file.
+int loadHexFile(const char* filename, LoadedImage* image) {
+    size_t length = 0;
+    char* text = readWholeFile(filename, &length);
+    if (!text) {
+        return 0;
+    }
+
+    memset(image, 0, sizeof(*image));
+    size_t capacity = 0;
+    uint32_t base = 0;
+    int line = 0;
+    bool eof = false;
+    const char* p = text;
+    const char* end = text + length;
+    uint8_t record[5 + 255];
+
+    while (p < end && !eof) {
+        // Skip line endings and blank space between records.
+        while (p < end && (*p == '\r' || *p == '\n' || *p == ' ' || *p == '\t')) {
+            if (*p == '\n') line++;
+            p++;
+        }
+        if (p >= end) break;
+
+        if (*p != ':') {
+            fprintf(stderr, "Error: %s line %d: record does not start with ':'\n", filename, line + 1);
+            goto fail;
+        }
+        p++;
+
+        // Decode header (count, address, type) then data and checksum.
+        int count = -1;
+        int decoded = 0;
+        uint8_t checksum = 0;
+        while (count < 0 || decoded < count + 5) {
+            if (p + 1 >= end) {
+                fprintf(stderr, "Error: %s line %d: truncated record\n", filename, line + 1);
+                goto fail;
+            }
+            int hi = hexValue((unsigned char)p[0]);
+            int lo = hexValue((unsigned char)p[1]);
+            if (hi < 0 || lo < 0) {
+                fprintf(stderr, "Error: %s line %d: invalid hex digit\n", filename, line + 1);
+                goto fail;
+            }
+            p += 2;
+            record[decoded] = (uint8_t)((hi << 4) | lo);
+            checksum += record[decoded];
+            if (decoded == 0) count = record[0];
+            decoded++;
+        }
+
+        if (checksum != 0) {
+            fprintf(stderr, "Error: %s line %d: checksum mismatch\n", filename, line + 1);
+            goto fail;
+        }
+
+        uint16_t addr = (uint16_t)((record[1] << 8) | record[2]);
+        uint8_t type = record[3];
+        const uint8_t* data = record + 4;
+
+        switch (type) {
+            case 0x00: {
+                uint32_t start = base + addr;
+                if (!growImage(image, &capacity, (size_t)start + count)) {
+                    fprintf(stderr, "Error: %s line %d: address 0x%X beyond %d bytes\n",
+                            filename, line + 1, start + count, LOADER_MAX_SIZE);
+                    goto fail;
+                }
+                memcpy(image->data + start, data, count);
+                break;
+            }
+            case 0x01:
+                eof = true;
+                break;
+            case 0x02:
+                if (count != 2) goto bad_length;
+                base = (uint32_t)((data[0] << 8) | data[1]) << 4;
+                break;
+            case 0x04:
+                if (count != 2) goto bad_length;
+                base = (uint32_t)((data[0] << 8) | data[1]) << 16;
+                break;
+            case 0x03:
+            case 0x05:
+                break;
+            default:
+                fprintf(stderr, "Error: %s line %d: unsupported record type %02X\n", filename, line + 1, type);
+                goto fail;
+        }
+    }
+
+    if (!eof) {
+        fprintf(stderr, "Warning: %s has no end of file record\n", filename);
+    }
+    if (image->size == 0) {
+        fprintf(stderr, "Error: %s contains no data records\n", filename);
+        goto fail;
+    }
+
+    free(text);
+    return 1;
+
+bad_length:
+    fprintf(stderr, "Error: %s line %d: bad address record length\n", filename, line + 1);
+fail:
+    free(text);
+    free(image->data);
+    memset(image, 0, sizeof(*image));
+    return 0;
+}
+
+// Load a raw binary file, mapped read only where the platform allows.
+int loadBinFile(const char* filename, LoadedImage* image) {
+    memset(image, 0, sizeof(*image));
+
+#ifndef _WIN32
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not open file %s for reading\n", filename);
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0 || st.st_size > LOADER_MAX_SIZE) {
+        fprintf(stderr, "Error: %s is empty or larger than %d bytes\n", filename, LOADER_MAX_SIZE);
+        close(fd);
+        return 0;
+    }
+
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map != MAP_FAILED) {
+        image->data = (uint8_t*)map;
+        image->size = (size_t)st.st_size;
+        image->mapped = true;
+        return 1;
+    }
+#endif
+
+    size_t length = 0;
+    char* buffer = readWholeFile(filename, &length);
+    if (!buffer) {
+        return 0;
+    }
+    if (length == 0 || length > LOADER_MAX_SIZE) {
+        fprintf(stderr, "Error: %s is empty or larger than %d bytes\n", filename, LOADER_MAX_SIZE);
+        free(buffer);
+        return 0;
+    }
+    image->data = (uint8_t*)buffer;
+    image->size = length;
+    return 1;
+}
+
+// Load by extension, .hex/.ihx/.ihex as Intel HEX, anything else as binary.
+int loadImageFile(const char* filename, LoadedImage* image) {
+    const char* ext = strrchr(filename, '.');
+    if (ext && (strcasecmp(ext, ".hex") == 0 || strcasecmp(ext, ".ihx") == 0 ||
+                strcasecmp(ext, ".ihex") == 0)) {
+        return loadHexFile(filename, image);
+    }
+    return loadBinFile(filename, image);
+}
+
+// Release an image from any of the loaders.
+void freeLoadedImage(LoadedImage* image) {
+    if (!image->data) {
+        return;
+    }
+#ifndef _WIN32
+    if (image->mapped) {
+        munmap(image->data, image->size);
+    } else
+#endif
+    {
+        free(image->data);
+    }
+    memset(image, 0, sizeof(*image));
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ loader.h  include for loader.c
+ */
+
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Largest image accepted from a file (27C080)
+#define LOADER_MAX_SIZE   0x100000
+
+// Unprogrammed EPROM bytes read as 0xFF
+#define ERASED_BYTE       0xFF
+
+// An image read back from a file
+typedef struct {
+    uint8_t* data;          // Image bytes
+    size_t   size;          // Bytes in the image (highest HEX address + 1)
+    bool     mapped;        // data is a read only mapping of a .bin file
+} LoadedImage;
+
+// Image loading functions
+int loadHexFile(const char* filename, LoadedImage* image);
+int loadBinFile(const char* filename, LoadedImage* image);
+int loadImageFile(const char* filename, LoadedImage* image);
+void freeLoadedImage(LoadedImage* image);
+
+#endif // LOADER_H
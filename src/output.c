@@ -19,180 +19,312 @@
 
 
 #include "output.h"
+#include "encoder.h"
 #include "patterns.h"
+#include "stats.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
 #include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+// Split an output file argument into "<dir>/<name>", any extension on the
+// file name is dropped. Directory is kept, "." when there is none.
+static int getOutputStem(const char* output_file, char* stem) {
+    char dir_name[OUTPUT_PATH_MAX];
+    char base_name[OUTPUT_PATH_MAX];
+
+    if (!output_file || !output_file[0] || strlen(output_file) >= OUTPUT_PATH_MAX) {
+        fprintf(stderr, "Error: Invalid output file name\n");
+        return 0;
+    }
+
+    // Split directory and file name, accept either separator.
+    const char* slash = strrchr(output_file, '/');
+    const char* backslash = strrchr(output_file, '\\');
+    if (backslash && (!slash || backslash > slash)) {
+        slash = backslash;
+    }
+
+    if (slash) {
+        size_t dir_len = (slash == output_file) ? 1 : (size_t)(slash - output_file);
+        memcpy(dir_name, output_file, dir_len);
+        dir_name[dir_len] = '\0';
+        strcpy(base_name, slash + 1);
+    } else {
+        strcpy(dir_name, ".");
+        strcpy(base_name, output_file);
+    }
+
+    // Remove file extension if happen to have one.
+    char* ext = strrchr(base_name, '.');
+    if (ext && ext != base_name) {
+        *ext = '\0';
+    }
+
+    if (!base_name[0]) {
+        fprintf(stderr, "Error: Output file name has no file part: %s\n", output_file);
+        return 0;
+    }
+
+    if (snprintf(stem, OUTPUT_PATH_MAX, "%s/%s", dir_name, base_name) >= OUTPUT_PATH_MAX) {
+        fprintf(stderr, "Error: Output file name too long: %s\n", output_file);
+        return 0;
+    }
+    return 1;
+}
+
+// Output file name with suffix (".hex", "_id.txt" ...) from an output file
+// argument, name must hold OUTPUT_PATH_MAX.
+int buildOutputName(const char* output_file, const char* suffix, char* name) {
+    char stem[OUTPUT_PATH_MAX];
+
+    if (!getOutputStem(output_file, stem)) {
+        return 0;
+    }
+    if (snprintf(name, OUTPUT_PATH_MAX, "%s%s", stem, suffix) >= OUTPUT_PATH_MAX) {
+        fprintf(stderr, "Error: Output file name too long: %s\n", output_file);
+        return 0;
+    }
+    return 1;
+}
+
+// Build the set of output file names from an output file argument.
+int buildOutputNames(const char* output_file, OutputNames* names) {
+    return buildOutputName(output_file, ".hex", names->hex) &&
+           buildOutputName(output_file, ".bin", names->bin) &&
+           buildOutputName(output_file, ".dump", names->dump) &&
+           buildOutputName(output_file, "_id.txt", names->text) &&
+           buildOutputName(output_file, "_eprom_label.html", names->label);
+}
+
+// Text files keep the platform line endings (no O_BINARY).
+static int openOutputFd(const char* filename, int flags) {
+    if (strcmp(filename, "-") == 0) {
+        return STDOUT_FILENO;
+    }
+    return open(filename, O_WRONLY | O_CREAT | O_TRUNC | flags, 0644);
+}
+
+static void closeOutputFd(int fd) {
+    if (fd != STDOUT_FILENO) {
+        close(fd);
+    }
+}
+
+// Write a whole buffer, retrying short writes.
+static int writeAll(int fd, const char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
 
 // Write binary file
 int writeBinFile(const uint8_t* data, int length, const char* filename) {
-    printf("Writing binary file: %s\n", filename);
+    if (!quiet_enabled) {
+        printf("Writing binary file: %s\n", filename);
+    }
     
-    FILE* fp = fopen(filename, "wb");  // Note: binary mode
-    if(!fp) {
+    // Straight from the image, no stdio buffer.
+    uint64_t started = startStatsTimer();
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+    if (fd < 0) {
         fprintf(stderr, "Error: Could not open file %s for writing\n", filename);
         return 0;
     }
-    
-    size_t written = fwrite(data, 1, length, fp);
-    fclose(fp);
-    
-    if (written != length) {
-        fprintf(stderr, "Error: Only wrote %zu of %d bytes\n", written, length);
+
+    int ok = writeAll(fd, (const char*)data, (size_t)length);
+    close(fd);
+    countStatsBytes((size_t)length);
+    stopStatsTimer(STATS_WRITE, started);
+
+    if (!ok) {
+        fprintf(stderr, "Error: Could not write file %s\n", filename);
         return 0;
     }
     
-    printf("Binary file written successfully:\n");
-    printf("  - File: %s\n", filename);
-    printf("  - Size: %d bytes\n", length);
+    if (!quiet_enabled) {
+        printf("Binary file written successfully:\n");
+        printf("  - File: %s\n", filename);
+        printf("  - Size: %d bytes\n", length);
+    }
     
     return 1;
 }
 
 
-// HEX file writer
+// OutputSink for a text file descriptor, context points to the fd.
+static int writeOutputFd(void* context, const char* data, size_t size) {
+    countStatsBytes(size);
+    return writeAll(*(int*)context, data, size);
+}
+
+// Text file a formatter streams to, started times it for --stats.
+typedef struct {
+    int      fd;
+    uint64_t started;
+} OutputStream;
+
+// Open filename for a formatter, with out a stack block of size bytes that
+// is drained to it whenever it fills. file must outlive out.
+static int openOutputStream(OutputBuffer* out, char* block, size_t size, const char* filename,
+                            OutputStream* file) {
+    file->started = startStatsTimer();
+    file->fd = openOutputFd(filename, 0);
+    if (file->fd < 0) {
+        fprintf(stderr, "Error: Could not open file %s for writing\n", filename);
+        return 0;
+    }
+    OutputBuffer stream = { block, 0, size, false, true, writeOutputFd, &file->fd };
+    *out = stream;
+    return 1;
+}
+
+static int closeOutputStream(OutputBuffer* out, OutputStream* file, const char* filename) {
+    int ok = drainOutputBuffer(out);
+    closeOutputFd(file->fd);
+    stopStatsTimer(STATS_WRITE, file->started);
+    if (!ok) {
+        fprintf(stderr, "Error: Could not write file %s\n", filename);
+    }
+    return ok;
+}
+
+// Write a formatted buffer to filename, "-" is stdout.
+int writeOutputBuffer(const OutputBuffer* buf, const char* filename, bool binary) {
+    uint64_t started = startStatsTimer();
+    int fd = openOutputFd(filename, binary ? O_BINARY : 0);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not open file %s for writing\n", filename);
+        return 0;
+    }
+    int ok = writeAll(fd, buf->data, buf->length);
+    closeOutputFd(fd);
+    countStatsBytes(buf->length);
+    stopStatsTimer(STATS_WRITE, started);
+    if (!ok) {
+        fprintf(stderr, "Error: Could not write file %s\n", filename);
+    }
+    return ok;
+}
+
+// HEX file writer, default 16 byte records.
 int writeHexFile(const uint8_t* data, int length, const char* filename) {
-    printf("Writing INTEL HEX file: %s\n", filename);
-    FILE* fp = fopen(filename, "w");
-    if(!fp) {
+    return writeHexFileEx(data, length, filename, NULL);
+}
+
+// HEX file writer with record length and address record options, "-" writes
+// to stdout.
+int writeHexFileEx(const uint8_t* data, int length, const char* filename, const HexOptions* options) {
+    HexOptions defaults = { HEX_RECORD_DEFAULT, false };
+    bool to_stdout = (strcmp(filename, "-") == 0);
+
+    if (!options) {
+        options = &defaults;
+    }
+    if (options->record_len < 1 || options->record_len > HEX_RECORD_MAX) {
+        fprintf(stderr, "Error: Invalid HEX record length %d (1-%d)\n", options->record_len, HEX_RECORD_MAX);
+        return 0;
+    }
+
+    if (!quiet_enabled && !to_stdout) {
+        printf("Writing INTEL HEX file: %s\n", filename);
+    }
+    uint64_t started = startStatsTimer();
+    int fd = openOutputFd(filename, 0);
+    if (fd < 0) {
         fprintf(stderr, "Error: Could not open file %s for writing\n", filename);
         return 0;
     }
-    
-    int addr = 0;
-    while(addr < length) {
-        int bytes = (length - addr) > 16 ? 16 : (length - addr);
-        fprintf(fp, ":%02X%04X00", bytes, addr);
-        uint8_t checksum = bytes + (addr >> 8) + (addr & 0xFF);
-        
-        for(int i = 0; i < bytes; i++) {
-            fprintf(fp, "%02X", data[addr + i]);
-            checksum += data[addr + i];
-        }
-        
-        fprintf(fp, "%02X\n", (uint8_t)(0x100 - checksum));
-        addr += bytes;
+
+    // Encoded through a HEX_BUFFER_SIZE block drained to the file.
+    char buffer[HEX_BUFFER_SIZE];
+    EncoderList list = { { findEncoderFormat("hex") }, 1 };
+    OutputBuffer out = { buffer, 0, sizeof(buffer), false, true, writeOutputFd, &fd };
+    int ok = encodeImage(data, (uint32_t)length, &list, options, &out);
+    closeOutputFd(fd);
+    stopStatsTimer(STATS_WRITE, started);
+    if (!ok) {
+        fprintf(stderr, "Error: Could not write file %s\n", filename);
+        return 0;
+    }
+
+    if (!quiet_enabled && !to_stdout) {
+        printf("INTEL HEX file written successfully: %s\n", filename);
+        printf("  - File: %s\n", filename);
+        printf("  - Size: %d bytes\n\n", length);
     }
-    
-    fprintf(fp, ":00000001FF\n");
-    fclose(fp);
-    
-    printf("INTEL HEX file written successfully: %s\n", filename);
-    printf("  - File: %s\n", filename);
-    printf("  - Size: %d bytes\n\n", length);
 
     return 1;
 }
 
 // Write raw hex dump file (no Intel HEX formatting) used for EPROM comparision.
 int writeRawHexFile(const uint8_t* data, int length, const char* filename) {
-    printf("Writing raw dump file: %s\n", filename);
+    char block[ENCODER_CHUNK_SIZE];
+    OutputBuffer out;
+    OutputStream file;
 
-    FILE* fp = fopen(filename, "w");
-    if (!fp) {
-        fprintf(stderr, "Error: Could not open file %s for writing\n", filename);
+    if (!quiet_enabled) {
+        printf("Writing raw dump file: %s\n", filename);
+    }
+
+    if (!openOutputStream(&out, block, sizeof(block), filename, &file)) {
+        return 0;
+    }
+    formatRawHexDump(data, length, &out);
+    if (!closeOutputStream(&out, &file, filename)) {
         return 0; // Return 0 to indicate an error
     }
 
-    // Write header with pattern information
-    fprintf(fp, "// PRACTEL PT-430b 27C64-150 buffer dump\n");
-    fprintf(fp, "// Size: %d bytes (0x%04X)\n", length, length);
-    fprintf(fp, "// Format: Raw hex dump, 16 bytes per line\n");
-    fprintf(fp, "//\n");
-    fprintf(fp, "// Address Pattern Layout:\n");
-    fprintf(fp, "// 0x0000-0x07FF: Pattern 1 - Color Bars (A11=0, A12=0) [CENTER POSITION]\n");
-    fprintf(fp, "//   - 0x0000-0x007F: Initial pattern = Color Bar pattern\n");
-    fprintf(fp, "//   - 0x0080-0x077F: Main pattern area Color Bar overlayed with ID\n");
-    fprintf(fp, "//   - 0x0780-0x07FF: Line 16 pattern = Color Bar\n");
-    fprintf(fp, "//\n");
-    fprintf(fp, "// 0x0800-0x0FFF: Pattern 2 - Split Field Red (A11=1, A12=0) [RIGHT POSITION]\n");
-    fprintf(fp, "//   - 0x0800-0x087F: Initial pattern= Color Bar pattern\n");
-    fprintf(fp, "//   - 0x0880-0x0F7F: Main pattern area Color Bar overlayed with ID\n");
-    fprintf(fp, "//   - 0x0F80-0x0FFF: Line 16 pattern = Red\n");
-    fprintf(fp, "//\n");
-    fprintf(fp, "// 0x1000-0x17FF: Pattern 3 - Pulse & Bar (A11=0, A12=1) [LEFT POSITION]\n");
-    fprintf(fp, "//   - 0x1000-0x107F: Initial pattern = Color Bar pattern\n");
-    fprintf(fp, "//   - 0x1080-0x177F: Main pattern area Color Bar overlayed with ID\n");
-    fprintf(fp, "//   - 0x1780-0x17FF: Line 16 pattern = Pulse & Bar\n");
-    fprintf(fp, "//\n");
-    fprintf(fp, "// 0x1800-0x1FFF: Pattern 4 - Color Black (A11=1, A12=1) [NOT USED]\n");
-    fprintf(fp, "//   - 0x1800-0x187F: Initial pattern = Color Black\n");
-    fprintf(fp, "//   - 0x1880-0x1F7F: Main pattern area Color Black (NO ID Overlay)\n");
-    fprintf(fp, "//   - 0x1F80-0x1FFF: Line 16 pattern = Color Black\n");
-    fprintf(fp, "//\n");
-    fprintf(fp, "// Addr   0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F\n");
-    fprintf(fp, "//-------------------------------------------------------\n");
-
-    int addr = 0;
-    while (addr < length) {
-          
-        switch (addr) {
-            case 0x0000:
-                fprintf(fp, "\n// (0x0000-0x007F) Pattern 1 - Color Bars Initial Pattern\n\n");
-                break;
-            case 0x0080:
-                fprintf(fp, "\n// (0x0080-0x077F) Pattern 1 - Color Bars Main Pattern with Text\n\n");
-                break;
-            case 0x0780:
-                fprintf(fp, "\n// (0x0780-0x07FF) Pattern 1 - Color Bars Line 16\n\n");
-                break;
-            case 0x0800:
-                fprintf(fp, "\n// (0x0800-0x087F) Pattern 2 - Split Field Bars Initial Pattern [Color Bars]\n\n");
-                break;
-            case 0x0880:
-                fprintf(fp, "\n// (0x0880-0x08FF) Pattern 2 - Split Field Bars Main Pattern with Text [Color Bars]\n\n");
-                break;
-            case 0x0F80:
-                fprintf(fp, "\n// (0x0F80-0x0FFF) Pattern 2 - Split Field Bars Line 16 [RED]\n\n");
-                break;
-            case 0x1000:
-                fprintf(fp, "\n// (0x1000-0x107F) Pattern 3 - Pulse & Bar Initial Pattern [Color Bars]\n\n");
-                break;
-            case 0x1080:
-                fprintf(fp, "\n// (0x1080-0x177F) Pattern 3 - Pulse & Bar Main Pattern with Text [Color Bars]\n\n");
-                break;
-            case 0x1780:
-                fprintf(fp, "\n// (0x1780-0x17FF) Pattern 3 - Pulse & Bar Line 16 [Pulse & Bar]\n\n");
-                break;
-            case 0x1800:
-                fprintf(fp, "\n// (0x1800-0x187F) Pattern 4 - Color Black Initial Pattern [Black]\n\n");
-                break;
-            case 0x1880:
-                fprintf(fp, "\n// (0x1880-0x1F7F) Pattern 4 - Color Black Main Pattern no id overlay [Black]\n\n");
-                break;
-            case 0x1F80:
-                fprintf(fp, "\n// (0x1F80-0x1FFF) Pattern 4 - Color Black Line 16 [Black]\n");
-            }  
-
-    fprintf(fp, "    %04X: ", addr);
-
-    for (int i = 0; i < 16 && addr + i < length; i++) {
-        fprintf(fp, "%02X ", data[addr + i]);
-    }
-
-    fprintf(fp, "  |");  // Separator between hex and ASCII
-
-    for (int i = 0; i < 16 && addr + i < length; i++) {
-        char c = data[addr + i];
-        fprintf(fp, "%c", (isprint(c)) ? c : '.'); // Use isprint() for printable characters
-    }
-
-    fprintf(fp, "|\n");
-
-    addr += 16;
+    if (!quiet_enabled) {
+        printf("Raw dump written successfully:\n");
+        printf("  - File: %s\n", filename);
+        printf("  - Size: %d bytes\n\n", length);
+    }
 
+    return 1; // Return 1 to indicate success
 }
 
-fclose(fp);
+// Format the Text Charater Bit Map for comparison.
+int formatCharBitmap(const uint8_t* bitmap, const char* text, OutputBuffer* out) {
+    // Print out heading
+    printOutputBuffer(out, "Character bitmap for text: \"%s\"\n", text);
+    printOutputBuffer(out, "Dimensions: %d x %d\n", TEXT_BITMAP_WIDTH, TEXT_BITMAP_HEIGHT);
+    printOutputBuffer(out, "'X' represents a white id text pixel, '-' represents pattern background\n\n");
 
-printf("Raw dump written successfully:\n");
-printf("  - File: %s\n", filename);
-printf("  - Size: %d bytes\n\n", length);
+    // Print the bar/pixel position indicator line
+    printOutputBuffer(out, "Pixels : ");
+    for (int pixel = 0; pixel < TEXT_BITMAP_WIDTH; pixel++) {
+        printOutputBuffer(out, "%c ", (pixel % 16 == 15) ? '|' : '-'); // '|' at every 16th pixel, '-' otherwise
+    }
+    printOutputBuffer(out, "\n\n");
 
-return 1; // Return 1 to indicate success
+    // Print the text chars
+    for (int line = 0; line < TEXT_BITMAP_HEIGHT; line++) {
+        printOutputBuffer(out, "Line %2d: ", line + 1); // Line numbers 1-7
+        for (int pixel = 0; pixel < TEXT_BITMAP_WIDTH; pixel++) {
+            uint8_t value = bitmap[line * TEXT_BITMAP_WIDTH + pixel];
+            printOutputBuffer(out, "%s", (value == COLOR_WHITE) ? "X " : "- "); // X for white, - for black
+        }
+        printOutputBuffer(out, "\n");
+    }
 
+    return !out->failed;
 }
 
 // Print the Text Charater Bit Map for comparison.
@@ -201,47 +333,26 @@ int writeCharBitmapFile(const uint8_t* bitmap, const char* filename, const char*
         fprintf(stderr, "Error: Null bitmap pointer in writeCharBitmapFile\n");
         return 0;
     }
-    
-    FILE* fp = fopen(filename, "w");
-    if (!fp) {
-        fprintf(stderr, "Error: Could not open file %s for writing\n", filename);
+
+    char block[ENCODER_CHUNK_SIZE];
+    OutputBuffer out;
+    OutputStream file;
+    if (!openOutputStream(&out, block, sizeof(block), filename, &file)) {
         return 0;
     }
-
-    // Print out heading
-    fprintf(fp, "Character bitmap for text: \"%s\"\n", text);
-    fprintf(fp, "Dimensions: %d x %d\n", TEXT_BITMAP_WIDTH, TEXT_BITMAP_HEIGHT);
-    fprintf(fp, "'X' represents a white id text pixel, '-' represents pattern background\n\n");
-   
-    // Print the bar/pixel position indicator line
-    fprintf(fp, "Pixels : ");
-    for (int pixel = 0; pixel < TEXT_BITMAP_WIDTH; pixel++) {
-        fprintf(fp, "%c ", (pixel % 16 == 15) ? '|' : '-'); // '|' at every 16th pixel, '-' otherwise
+    formatCharBitmap(bitmap, text, &out);
+    if (!closeOutputStream(&out, &file, filename)) {
+        return 0;
     }
-    fprintf(fp, "\n\n");
 
-    // Print the text chars
-    for (int line = 0; line < TEXT_BITMAP_HEIGHT; line++) {
-        fprintf(fp, "Line %2d: ", line + 1); // Line numbers 1-7
-        for (int pixel = 0; pixel < TEXT_BITMAP_WIDTH; pixel++) {
-            uint8_t value = bitmap[line * TEXT_BITMAP_WIDTH + pixel];
-            fprintf(fp, "%s", (value == COLOR_WHITE) ? "X " : "- "); // X for white, - for black
-        }
-        fprintf(fp, "\n");
+    if (!quiet_enabled) {
+        printf("\nDEBUG - Character bitmap written to: %s\n", filename);
     }
-
-    fclose(fp);
-    printf("\nDEBUG - Character bitmap written to: %s\n", filename);
     return 1;
 }
 
-// Print a EEPROM label with fancy boarders,
-void printEpromLabel(const char* id_text, const char* filename) {
-    FILE* fp = fopen(filename, "w");
-    if (!fp) {
-        fprintf(stderr, "Error: Could not open file %s for writing\n", filename);
-        return;
-    }
+// Format a EEPROM label with fancy boarders,
+int formatEpromLabel(const char* id_text, OutputBuffer* out) {
 
     // Center the ID text
     int padding = (MAX_TEXT_LENGTH - strlen(id_text)) / 2;
@@ -268,25 +379,140 @@ void printEpromLabel(const char* id_text, const char* filename) {
     max_width += 2 * cutout_padding;
 
       // HTML header and styling
-    fprintf(fp, "<html>\n");
-    fprintf(fp, "<head>\n");
-    fprintf(fp, "<style>\n");
-    fprintf(fp, "body { font-family: Helvetica, sans-serif; font-size: 4pt; text-align: center;}\n");
-    fprintf(fp, ".label { border: 1px solid black; padding: 2px; text-align: center; display: inline-block; }\n");
-    fprintf(fp, "</style>\n");
-    fprintf(fp, "</head>\n");
-    fprintf(fp, "<body>\n");
+    printOutputBuffer(out, "<html>\n");
+    printOutputBuffer(out, "<head>\n");
+    printOutputBuffer(out, "<style>\n");
+    printOutputBuffer(out, "body { font-family: Helvetica, sans-serif; font-size: 4pt; text-align: center;}\n");
+    printOutputBuffer(out, ".label { border: 1px solid black; padding: 2px; text-align: center; display: inline-block; }\n");
+    printOutputBuffer(out, "</style>\n");
+    printOutputBuffer(out, "</head>\n");
+    printOutputBuffer(out, "<body>\n");
 
     // Label content within a div
-    fprintf(fp, "<div class=\"label\">\n");
-    fprintf(fp, "<b>PT-430 COLORBAR-GEN</b><br>\n"); // Bold title
-    fprintf(fp, "ID: <b>%s</b><br>\n", padded_text); // Bold ID
-    fprintf(fp, "Date: %s\n", date_string); // Date
-    fprintf(fp, "</div>\n");
+    printOutputBuffer(out, "<div class=\"label\">\n");
+    printOutputBuffer(out, "<b>PT-430 COLORBAR-GEN</b><br>\n"); // Bold title
+    printOutputBuffer(out, "ID: <b>%s</b><br>\n", padded_text); // Bold ID
+    printOutputBuffer(out, "Date: %s\n", date_string); // Date
+    printOutputBuffer(out, "</div>\n");
 
-    fprintf(fp, "</body>\n");
-    fprintf(fp, "</html>\n");
+    printOutputBuffer(out, "</body>\n");
+    printOutputBuffer(out, "</html>\n");
+
+    return !out->failed;
+}
 
-    fclose(fp);
-    printf("EEPROM label written to: %s\n", filename);
+// Print a EEPROM label with fancy boarders,
+void printEpromLabel(const char* id_text, const char* filename) {
+    char block[ENCODER_CHUNK_SIZE];
+    OutputBuffer out;
+    OutputStream file;
+    if (!openOutputStream(&out, block, sizeof(block), filename, &file)) {
+        return;
+    }
+    formatEpromLabel(id_text, &out);
+    if (closeOutputStream(&out, &file, filename) && !quiet_enabled) {
+        printf("EEPROM label written to: %s\n", filename);
+    }
+}
+
+// Add a format unless the list already has it.
+int addEncoderFormat(EncoderList* list, const EncoderFormat* format) {
+    for (int i = 0; i < list->count; i++) {
+        if (list->formats[i] == format) {
+            return 1;
+        }
+    }
+    if (list->count == MAX_ENCODERS) {
+        fprintf(stderr, "Error: More than %d output formats\n", MAX_ENCODERS);
+        return 0;
+    }
+    list->formats[list->count++] = format;
+    return 1;
+}
+
+// Parse a comma separated format list such as "hex,bin,srec".
+int parseEncoderList(const char* names, EncoderList* list) {
+    char buffer[128];
+    list->count = 0;
+
+    if (strlen(names) >= sizeof(buffer)) {
+        fprintf(stderr, "Error: Invalid format list %s\n", names);
+        return 0;
+    }
+    strcpy(buffer, names);
+
+    for (char* name = strtok(buffer, ", "); name; name = strtok(NULL, ", ")) {
+        const EncoderFormat* format = findEncoderFormat(name);
+        if (!format) {
+            fprintf(stderr, "Error: Unknown output format '%s'\n", name);
+            return 0;
+        }
+        if (!addEncoderFormat(list, format)) {
+            return 0;
+        }
+    }
+
+    if (list->count == 0) {
+        fprintf(stderr, "Error: No output format given\n");
+        return 0;
+    }
+    return 1;
+}
+
+// Format table for the usage text.
+void printEncoderFormats(FILE* fp) {
+    const EncoderFormat* format;
+    for (int i = 0; (format = getEncoderFormat(i)) != NULL; i++) {
+        fprintf(fp, "  %-5s <name>%-6s %s\n", format->name, format->suffix, format->description);
+    }
+}
+
+// Encode the image and write one file per format next to output_file.
+// With output_file "-" only the first format is written, to stdout. The
+// encoded outputs are held in arena, or on the heap when it is NULL.
+int writeEncodedFiles(const uint8_t* data, uint32_t length, const EncoderList* list,
+                      const HexOptions* options, const char* output_file, Arena* arena) {
+    OutputBuffer outs[MAX_ENCODERS];
+    bool to_stdout = (strcmp(output_file, "-") == 0);
+    int ok;
+
+    const EncoderFormat* limit = findEncoderLimit(list, length);
+    if (limit) {
+        fprintf(stderr, "Error: %s cannot address %u bytes\n", limit->description, length);
+        return 0;
+    }
+
+    memset(outs, 0, sizeof(outs));
+    for (int i = 0; i < list->count; i++) {
+        outs[i].arena = arena;
+    }
+    uint64_t started = startStatsTimer();
+    ok = encodeImage(data, length, list, options, outs);
+    stopStatsTimer(STATS_ENCODE, started);
+    countStatsRecords(outs, list);
+    if (!ok) {
+        fprintf(stderr, "Error: Could not encode the image\n");
+    }
+
+    for (int i = 0; ok && i < list->count; i++) {
+        const EncoderFormat* format = list->formats[i];
+        char name[OUTPUT_PATH_MAX];
+
+        if (to_stdout) {
+            ok = writeOutputBuffer(&outs[i], "-", format->binary);
+            break;
+        }
+        ok = buildOutputName(output_file, format->suffix, name) &&
+             writeOutputBuffer(&outs[i], name, format->binary);
+        if (!ok) {
+            fprintf(stderr, "Error: Failed to write %s file: %s\n", format->description, name);
+        } else if (!quiet_enabled) {
+            printf("- %s: %s (%zu bytes)\n", format->description, name, outs[i].length);
+        }
+    }
+
+    for (int i = 0; i < list->count; i++) {
+        freeOutputBuffer(&outs[i]);
+    }
+    return ok;
 }
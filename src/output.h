@@ -21,10 +21,65 @@
 #define OUTPUT_H
 
 #include "debug.h"
+#include "arena.h"
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Maximum length of a generated output path
+#define OUTPUT_PATH_MAX  256
+
+// Output file names derived from the -o <output file> argument
+typedef struct {
+    char hex[OUTPUT_PATH_MAX];      // <name>.hex
+    char bin[OUTPUT_PATH_MAX];      // <name>.bin
+    char dump[OUTPUT_PATH_MAX];     // <name>.dump
+    char text[OUTPUT_PATH_MAX];     // <name>_id.txt
+    char label[OUTPUT_PATH_MAX];    // <name>_eprom_label.html
+} OutputNames;
+
+int buildOutputNames(const char* output_file, OutputNames* names);
+int buildOutputName(const char* output_file, const char* suffix, char* name);
+
+// Intel HEX encoder
+#define HEX_RECORD_DEFAULT  16      // Data bytes per record
+#define HEX_RECORD_MAX      255
+#define HEX_BUFFER_SIZE     65536   // Encoded output is flushed in blocks of this size
+
+// Encoded size of a record with count data bytes: ':' + 4 header bytes,
+// data and checksum as hex, and '\n'.
+#define HEX_RECORD_SIZE(count)  ((size_t)(1 + 2 * (4 + (count) + 1) + 1))
+
+typedef struct {
+    int  record_len;                // Data bytes per record, 1-255
+    bool linear_address;            // Always emit the type-04 record, as the vendor image does
+} HexOptions;
+
+// Takes size bytes of a drained buffer, returns 0 on a write error
+typedef int (*OutputSink)(void* context, const char* data, size_t size);
+
+// Buffer the text formatters append to. Zeroed it grows with realloc, or
+// inside arena when that is set. A fixed buffer is caller memory of
+// capacity bytes, it is drained to sink when full (or fails without one)
+// and is never grown or freed.
+typedef struct {
+    char*  data;
+    size_t length;
+    size_t capacity;
+    bool   failed;                  // An append ran out of memory, or the sink failed
+    bool   fixed;
+    OutputSink sink;
+    void*  context;                 // Passed to sink
+    Arena* arena;                   // Grown in this arena instead of the heap
+} OutputBuffer;
+
+int writeOutputBuffer(const OutputBuffer* buf, const char* filename, bool binary);
+int formatCharBitmap(const uint8_t* bitmap, const char* text, OutputBuffer* out);
+int formatEpromLabel(const char* id_text, OutputBuffer* out);
 
 // File output functions
 int writeHexFile(const uint8_t* data, int length, const char* filename);
+int writeHexFileEx(const uint8_t* data, int length, const char* filename, const HexOptions* options);
 int writeRawHexFile(const uint8_t* data, int length, const char* filename);
 int writeBinFile(const uint8_t* data, int length, const char* filename);
 int writeCharBitmapFile(const uint8_t* bitmap, const char* filename, const char* text);
@@ -0,0 +1,428 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ pack.c  .pt430pack archive of many images, stored by scan line.
+
+ An image is 64 lines of 128 bytes, and across a fleet nearly all of them
+ are the same handful of bar, red, pulse and black lines; only the 7 text
+ rows differ per ID. A pack stores every distinct line once:
+
+   header       PackHeader, 64 bytes
+   lines        line_count x 128 bytes
+   tables       64 line numbers (uint32) per image
+   index        PackIndexEntry per image, sorted by ID text
+
+ An 8K image takes about 1.2K. The file is mapped and read in place: an ID
+ is found by binary search of the index and its image rebuilt from its
+ table, nothing else is touched. Appending loads the pack into a
+ PackBuilder and writes a new file through a temporary. An ID added again
+ replaces the earlier image, and lines no image uses are dropped then.
+ */
+
+#include "pack.h"
+#include "incremental.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "pack.c reads and writes packs in host order, which must be little endian"
+#endif
+
+_Static_assert(sizeof(PackHeader) == 64, "pack header is 64 bytes");
+_Static_assert(sizeof(PackIndexEntry) == 20, "pack index entry is 20 bytes");
+_Static_assert(PACK_ID_SIZE > MAX_TEXT_LENGTH, "pack ID holds the longest text");
+
+// Line content hash, a word at a time.
+static uint64_t hashLine(const uint8_t* line) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < PACK_LINE_SIZE; i += 8) {
+        uint64_t word;
+        memcpy(&word, line + i, sizeof(word));
+        h = (h ^ word) * 0x100000001B3ULL;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+// Map (or on Windows read) filename and check the header and sections.
+int openPackFile(const char* filename, PackFile* pack) {
+    memset(pack, 0, sizeof(*pack));
+
+    int fd = open(filename, O_RDONLY | O_BINARY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not open pack %s\n", filename);
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(PackHeader)) {
+        fprintf(stderr, "Error: %s is not a pack file\n", filename);
+        close(fd);
+        return 0;
+    }
+    pack->size = (size_t)st.st_size;
+
+#ifndef _WIN32
+    void* data = mmap(NULL, pack->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Error: Could not map pack %s\n", filename);
+        return 0;
+    }
+    pack->data = (const uint8_t*)data;
+    pack->mapped = true;
+#else
+    uint8_t* data = (uint8_t*)malloc(pack->size);
+    size_t total = 0;
+    while (data && total < pack->size) {
+        int n = read(fd, data + total, (unsigned)(pack->size - total));
+        if (n <= 0) break;
+        total += (size_t)n;
+    }
+    close(fd);
+    if (!data || total != pack->size) {
+        fprintf(stderr, "Error: Could not read pack %s\n", filename);
+        free(data);
+        return 0;
+    }
+    pack->data = data;
+#endif
+
+    const PackHeader* h = (const PackHeader*)pack->data;
+    uint64_t lines_end = h->lines_offset + (uint64_t)h->line_count * PACK_LINE_SIZE;
+    uint64_t tables_end = h->tables_offset + (uint64_t)h->image_count * PACK_LINES_PER_IMAGE * sizeof(uint32_t);
+    uint64_t index_end = h->index_offset + (uint64_t)h->image_count * sizeof(PackIndexEntry);
+    if (memcmp(h->magic, PACK_MAGIC, sizeof(h->magic)) != 0 || h->version != PACK_VERSION ||
+        h->line_size != PACK_LINE_SIZE || h->image_size != EPROM_SIZE ||
+        h->lines_offset < sizeof(PackHeader) || lines_end > pack->size ||
+        h->tables_offset % sizeof(uint32_t) || tables_end > pack->size ||
+        h->index_offset % sizeof(uint32_t) || index_end > pack->size) {
+        fprintf(stderr, "Error: %s is not a version %d pack file\n", filename, PACK_VERSION);
+        closePackFile(pack);
+        return 0;
+    }
+
+    pack->header = h;
+    pack->lines = pack->data + h->lines_offset;
+    pack->tables = (const uint32_t*)(pack->data + h->tables_offset);
+    pack->index = (const PackIndexEntry*)(pack->data + h->index_offset);
+    return 1;
+}
+
+void closePackFile(PackFile* pack) {
+#ifndef _WIN32
+    if (pack->mapped) {
+        munmap((void*)pack->data, pack->size);
+    }
+#else
+    free((void*)pack->data);
+#endif
+    memset(pack, 0, sizeof(*pack));
+}
+
+// Image number for id_text, -1 if the pack does not hold it. Keys are the
+// exact ID text, "pi" and "PI" are different images (i is drawn full width).
+int findPackImage(const PackFile* pack, const char* id_text) {
+    uint32_t lo = 0, hi = pack->header->image_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int cmp = strncmp(id_text, pack->index[mid].id_text, PACK_ID_SIZE);
+        if (cmp == 0) {
+            uint32_t image = pack->index[mid].image;
+            return image < pack->header->image_count ? (int)image : -1;
+        }
+        if (cmp < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return -1;
+}
+
+// Rebuild image number image into eprom_data (EPROM_SIZE bytes).
+int extractPackImage(const PackFile* pack, int image, uint8_t* eprom_data) {
+    if (image < 0 || (uint32_t)image >= pack->header->image_count) {
+        return 0;
+    }
+    const uint32_t* table = pack->tables + (size_t)image * PACK_LINES_PER_IMAGE;
+    for (int i = 0; i < PACK_LINES_PER_IMAGE; i++) {
+        if (table[i] >= pack->header->line_count) {
+            fprintf(stderr, "Error: Pack image %d refers to line %u of %u\n", image, table[i],
+                    pack->header->line_count);
+            return 0;
+        }
+        memcpy(eprom_data + i * PACK_LINE_SIZE, pack->lines + (size_t)table[i] * PACK_LINE_SIZE, PACK_LINE_SIZE);
+    }
+    return 1;
+}
+
+// Grow the line store to capacity lines and rehash them.
+static int growLines(PackBuilder* builder, uint32_t capacity) {
+    uint8_t* lines = (uint8_t*)realloc(builder->lines, (size_t)capacity * PACK_LINE_SIZE);
+    uint32_t* slots = (uint32_t*)calloc((size_t)capacity * 2, sizeof(uint32_t));
+    if (!lines || !slots) {
+        if (lines) builder->lines = lines;
+        free(slots);
+        return 0;
+    }
+    builder->lines = lines;
+    builder->line_capacity = capacity;
+    free(builder->slots);
+    builder->slots = slots;
+    builder->slot_mask = (size_t)capacity * 2 - 1;
+    for (uint32_t i = 0; i < builder->line_count; i++) {
+        size_t s = hashLine(lines + (size_t)i * PACK_LINE_SIZE) & builder->slot_mask;
+        while (slots[s]) s = (s + 1) & builder->slot_mask;
+        slots[s] = i + 1;
+    }
+    return 1;
+}
+
+// Number of line, added if new. Returns 0 when out of memory.
+static int addLine(PackBuilder* builder, const uint8_t* line, uint32_t* number) {
+    size_t s = hashLine(line) & builder->slot_mask;
+    for (; builder->slots && builder->slots[s]; s = (s + 1) & builder->slot_mask) {
+        uint32_t i = builder->slots[s] - 1;
+        if (memcmp(builder->lines + (size_t)i * PACK_LINE_SIZE, line, PACK_LINE_SIZE) == 0) {
+            *number = i;
+            return 1;
+        }
+    }
+
+    if (builder->line_count == builder->line_capacity) {
+        if (!growLines(builder, builder->line_capacity ? builder->line_capacity * 2 : 1024)) {
+            return 0;
+        }
+        s = hashLine(line) & builder->slot_mask;
+        while (builder->slots[s]) s = (s + 1) & builder->slot_mask;
+    }
+
+    *number = builder->line_count++;
+    memcpy(builder->lines + (size_t)*number * PACK_LINE_SIZE, line, PACK_LINE_SIZE);
+    builder->slots[s] = builder->line_count;
+    return 1;
+}
+
+// Split eprom_data into lines and record it under id_text.
+static int addImage(PackBuilder* builder, const char* id_text, const uint8_t* eprom_data) {
+    if (builder->image_count == builder->image_capacity) {
+        uint32_t capacity = builder->image_capacity ? builder->image_capacity * 2 : 256;
+        uint32_t* tables = (uint32_t*)realloc(builder->tables,
+                                              (size_t)capacity * PACK_LINES_PER_IMAGE * sizeof(uint32_t));
+        if (tables) builder->tables = tables;
+        PackIndexEntry* ids = (PackIndexEntry*)realloc(builder->ids, (size_t)capacity * sizeof(PackIndexEntry));
+        if (ids) builder->ids = ids;
+        if (!tables || !ids) {
+            return 0;
+        }
+        builder->image_capacity = capacity;
+    }
+
+    uint32_t* table = builder->tables + (size_t)builder->image_count * PACK_LINES_PER_IMAGE;
+    for (int i = 0; i < PACK_LINES_PER_IMAGE; i++) {
+        if (!addLine(builder, eprom_data + i * PACK_LINE_SIZE, &table[i])) {
+            return 0;
+        }
+    }
+
+    PackIndexEntry* entry = &builder->ids[builder->image_count];
+    memset(entry, 0, sizeof(*entry));
+    strncpy(entry->id_text, id_text, PACK_ID_SIZE - 1);
+    entry->image = builder->image_count++;
+    return 1;
+}
+
+// Load a pack to append to, a missing file is an empty pack.
+int loadPackBuilder(const char* filename, PackBuilder* builder) {
+    memset(builder, 0, sizeof(*builder));
+
+    if (access(filename, F_OK) != 0 && errno == ENOENT) {
+        return 1;
+    }
+
+    PackFile pack;
+    if (!openPackFile(filename, &pack)) {
+        return 0;
+    }
+
+    // Lines first so the tables keep their numbers. The hash table wants a
+    // power of two.
+    uint32_t capacity = 1024;
+    while (capacity < pack.header->line_count) capacity *= 2;
+    int ok = growLines(builder, capacity);
+    for (uint32_t i = 0; ok && i < pack.header->line_count; i++) {
+        uint32_t number;
+        ok = addLine(builder, pack.lines + (size_t)i * PACK_LINE_SIZE, &number);
+    }
+
+    uint8_t image[EPROM_SIZE];
+    for (uint32_t i = 0; ok && i < pack.header->image_count; i++) {
+        char id_text[PACK_ID_SIZE];
+        memcpy(id_text, pack.index[i].id_text, PACK_ID_SIZE);
+        id_text[PACK_ID_SIZE - 1] = '\0';
+        ok = extractPackImage(&pack, (int)pack.index[i].image, image) && addImage(builder, id_text, image);
+    }
+    closePackFile(&pack);
+
+    if (!ok) {
+        fprintf(stderr, "Error: Could not load pack %s\n", filename);
+        freePackBuilder(builder);
+        return 0;
+    }
+    return 1;
+}
+
+int addPackImage(PackBuilder* builder, const char* id_text, const uint8_t* eprom_data) {
+    if (strlen(id_text) >= PACK_ID_SIZE) {
+        fprintf(stderr, "Error: ID text too long for a pack: %s\n", id_text);
+        return 0;
+    }
+    if (!addImage(builder, id_text, eprom_data)) {
+        perror("Error allocating memory for pack");
+        return 0;
+    }
+    builder->added++;
+    return 1;
+}
+
+// ID order, the later of two images with the same ID last.
+static int compareIds(const void* a, const void* b) {
+    const PackIndexEntry* x = (const PackIndexEntry*)a;
+    const PackIndexEntry* y = (const PackIndexEntry*)b;
+    int cmp = strncmp(x->id_text, y->id_text, PACK_ID_SIZE);
+    if (cmp) {
+        return cmp;
+    }
+    return x->image < y->image ? -1 : x->image > y->image;
+}
+
+static int writeSection(FILE* fp, const void* data, size_t size) {
+    return size == 0 || fwrite(data, 1, size, fp) == size;
+}
+
+// Write the pack to filename through a temporary. Images are stored in ID
+// order, the latest for each ID, with only the lines they use. The builder
+// is only fit to be freed afterwards.
+int savePackBuilder(PackBuilder* builder, const char* filename) {
+    uint32_t table[PACK_LINES_PER_IMAGE];
+    int ok = 0;
+
+    // Sort, then keep the last image of each run of equal IDs.
+    qsort(builder->ids, builder->image_count, sizeof(PackIndexEntry), compareIds);
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < builder->image_count; i++) {
+        if (i + 1 < builder->image_count &&
+            strncmp(builder->ids[i].id_text, builder->ids[i + 1].id_text, PACK_ID_SIZE) == 0) {
+            continue;
+        }
+        builder->ids[kept++] = builder->ids[i];
+    }
+    builder->replaced = (int)(builder->image_count - kept);
+
+    // Number the lines the kept images use, in their existing order.
+    uint32_t* remap = (uint32_t*)calloc(builder->line_count ? builder->line_count : 1, sizeof(uint32_t));
+    if (!remap) {
+        perror("Error allocating memory for pack");
+        return 0;
+    }
+    for (uint32_t i = 0; i < kept; i++) {
+        const uint32_t* lines = builder->tables + (size_t)builder->ids[i].image * PACK_LINES_PER_IMAGE;
+        for (int j = 0; j < PACK_LINES_PER_IMAGE; j++) {
+            remap[lines[j]] = 1;
+        }
+    }
+    uint32_t line_count = 0;
+    for (uint32_t i = 0; i < builder->line_count; i++) {
+        if (remap[i]) {
+            remap[i] = ++line_count;
+        }
+    }
+
+    PackHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PACK_MAGIC, sizeof(header.magic));
+    header.version = PACK_VERSION;
+    header.line_size = PACK_LINE_SIZE;
+    header.image_size = EPROM_SIZE;
+    header.line_count = line_count;
+    header.image_count = kept;
+    header.lines_offset = sizeof(PackHeader);
+    header.tables_offset = header.lines_offset + (uint64_t)line_count * PACK_LINE_SIZE;
+    header.index_offset = header.tables_offset + (uint64_t)kept * PACK_LINES_PER_IMAGE * sizeof(uint32_t);
+
+    char tmp[OUTPUT_PATH_MAX + 16];
+    getTempName(filename, tmp, sizeof(tmp));
+    FILE* fp = fopen(tmp, "wb");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open file %s for writing\n", tmp);
+        goto done;
+    }
+
+    ok = writeSection(fp, &header, sizeof(header));
+    for (uint32_t i = 0; ok && i < builder->line_count; i++) {
+        if (remap[i]) {
+            ok = writeSection(fp, builder->lines + (size_t)i * PACK_LINE_SIZE, PACK_LINE_SIZE);
+        }
+    }
+    for (uint32_t i = 0; ok && i < kept; i++) {
+        const uint32_t* lines = builder->tables + (size_t)builder->ids[i].image * PACK_LINES_PER_IMAGE;
+        for (int j = 0; j < PACK_LINES_PER_IMAGE; j++) {
+            table[j] = remap[lines[j]] - 1;
+        }
+        ok = writeSection(fp, table, sizeof(table));
+    }
+    for (uint32_t i = 0; ok && i < kept; i++) {
+        PackIndexEntry entry = builder->ids[i];
+        entry.image = i;
+        ok = writeSection(fp, &entry, sizeof(entry));
+    }
+    ok &= fclose(fp) == 0;
+
+#ifdef _WIN32
+    if (ok) remove(filename);
+#endif
+    if (!ok || rename(tmp, filename) != 0) {
+        fprintf(stderr, "Error: Could not write pack %s\n", filename);
+        remove(tmp);
+        ok = 0;
+    }
+
+done:
+    free(remap);
+    return ok;
+}
+
+void freePackBuilder(PackBuilder* builder) {
+    free(builder->lines);
+    free(builder->slots);
+    free(builder->tables);
+    free(builder->ids);
+    memset(builder, 0, sizeof(*builder));
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ pack.h  include for pack.c
+ */
+
+#ifndef PACK_H
+#define PACK_H
+
+#include "patterns.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define PACK_MAGIC            "PT430PAK"
+#define PACK_VERSION          1
+#define PACK_LINE_SIZE        PIXELS_PER_LINE                   // One 128 byte scan line
+#define PACK_LINES_PER_IMAGE  (EPROM_SIZE / PACK_LINE_SIZE)     // 64
+#define PACK_ID_SIZE          16                                // MAX_TEXT_LENGTH + NUL, padded
+
+// File header, little endian, followed by the line, table and index sections
+typedef struct {
+    char     magic[8];              // PACK_MAGIC, no NUL
+    uint32_t version;
+    uint32_t line_size;             // PACK_LINE_SIZE
+    uint32_t image_size;            // EPROM_SIZE
+    uint32_t line_count;            // Unique lines
+    uint32_t image_count;
+    uint32_t reserved;
+    uint64_t lines_offset;          // line_count x line_size bytes
+    uint64_t tables_offset;         // image_count x PACK_LINES_PER_IMAGE uint32 line numbers
+    uint64_t index_offset;          // image_count PackIndexEntry, sorted by ID text
+    uint8_t  padding[8];
+} PackHeader;
+
+// ID index entry, image is the table number
+typedef struct {
+    char     id_text[PACK_ID_SIZE];
+    uint32_t image;
+} PackIndexEntry;
+
+// Read only view of a pack, mapped where the platform allows
+typedef struct {
+    const uint8_t*        data;
+    size_t                size;
+    const PackHeader*     header;
+    const uint8_t*        lines;
+    const uint32_t*       tables;
+    const PackIndexEntry* index;
+    bool                  mapped;
+} PackFile;
+
+// Pack being built or appended to, written out in one go
+typedef struct {
+    uint8_t*  lines;
+    uint32_t  line_count;
+    uint32_t  line_capacity;
+    uint32_t* slots;                // Line number + 1 by content hash, 0 is empty
+    size_t    slot_mask;
+    uint32_t* tables;
+    PackIndexEntry* ids;            // In the order added, image is the table number
+    uint32_t  image_count;
+    uint32_t  image_capacity;
+    int       added;                // Images added since loading
+    int       replaced;             // Of those, IDs that were already in the pack
+} PackBuilder;
+
+// Pack reading functions
+int openPackFile(const char* filename, PackFile* pack);
+void closePackFile(PackFile* pack);
+int findPackImage(const PackFile* pack, const char* id_text);
+int extractPackImage(const PackFile* pack, int image, uint8_t* eprom_data);
+
+// Pack writing functions
+int loadPackBuilder(const char* filename, PackBuilder* builder);
+int addPackImage(PackBuilder* builder, const char* id_text, const uint8_t* eprom_data);
+int savePackBuilder(PackBuilder* builder, const char* filename);
+void freePackBuilder(PackBuilder* builder);
+
+#endif // PACK_H
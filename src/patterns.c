@@ -47,18 +47,9 @@
 
 #include "patterns.h"
 #include "output.h"
+#include "blend.h"
 #include <string.h>
-#include <ctype.h>
-
-// Helper function to get character index
-static int getCharIndex(char c) {
-    c = toupper(c);
-    if (c >= 'A' && c <= 'Z') return (c - 'A' + 1);  // A-Z at indices 1-26
-    if (c >= '0' && c <= '9') return (c - '0' + 27); // 0-9 at indices 27-36
-    if (c == '-') return 37;                         // Hyphen at index 37
-    if (c == ':') return 38;                         // Colon at index 38
-    return -1; // Return -1 for unknown characters.
-}
+#include <pthread.h>
 
 // Color bar pattern generator
 // All weirdness the last bar black is first
@@ -93,12 +84,89 @@ uint8_t generatePulseBar(int pixel_pos) {
     }
 }
 
-// Function to generate a text bitmap chars
-void generateTextBitmap(const char* text, uint8_t* bitmap) {
+// Packed glyph atlas, font_data turned into 7 row masks (bit c is column c)
+// with the x offset and advance of each glyph. 'I' and '1' are drawn a
+// pixel further left and advance 5 instead of 7 to match the original text
+// mapping, lower case 'i' keeps the full width. Unknown characters do not
+// advance.
+typedef struct {
+    uint8_t rows[TEXT_BITMAP_HEIGHT];
+    int8_t  offset;
+    uint8_t advance;
+} Glyph;
+
+// The glyphs of font_data are GLYPH_SPACE to GLYPH_COLON, in font_data order.
+enum {
+    GLYPH_NONE = 0,
+    GLYPH_SPACE,
+    GLYPH_A,
+    GLYPH_0 = GLYPH_A + 26,
+    GLYPH_HYPHEN = GLYPH_0 + 10,
+    GLYPH_COLON,
+    GLYPH_I_NARROW,
+    GLYPH_1_NARROW,
+    NUM_GLYPHS
+};
+
+static Glyph glyph_atlas[NUM_GLYPHS];
+static pthread_once_t glyph_atlas_once = PTHREAD_ONCE_INIT;
+
+// Build glyph_atlas from font_data, which stores a byte per column (bit l
+// is row l). Run once, through pthread_once.
+static void initGlyphAtlas(void) {
+    for (int g = 0; g <= GLYPH_COLON - GLYPH_SPACE; g++) {
+        Glyph* glyph = &glyph_atlas[GLYPH_SPACE + g];
+        for (int col = 0; col < CHAR_WIDTH; col++) {
+            for (int line = 0; line < TEXT_BITMAP_HEIGHT; line++) {
+                if ((font_data[g * CHAR_WIDTH + col] >> line) & 1) {
+                    glyph->rows[line] |= (uint8_t)(1 << col);
+                }
+            }
+        }
+        glyph->advance = CHAR_WIDTH + TEXT_INTER_SPACE;
+    }
+    glyph_atlas[GLYPH_I_NARROW] = glyph_atlas[GLYPH_A + 8];
+    glyph_atlas[GLYPH_1_NARROW] = glyph_atlas[GLYPH_0 + 1];
+    for (int g = GLYPH_I_NARROW; g <= GLYPH_1_NARROW; g++) {
+        glyph_atlas[g].offset = -1;
+        glyph_atlas[g].advance = CHAR_WIDTH;
+    }
+}
+
+// The atlas rasterizeText() draws from, for keys of everything that decides
+// the output (incremental.c).
+const void* getGlyphAtlas(size_t* size) {
+    pthread_once(&glyph_atlas_once, initGlyphAtlas);
+    *size = sizeof(glyph_atlas);
+    return glyph_atlas;
+}
+
+// Atlas entry of each 7 bit character.
+static const uint8_t glyph_map[128] = {
+    [' '] = GLYPH_SPACE, ['-'] = GLYPH_HYPHEN, ['0'] = GLYPH_0, ['1'] = GLYPH_1_NARROW,
+    ['2'] = GLYPH_0 + 2, ['3'] = GLYPH_0 + 3, ['4'] = GLYPH_0 + 4, ['5'] = GLYPH_0 + 5,
+    ['6'] = GLYPH_0 + 6, ['7'] = GLYPH_0 + 7, ['8'] = GLYPH_0 + 8, ['9'] = GLYPH_0 + 9,
+    [':'] = GLYPH_COLON, ['A'] = GLYPH_A, ['B'] = GLYPH_A + 1, ['C'] = GLYPH_A + 2,
+    ['D'] = GLYPH_A + 3, ['E'] = GLYPH_A + 4, ['F'] = GLYPH_A + 5, ['G'] = GLYPH_A + 6,
+    ['H'] = GLYPH_A + 7, ['I'] = GLYPH_I_NARROW, ['J'] = GLYPH_A + 9, ['K'] = GLYPH_A + 10,
+    ['L'] = GLYPH_A + 11, ['M'] = GLYPH_A + 12, ['N'] = GLYPH_A + 13, ['O'] = GLYPH_A + 14,
+    ['P'] = GLYPH_A + 15, ['Q'] = GLYPH_A + 16, ['R'] = GLYPH_A + 17, ['S'] = GLYPH_A + 18,
+    ['T'] = GLYPH_A + 19, ['U'] = GLYPH_A + 20, ['V'] = GLYPH_A + 21, ['W'] = GLYPH_A + 22,
+    ['X'] = GLYPH_A + 23, ['Y'] = GLYPH_A + 24, ['Z'] = GLYPH_A + 25, ['a'] = GLYPH_A,
+    ['b'] = GLYPH_A + 1, ['c'] = GLYPH_A + 2, ['d'] = GLYPH_A + 3, ['e'] = GLYPH_A + 4,
+    ['f'] = GLYPH_A + 5, ['g'] = GLYPH_A + 6, ['h'] = GLYPH_A + 7, ['i'] = GLYPH_A + 8,
+    ['j'] = GLYPH_A + 9, ['k'] = GLYPH_A + 10, ['l'] = GLYPH_A + 11, ['m'] = GLYPH_A + 12,
+    ['n'] = GLYPH_A + 13, ['o'] = GLYPH_A + 14, ['p'] = GLYPH_A + 15, ['q'] = GLYPH_A + 16,
+    ['r'] = GLYPH_A + 17, ['s'] = GLYPH_A + 18, ['t'] = GLYPH_A + 19, ['u'] = GLYPH_A + 20,
+    ['v'] = GLYPH_A + 21, ['w'] = GLYPH_A + 22, ['x'] = GLYPH_A + 23, ['y'] = GLYPH_A + 24,
+    ['z'] = GLYPH_A + 25,
+};
+
+// Build the packed text rows for text, centred between the keep-out bars.
+void rasterizeText(const char* text, TextMask* mask) {
     int text_length = strlen(text);
-    if (text_length > 14) {
-        text_length = 14; // Truncate text if too long
-        fprintf(stderr, "Warning: Text truncated to 14 characters.\n");
+    if (text_length > MAX_TEXT_LENGTH) {
+        text_length = MAX_TEXT_LENGTH; // Truncate text if too long, callers validate it first
     }
 
     int char_width_with_space = CHAR_WIDTH + TEXT_INTER_SPACE; // Character width + inter-character spacing
@@ -106,141 +174,197 @@ void generateTextBitmap(const char* text, uint8_t* bitmap) {
 
     // Center the text with keep-out areas
     int available_width = PIXELS_PER_LINE - (2 * TEXT_KEEPOUT);
-    int text_start = TEXT_KEEPOUT + (available_width - text_width) / 2 + 1;
+    int x = TEXT_KEEPOUT + (available_width - text_width) / 2 + 1;
+
+    // Glyph and position of each character, then each row is built in two
+    // registers by shift-and-OR. Positions only increase, so the glyphs
+    // starting left of pixel 64 come first; those may straddle both words.
+    const uint8_t* glyph_rows[MAX_TEXT_LENGTH];
+    int glyph_x[MAX_TEXT_LENGTH];
+    int count = 0, first_high = 0;
+
+    pthread_once(&glyph_atlas_once, initGlyphAtlas);
+    for (int char_pos = 0; char_pos < text_length; char_pos++) {
+        unsigned char c = (unsigned char)text[char_pos];
+        int index = c < 128 ? glyph_map[c] : GLYPH_NONE;
+        const Glyph* glyph = &glyph_atlas[index];
+        int glyph_pos = x + glyph->offset;
+        if (index > GLYPH_SPACE && glyph_pos < PIXELS_PER_LINE) {
+            glyph_rows[count] = glyph->rows;
+            glyph_x[count] = glyph_pos;
+            count++;
+            if (glyph_pos < 64) {
+                first_high = count;
+            }
+        }
+        x += glyph->advance;
+    }
 
-    // Create a blank bitmap. 128 x 7 = 896 positions
+    uint64_t low[TEXT_BITMAP_HEIGHT] = { 0 }, high[TEXT_BITMAP_HEIGHT] = { 0 };
+    for (int i = 0; i < first_high; i++) {
+        const uint8_t* rows = glyph_rows[i];
+        int shift = glyph_x[i];
+        for (int line = 0; line < TEXT_BITMAP_HEIGHT; line++) {
+            low[line] |= (uint64_t)rows[line] << shift;
+            high[line] |= ((uint64_t)rows[line] >> 1) >> (63 - shift);
+        }
+    }
+    for (int i = first_high; i < count; i++) {
+        const uint8_t* rows = glyph_rows[i];
+        int shift = glyph_x[i] - 64;
+        for (int line = 0; line < TEXT_BITMAP_HEIGHT; line++) {
+            high[line] |= (uint64_t)rows[line] << shift;
+        }
+    }
+    for (int line = 0; line < TEXT_BITMAP_HEIGHT; line++) {
+        mask->rows[line][0] = low[line];
+        mask->rows[line][1] = high[line];
+    }
+}
+
+// Expand packed text rows to the byte per pixel text bitmap (896 bytes).
+void expandTextMask(const TextMask* mask, uint8_t* bitmap) {
     memset(bitmap, 0, PIXELS_PER_LINE * TEXT_BITMAP_HEIGHT);
+    for (int line = 0; line < TEXT_BITMAP_HEIGHT; line++) {
+        blendTextRow(bitmap + line * PIXELS_PER_LINE, bitmap + line * PIXELS_PER_LINE, mask->rows[line]);
+    }
+}
 
-    int current_x = text_start;
-    int reduced_width_count = 0;
+// Function to generate a text bitmap chars
+void generateTextBitmap(const char* text, uint8_t* bitmap) {
+    TextMask mask;
+    rasterizeText(text, &mask);
+    expandTextMask(&mask, bitmap);
+}
 
-    for (int line = 0; line < TEXT_BITMAP_HEIGHT; line++) {
-        current_x = text_start;
-        reduced_width_count = 0;
+// Base image, everything except the ID text overlay. Built at compile time
+// from the same bar layout as generateColorBar()/generatePulseBar() so that
+// generating an image is one 8K copy plus the text rows.
+#define REP2(...)   __VA_ARGS__, __VA_ARGS__
+#define REP4(...)   REP2(__VA_ARGS__), REP2(__VA_ARGS__)
+#define REP8(...)   REP4(__VA_ARGS__), REP4(__VA_ARGS__)
+#define REP16(...)  REP8(__VA_ARGS__), REP8(__VA_ARGS__)
+#define REP14(...)  REP8(__VA_ARGS__), REP4(__VA_ARGS__), REP2(__VA_ARGS__)
+
+// 128 pixel lines
+#define LINE_COLOR_BARS  REP16(COLOR_BLACK), REP16(COLOR_WHITE), REP16(COLOR_YELLOW), REP16(COLOR_CYAN), \
+                         REP16(COLOR_GREEN), REP16(COLOR_MAGENTA), REP16(COLOR_RED), REP16(COLOR_BLUE)
+#define LINE_RED         REP8(REP16(COLOR_RED))
+#define LINE_BLACK       REP8(REP16(COLOR_BLACK))
+// Pulse at pixel 72 (centre of magenta bar), white bar at pixels 96-111.
+#define LINE_PULSE_BAR   REP4(REP16(COLOR_BLACK)), REP8(COLOR_BLACK), COLOR_WHITE, \
+                         REP16(COLOR_BLACK), REP4(COLOR_BLACK), REP2(COLOR_BLACK), COLOR_BLACK, \
+                         REP16(COLOR_WHITE), REP16(COLOR_BLACK)
+
+// 2K pattern block, initial line, 14 text area lines then line 16.
+#define PATTERN_BLOCK(initial, text, line16)  initial, REP14(text), line16
+
+static const uint8_t base_image[] = {
+    PATTERN_BLOCK(LINE_COLOR_BARS, LINE_COLOR_BARS, LINE_COLOR_BARS),  // PATTERN_BARS
+    PATTERN_BLOCK(LINE_COLOR_BARS, LINE_COLOR_BARS, LINE_RED),         // PATTERN_RED
+    PATTERN_BLOCK(LINE_COLOR_BARS, LINE_COLOR_BARS, LINE_PULSE_BAR),   // PATTERN_PULSE
+    PATTERN_BLOCK(LINE_BLACK,      LINE_BLACK,      LINE_BLACK),       // PATTERN_BLACK
+};
+
+_Static_assert(sizeof(base_image) == EPROM_SIZE, "base image must fill the EPROM");
+
+// Return the text independent base image.
+const uint8_t* getBaseImage(void) {
+    return base_image;
+}
 
-        for (int char_pos = 0; char_pos < text_length; char_pos++) {
-            char c = text[char_pos];
+// Region index (pattern * 3 + REGION_x) of an image address. Addresses
+// above 8K wrap, each 8K bank has the same layout.
+int getRegionIndex(uint32_t addr) {
+    int pattern = (addr >> 11) & 0x03;     // A11-A12
+    int offset = addr & (PATTERN_SIZE - 1);
+    int type;
+
+    if (offset < TEXT_START) {
+        type = REGION_INITIAL;
+    } else if (offset < LINE_16_OFFSET) {
+        type = REGION_TEXT;
+    } else {
+        type = REGION_LINE_16;
+    }
+    return pattern * REGIONS_PER_PATTERN + type;
+}
 
-            // Handle space character FIRST
-            if (c == ' ') {
-                current_x += CHAR_WIDTH + TEXT_INTER_SPACE; // Advance current_x for space
-                continue; // Skip to the next character
-            }
-            // return index of current char from bitmap array.
-            int char_index = getCharIndex(c);
-
-            // Begin formating other chars except space.
-            if (char_index != -1) {
-                int font_offset = char_index * CHAR_WIDTH;
-                int char_width = CHAR_WIDTH;
-
-                // special condition to reduce 'I' and '1' be a pixel each side. (match original text mapping)
-                if (c == '1' || c == 'I') {
-                    char_width--; // Reduce the width for '1' and 'I' to by a pixel left.
-                    current_x -= (reduced_width_count + 1); // Shift '1'/'I' and account for previous reduced width chars by a pixel right.
-                } else {
-                    // Adjust current_x for reduced-width characters encountered so far (for other chars)
-                    current_x -= reduced_width_count;
-                }
+// Pattern names, the one list behind getPatternName() and getRegionName().
+#define PATTERN_1_NAME  "Pattern 1 Color Bars"
+#define PATTERN_2_NAME  "Pattern 2 Split Red"
+#define PATTERN_3_NAME  "Pattern 3 Pulse & Bar"
+#define PATTERN_4_NAME  "Pattern 4 Color Black"
+
+// Printable name of a pattern, 0-3.
+const char* getPatternName(int pattern) {
+    static const char* const names[NUM_PATTERNS] = {
+        PATTERN_1_NAME, PATTERN_2_NAME, PATTERN_3_NAME, PATTERN_4_NAME,
+    };
+    if (pattern < 0 || pattern >= NUM_PATTERNS) {
+        return "unknown";
+    }
+    return names[pattern];
+}
 
-                for (int char_pixel = 0; char_pixel < CHAR_WIDTH; char_pixel++) {
-                    if (font_data[font_offset + char_pixel] & (1 << line)) {
-                        int pixel_pos = current_x + char_pixel;
-                        if (pixel_pos < PIXELS_PER_LINE) {
-                            bitmap[line * PIXELS_PER_LINE + pixel_pos] = COLOR_WHITE;
-                        }
-                    }
-                }
-                current_x += char_width + TEXT_INTER_SPACE;  
-            }
-        }
+// Printable name of a region index.
+const char* getRegionName(int region) {
+    static const char* const names[NUM_REGIONS] = {
+        PATTERN_1_NAME "  - initial",
+        PATTERN_1_NAME "  - text area",
+        PATTERN_1_NAME "  - line 16",
+        PATTERN_2_NAME "   - initial",
+        PATTERN_2_NAME "   - text area",
+        PATTERN_2_NAME "   - line 16",
+        PATTERN_3_NAME " - initial",
+        PATTERN_3_NAME " - text area",
+        PATTERN_3_NAME " - line 16",
+        PATTERN_4_NAME " - initial",
+        PATTERN_4_NAME " - text area",
+        PATTERN_4_NAME " - line 16",
+    };
+    if (region < 0 || region >= NUM_REGIONS) {
+        return "unknown";
     }
+    return names[region];
 }
 
-// Generate pattern format in EPROM buffer.
+// Generate pattern format in EPROM buffer. bitmap_data (896 bytes) receives
+// the text bitmap, it may be NULL when only the image is wanted.
 bool generateEpromData(uint8_t* eprom_data, uint8_t* bitmap_data, const char* id_text) {
-    if (!eprom_data) {
-        fprintf(stderr, "Error: NULL EPROM data buffer\n");
+    if (!eprom_data || !id_text) {
         return false;
     }
 
-   // Initialize EPROM buffer to black.
-    memset(eprom_data, COLOR_BLACK, EPROM_SIZE);
-
-    // Generate the text bitmap
-    generateTextBitmap(id_text, bitmap_data);
-    
-    //  2K jump to the pattern offset.
-    for (int section = 0; section < 4; section++) {
-        int base_addr;
-        switch(section) {
-            case 0: base_addr = PATTERN_BARS; break;
-            case 1: base_addr = PATTERN_RED; break;
-            case 2: base_addr = PATTERN_PULSE; break;
-            case 3: base_addr = PATTERN_BLACK; break;
-        }
+    // Start from the base image, only the text rows differ per ID.
+    memcpy(eprom_data, base_image, EPROM_SIZE);
 
-        // Create the top 139 lines of pattern which is always color bars
-        // 74HC383B continually count 128 pixels.
-        for (int pixel = 0; pixel < PIXELS_PER_LINE; pixel++) {
-            int addr = base_addr + pixel;
-            uint8_t pattern;
-
-            if (section == 0 || section == 1 || section == 2) {
-                pattern = generateColorBar(pixel);
-            } else {
-                pattern = COLOR_BLACK;
-                continue; 
-            }
+    // Packed text rows, the byte bitmap is only expanded for callers that
+    // want it (debug character map).
+    TextMask mask;
+    rasterizeText(id_text, &mask);
+    if (bitmap_data) {
+        expandTextMask(&mask, bitmap_data);
+    }
 
-            eprom_data[addr] = pattern;
-        }
+    // Text is overlaid on colour bars in the first three patterns, pattern 4
+    // stays black. Text pixels are COLOR_WHITE blended over the bar row by
+    // the SIMD kernel of blend.c. Each row is built once in the colour bar
+    // block then copied to the odd/even field and the other two blocks.
+    const int text_sections[] = { PATTERN_BARS, PATTERN_RED, PATTERN_PULSE };
 
-        // loop through each 14 lines to apply the base pattern.
-        for (int line = 0; line < 7; line++) { // 7 lines  with same text on EVEN & ODD fields.
+    for (int line = 0; line < TEXT_BITMAP_HEIGHT; line++) {
+        uint8_t* row = eprom_data + PATTERN_BARS + TEXT_START + (line * 256);
+        blendTextRow(row, row, mask.rows[line]);
 
-            // Even/Odd fields flipper.
+        for (int section = 0; section < 3; section++) {
             for (int field = 0; field < 2; field++) {
-                int line_addr = base_addr + TEXT_START + (line * 256) + (field * 128);
-                // Pattern background write to buffer
-                for (int pixel = 0; pixel < PIXELS_PER_LINE; pixel++) {
-                    int addr = line_addr + pixel;
-                    uint8_t pattern;
-                    // Lay pattern behind TEXT overlay for colorbars and pulse&bar.
-                    if (section == 0 || section == 1 || section == 2) {
-                        pattern = generateColorBar(pixel);
-                    } else {
-                        pattern = COLOR_BLACK;
-                        continue; 
-                    }
-                    // Apply text overlay line from char bitmap over pattern
-                    if ((section == 0 || section == 1 || section == 2) && bitmap_data[line * PIXELS_PER_LINE + pixel]) {
-                        pattern = COLOR_WHITE;
-                    }
-                    eprom_data[addr] = pattern;
+                uint8_t* dest = eprom_data + text_sections[section] + TEXT_START + (line * 256) + (field * 128);
+                if (dest != row) {
+                    memcpy(dest, row, PIXELS_PER_LINE);
                 }
             }
         }
-
-        // line 16 pattern to end of field.
-        for (int pixel = 0; pixel < PIXELS_PER_LINE; pixel++) {
-            int addr = base_addr + LINE_16_OFFSET + pixel;
-            uint8_t pattern;
-
-            if (section == 0) {
-                pattern = generateColorBar(pixel);
-            } else if (section == 1) {
-                pattern = COLOR_RED;
-            } else if (section == 2) {
-                pattern = generatePulseBar(pixel);
-            } else {
-                pattern = COLOR_BLACK;
-                continue; 
-            }
-
-            eprom_data[addr] = pattern;
-        }
-
     }
 
     return true;
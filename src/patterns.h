@@ -49,6 +49,14 @@
 #define TEXT_AREA_OFFSET  0x800   // Text area in each pattern block
 #define LINE_16_OFFSET    0x780   // Start of line 16 pattern
 
+// Address regions, 3 per pattern block (initial, text area, line 16)
+#define NUM_PATTERNS      4
+#define REGION_INITIAL    0       // PATTERN_x + 0x000 - 0x07F
+#define REGION_TEXT       1       // PATTERN_x + TEXT_START - 0x77F
+#define REGION_LINE_16    2       // PATTERN_x + LINE_16_OFFSET - 0x7FF
+#define REGIONS_PER_PATTERN 3
+#define NUM_REGIONS       (NUM_PATTERNS * REGIONS_PER_PATTERN)
+
 // Character and text bitmap dimensions
 #define CHAR_WIDTH                          5   // Width of each character in pixels
 #define TEXT_BITMAP_HEIGHT                  7   // Height of the text bitmap
@@ -126,11 +134,25 @@ static const unsigned char font_data[] = {
 };
 
 
+// Text rows packed one bit per pixel, bit p of word p / 64 is pixel p
+typedef struct {
+    uint64_t rows[TEXT_BITMAP_HEIGHT][2];
+} TextMask;
+
 // Pattern generation functions
 uint8_t generateColorBar(int pixel_pos);
 uint8_t generatePulseBar(int pixel_pos);
 void generateTextBitmap(const char* text, uint8_t* bitmap);
+void rasterizeText(const char* text, TextMask* mask);
+void expandTextMask(const TextMask* mask, uint8_t* bitmap);
+const void* getGlyphAtlas(size_t* size);
 bool generateEpromData(uint8_t* eprom_data, uint8_t* bitmap_data, const char* id_text);
+const uint8_t* getBaseImage(void);
+
+// Address layout functions
+int getRegionIndex(uint32_t addr);
+const char* getRegionName(int region);
+const char* getPatternName(int pattern);
 
 #endif // PATTERNS_H
 
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ pt430.c  libpt430, the public API over patterns.c and encoder.c.
+
+ The library is pt430.o, patterns.o, blend.o, encoder.o and arena.o; none
+ of them print or read the debug/quiet flags of tcgen, which keeps the
+ format list parsing and the --selftest report in its own objects. The
+ API here encodes through a PT430_SCRATCH_SIZE buffer on the stack that is
+ drained to the caller's sink whenever it fills, so it allocates nothing;
+ encoder.o and arena.o only allocate when a growable OutputBuffer or an
+ Arena of their internal callers grows. The only shared state is the blend
+ kernel choice, which is made once from the CPU and stored atomically.
+ */
+
+#include "pt430.h"
+#include "patterns.h"
+#include "encoder.h"
+#include "version.h"
+
+#include <string.h>
+
+#define PT430_SCRATCH_SIZE  ENCODER_CHUNK_SIZE
+
+_Static_assert(PT430_IMAGE_SIZE == EPROM_SIZE, "PT430_IMAGE_SIZE must match EPROM_SIZE");
+_Static_assert(PT430_MAX_TEXT == MAX_TEXT_LENGTH, "PT430_MAX_TEXT must match MAX_TEXT_LENGTH");
+_Static_assert(PT430_BITMAP_WIDTH == TEXT_BITMAP_WIDTH && PT430_BITMAP_HEIGHT == TEXT_BITMAP_HEIGHT,
+               "PT430_BITMAP_x must match TEXT_BITMAP_x");
+_Static_assert(PT430_RECORD_MAX == HEX_RECORD_MAX, "PT430_RECORD_MAX must match HEX_RECORD_MAX");
+
+const char* pt430Version(void) {
+    return VERSION_STRING;
+}
+
+const char* pt430StatusString(Pt430Status status) {
+    switch (status) {
+        case PT430_OK:                return "ok";
+        case PT430_ERROR_ARGUMENT:    return "invalid argument";
+        case PT430_ERROR_TEXT_LENGTH: return "text longer than 14 characters";
+        case PT430_ERROR_TEXT_CHAR:   return "invalid text character";
+        case PT430_ERROR_BUFFER:      return "buffer too small";
+        case PT430_ERROR_FORMAT:      return "unknown output format";
+        case PT430_ERROR_RANGE:       return "image too large for the output format";
+        case PT430_ERROR_SINK:        return "output sink failed";
+    }
+    return "unknown status";
+}
+
+// A-Z (either case), 0-9, space, hyphen and colon.
+static int isTextChar(char c) {
+    return c == ' ' || c == '-' || c == ':' ||
+           (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+           (c >= '0' && c <= '9');
+}
+
+Pt430Status pt430ValidateText(const char* text, size_t* position) {
+    if (!text) {
+        return PT430_ERROR_ARGUMENT;
+    }
+    for (size_t i = 0; text[i]; i++) {
+        if (i == PT430_MAX_TEXT) {
+            if (position) *position = i;
+            return PT430_ERROR_TEXT_LENGTH;
+        }
+        if (!isTextChar(text[i])) {
+            if (position) *position = i;
+            return PT430_ERROR_TEXT_CHAR;
+        }
+    }
+    return PT430_OK;
+}
+
+Pt430Status pt430GenerateImage(const char* text, uint8_t* image, size_t image_size) {
+    if (!image) {
+        return PT430_ERROR_ARGUMENT;
+    }
+    if (image_size < PT430_IMAGE_SIZE) {
+        return PT430_ERROR_BUFFER;
+    }
+    Pt430Status status = pt430ValidateText(text, NULL);
+    if (status != PT430_OK) {
+        return status;
+    }
+    return generateEpromData(image, NULL, text) ? PT430_OK : PT430_ERROR_ARGUMENT;
+}
+
+Pt430Status pt430GenerateBitmap(const char* text, uint8_t* bitmap, size_t bitmap_size) {
+    if (!bitmap) {
+        return PT430_ERROR_ARGUMENT;
+    }
+    if (bitmap_size < PT430_BITMAP_SIZE) {
+        return PT430_ERROR_BUFFER;
+    }
+    Pt430Status status = pt430ValidateText(text, NULL);
+    if (status != PT430_OK) {
+        return status;
+    }
+    generateTextBitmap(text, bitmap);
+    return PT430_OK;
+}
+
+const char* pt430GetFormat(int index, const char** suffix, const char** description) {
+    const EncoderFormat* format = getEncoderFormat(index);
+    if (!format) {
+        return NULL;
+    }
+    if (suffix) *suffix = format->suffix;
+    if (description) *description = format->description;
+    return format->name;
+}
+
+// OutputSink adapter for a Pt430Sink.
+static int writeSink(void* context, const char* data, size_t size) {
+    const Pt430Sink* sink = (const Pt430Sink*)context;
+    return sink->write(sink->context, data, size) != 0;
+}
+
+Pt430Status pt430Encode(const char* format, const uint8_t* image, size_t length,
+                        const Pt430EncodeOptions* options, const Pt430Sink* sink) {
+    if (!format || !image || !sink || !sink->write || length > UINT32_MAX) {
+        return PT430_ERROR_ARGUMENT;
+    }
+    EncoderList list = { { findEncoderFormat(format) }, 1 };
+    if (!list.formats[0]) {
+        return PT430_ERROR_FORMAT;
+    }
+    if (findEncoderLimit(&list, (uint32_t)length)) {
+        return PT430_ERROR_RANGE;
+    }
+
+    HexOptions hex = { PT430_RECORD_DEFAULT, false };
+    if (options) {
+        if (options->record_len < 0 || options->record_len > PT430_RECORD_MAX) {
+            return PT430_ERROR_ARGUMENT;
+        }
+        if (options->record_len > 0) {
+            hex.record_len = options->record_len;
+        }
+        hex.linear_address = options->linear_address != 0;
+    }
+
+    // Fixed buffers only fail when the sink does.
+    char scratch[PT430_SCRATCH_SIZE];
+    OutputBuffer out = { scratch, 0, sizeof(scratch), false, true, writeSink, (void*)sink };
+    return encodeImage(image, (uint32_t)length, &list, &hex, &out) ? PT430_OK : PT430_ERROR_SINK;
+}
+
+// Copies into the caller's buffer while it has room, counts everything.
+typedef struct {
+    char*  out;
+    size_t size;
+    size_t written;
+} BufferSink;
+
+static int writeBuffer(void* context, const char* data, size_t size) {
+    BufferSink* buffer = (BufferSink*)context;
+    if (buffer->written <= buffer->size && size <= buffer->size - buffer->written) {
+        memcpy(buffer->out + buffer->written, data, size);
+    }
+    buffer->written += size;
+    return 1;
+}
+
+Pt430Status pt430EncodeToBuffer(const char* format, const uint8_t* image, size_t length,
+                                const Pt430EncodeOptions* options, char* out, size_t out_size,
+                                size_t* written) {
+    BufferSink buffer = { out, out ? out_size : 0, 0 };
+    Pt430Sink sink = { writeBuffer, &buffer };
+
+    Pt430Status status = pt430Encode(format, image, length, options, &sink);
+    if (written) {
+        *written = buffer.written;
+    }
+    if (status == PT430_OK && buffer.written > buffer.size) {
+        return PT430_ERROR_BUFFER;
+    }
+    return status;
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ pt430.h  public interface of libpt430, the PT-430 EPROM generator library.
+
+ This is the only header a program using libpt430.a / libpt430.so needs.
+ Every function works on caller provided buffers or sinks, returns a
+ Pt430Status instead of printing, does not allocate and keeps no state
+ between calls, so any number of threads may call it at once.
+
+   uint8_t image[PT430_IMAGE_SIZE];
+   if (pt430GenerateImage("VK3DG", image, sizeof(image)) == PT430_OK)
+       pt430Encode("hex", image, sizeof(image), NULL, &sink);
+ */
+
+#ifndef PT430_H
+#define PT430_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Exported from the shared library, the rest of it is built hidden.
+#if defined(_WIN32) && defined(PT430_BUILD)
+#define PT430_API __declspec(dllexport)
+#elif defined(__GNUC__)
+#define PT430_API __attribute__((visibility("default")))
+#else
+#define PT430_API
+#endif
+
+#define PT430_IMAGE_SIZE      8192    // 27C64 image
+#define PT430_MAX_TEXT        14      // ID characters
+#define PT430_BITMAP_WIDTH    128
+#define PT430_BITMAP_HEIGHT   7
+#define PT430_BITMAP_SIZE     (PT430_BITMAP_WIDTH * PT430_BITMAP_HEIGHT)
+#define PT430_RECORD_DEFAULT  16      // Data bytes per record
+#define PT430_RECORD_MAX      255
+
+typedef enum {
+    PT430_OK = 0,
+    PT430_ERROR_ARGUMENT,           // NULL pointer or option out of range
+    PT430_ERROR_TEXT_LENGTH,        // ID longer than PT430_MAX_TEXT
+    PT430_ERROR_TEXT_CHAR,          // ID character outside A-Z, 0-9, space, '-' and ':'
+    PT430_ERROR_BUFFER,             // Caller buffer too small
+    PT430_ERROR_FORMAT,             // Unknown output format name
+    PT430_ERROR_RANGE,              // Image too large for the format's addresses
+    PT430_ERROR_SINK                // The sink returned 0
+} Pt430Status;
+
+// Receives encoded output in pieces, returns 0 to stop with PT430_ERROR_SINK.
+typedef struct {
+    int  (*write)(void* context, const char* data, size_t size);
+    void* context;
+} Pt430Sink;
+
+// Encoder options, NULL or zeroed gives the defaults.
+typedef struct {
+    int record_len;                 // Data bytes per record (hex, srec, tek), 0 = PT430_RECORD_DEFAULT
+    int linear_address;             // Intel HEX: emit the type-04 record even below 64K
+} Pt430EncodeOptions;
+
+// Library version, "1.0.0".
+PT430_API const char* pt430Version(void);
+
+// Text of a status code.
+PT430_API const char* pt430StatusString(Pt430Status status);
+
+// Check an ID, position (may be NULL) is set to the offending character.
+PT430_API Pt430Status pt430ValidateText(const char* text, size_t* position);
+
+// Fill image (at least PT430_IMAGE_SIZE bytes) with the EPROM image for text.
+PT430_API Pt430Status pt430GenerateImage(const char* text, uint8_t* image, size_t image_size);
+
+// Fill bitmap (at least PT430_BITMAP_SIZE bytes) with the text bitmap, one
+// byte per pixel, 0xFF where the ID is drawn.
+PT430_API Pt430Status pt430GenerateBitmap(const char* text, uint8_t* bitmap, size_t bitmap_size);
+
+// Output format names, index 0 up, NULL past the last. suffix and
+// description may be NULL.
+PT430_API const char* pt430GetFormat(int index, const char** suffix, const char** description);
+
+// Encode an image as format ("hex", "bin", "srec", "tek" or "dump") into sink.
+PT430_API Pt430Status pt430Encode(const char* format, const uint8_t* image, size_t length,
+                                  const Pt430EncodeOptions* options, const Pt430Sink* sink);
+
+// Encode into out. written (may be NULL) is set to the encoded size, also
+// when out is too small and PT430_ERROR_BUFFER is returned, so a call with
+// out_size 0 asks for the size.
+PT430_API Pt430Status pt430EncodeToBuffer(const char* format, const uint8_t* image, size_t length,
+                                          const Pt430EncodeOptions* options, char* out, size_t out_size,
+                                          size_t* written);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PT430_H
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ render.c  expands an 8K EPROM image into full PAL frames the way the PT-430
+           walks its address lines, so a pattern can be seen without burning
+           an EPROM.
+
+ Address counter model:
+   - A0-A6:   74HC393 pixel counter, 128 pixels across the active line.
+   - A7-A10:  CD4520 line counter, reset by vertical sync. Field lines 1-140
+              stay on state 0 (initial pattern), lines 141-154 step through
+              states 1-14 (the odd/even text area lines), from line 155 the
+              counter holds at state 15 (line 16 pattern) until the next
+              vertical reset.
+   - A11-A12: pattern select switch.
+ Both fields run the same sequence, so every field line maps to one of 16
+ EPROM lines. Each of those is expanded once per frame through a palette and
+ a pixel position table, the frame is then built from row copies. There is
+ no SIMD code here: nearly all of a frame is those row copies, and memcpy is
+ already vectorised. A frame takes about 25-75 us.
+
+ EPROM data D0 green, D1 red, D2 blue at 75% and D3 white at 100%.
+ */
+
+#include "render.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+// Counter state (EPROM line A7-A10) for a field line counted from 1 at the
+// vertical reset.
+int getCounterState(int field_line) {
+    if (field_line <= LINES_PER_FIELD) {
+        return 0;
+    }
+    if (field_line <= LINES_PER_FIELD + TEXT_LINES) {
+        return field_line - LINES_PER_FIELD;
+    }
+    return COUNTER_LINE_16;
+}
+
+// EPROM address presented by the counters for a pattern, field line and pixel.
+uint32_t getPixelAddress(int pattern, int field_line, int pixel) {
+    return ((uint32_t)(pattern & 0x03) << 11) |
+           ((uint32_t)getCounterState(field_line) << 7) |
+           (uint32_t)(pixel & (PIXELS_PER_LINE - 1));
+}
+
+size_t getFrameSize(FrameFormat format) {
+    if (format == FRAME_YUV420) {
+        return FRAME_WIDTH * FRAME_HEIGHT * 3 / 2;
+    }
+    return FRAME_WIDTH * FRAME_HEIGHT * 3;
+}
+
+// RGB for a data nibble.
+void nibbleToRgb(uint8_t value, uint8_t rgb[3]) {
+    if (value & (1 << WHITE_BIT)) {
+        rgb[0] = rgb[1] = rgb[2] = LEVEL_WHITE;
+        return;
+    }
+    rgb[0] = (value & (1 << RED_BIT))   ? LEVEL_COLOR : 0;
+    rgb[1] = (value & (1 << GREEN_BIT)) ? LEVEL_COLOR : 0;
+    rgb[2] = (value & (1 << BLUE_BIT))  ? LEVEL_COLOR : 0;
+}
+
+// BT.601 studio range Y, Cb, Cr for a data nibble.
+static void nibbleToYuv(uint8_t value, uint8_t yuv[3]) {
+    uint8_t rgb[3];
+    nibbleToRgb(value, rgb);
+    int r = rgb[0], g = rgb[1], b = rgb[2];
+    yuv[0] = (uint8_t)(16  + (( 66 * r + 129 * g +  25 * b + 128) >> 8));
+    yuv[1] = (uint8_t)(128 + ((-38 * r -  74 * g + 112 * b + 128) >> 8));
+    yuv[2] = (uint8_t)(128 + ((112 * r -  94 * g -  18 * b + 128) >> 8));
+}
+
+// Render one pattern (0-3) of an 8K image into a full interlaced frame.
+int renderFrame(const uint8_t* image, int pattern, FrameFormat format, uint8_t* frame) {
+    // Expanded EPROM line per counter state.
+    uint8_t rows[COUNTER_STATES][FRAME_WIDTH * 3];
+    uint8_t source_x[FRAME_WIDTH];
+    uint8_t palette[16][3];
+
+    if (!image || !frame || pattern < 0 || pattern >= NUM_PATTERNS) {
+        fprintf(stderr, "Error: Invalid frame render request\n");
+        return 0;
+    }
+
+    for (int v = 0; v < 16; v++) {
+        if (format == FRAME_YUV420) {
+            nibbleToYuv((uint8_t)v, palette[v]);
+        } else {
+            nibbleToRgb((uint8_t)v, palette[v]);
+        }
+    }
+    for (int x = 0; x < FRAME_WIDTH; x++) {
+        source_x[x] = (uint8_t)(x * PIXELS_PER_LINE / FRAME_WIDTH);
+    }
+
+    // Expand the 16 EPROM lines of this pattern.
+    for (int state = 0; state < COUNTER_STATES; state++) {
+        const uint8_t* line = image + pattern * PATTERN_SIZE + state * PIXELS_PER_LINE;
+        uint8_t* row = rows[state];
+
+        if (format == FRAME_YUV420) {
+            // Y row, then Cb and Cr rows at half width.
+            for (int x = 0; x < FRAME_WIDTH; x++) {
+                row[x] = palette[line[source_x[x]] & 0x0F][0];
+            }
+            for (int x = 0; x < FRAME_WIDTH / 2; x++) {
+                const uint8_t* a = palette[line[source_x[2 * x]] & 0x0F];
+                const uint8_t* b = palette[line[source_x[2 * x + 1]] & 0x0F];
+                row[FRAME_WIDTH + x] = (uint8_t)((a[1] + b[1] + 1) >> 1);
+                row[FRAME_WIDTH + FRAME_WIDTH / 2 + x] = (uint8_t)((a[2] + b[2] + 1) >> 1);
+            }
+        } else {
+            for (int x = 0; x < FRAME_WIDTH; x++) {
+                const uint8_t* rgb = palette[line[source_x[x]] & 0x0F];
+                row[3 * x + 0] = rgb[0];
+                row[3 * x + 1] = rgb[1];
+                row[3 * x + 2] = rgb[2];
+            }
+        }
+    }
+
+    // Frame line y is line y / 2 of field 1 (even) or field 2 (odd). Both
+    // fields run the same counter sequence.
+    if (format == FRAME_YUV420) {
+        uint8_t* plane_y = frame;
+        uint8_t* plane_u = frame + FRAME_WIDTH * FRAME_HEIGHT;
+        uint8_t* plane_v = plane_u + (FRAME_WIDTH / 2) * (FRAME_HEIGHT / 2);
+
+        for (int y = 0; y < FRAME_HEIGHT; y++) {
+            int state = getCounterState(FIELD_FIRST_ACTIVE + y / 2);
+            memcpy(plane_y + y * FRAME_WIDTH, rows[state], FRAME_WIDTH);
+        }
+        // Chroma row c covers frame lines 2c and 2c+1, both field line c.
+        for (int c = 0; c < FRAME_HEIGHT / 2; c++) {
+            int state = getCounterState(FIELD_FIRST_ACTIVE + c);
+            memcpy(plane_u + c * (FRAME_WIDTH / 2), rows[state] + FRAME_WIDTH, FRAME_WIDTH / 2);
+            memcpy(plane_v + c * (FRAME_WIDTH / 2), rows[state] + FRAME_WIDTH + FRAME_WIDTH / 2, FRAME_WIDTH / 2);
+        }
+    } else {
+        for (int y = 0; y < FRAME_HEIGHT; y++) {
+            int state = getCounterState(FIELD_FIRST_ACTIVE + y / 2);
+            memcpy(frame + y * FRAME_WIDTH * 3, rows[state], FRAME_WIDTH * 3);
+        }
+    }
+
+    return 1;
+}
+
+// Frame format from the file extension: .ppm and .rgb are RGB, .yuv is I420.
+int getFrameFormat(const char* filename, FrameFormat* format) {
+    const char* ext = strrchr(filename, '.');
+    if (ext && (strcasecmp(ext, ".ppm") == 0 || strcasecmp(ext, ".rgb") == 0)) {
+        *format = FRAME_RGB24;
+        return 1;
+    }
+    if (ext && strcasecmp(ext, ".yuv") == 0) {
+        *format = FRAME_YUV420;
+        return 1;
+    }
+    fprintf(stderr, "Error: Unknown frame format for %s (use .ppm, .rgb or .yuv)\n", filename);
+    return 0;
+}
+
+// Write a rendered frame, PPM files get a P6 header.
+int writeFrameFile(const char* filename, const uint8_t* frame, FrameFormat format) {
+    FILE* fp = fopen(filename, "wb");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open file %s for writing\n", filename);
+        return 0;
+    }
+
+    const char* ext = strrchr(filename, '.');
+    if (ext && strcasecmp(ext, ".ppm") == 0) {
+        fprintf(fp, "P6\n%d %d\n255\n", FRAME_WIDTH, FRAME_HEIGHT);
+    }
+
+    size_t size = getFrameSize(format);
+    size_t written = fwrite(frame, 1, size, fp);
+    fclose(fp);
+
+    if (written != size) {
+        fprintf(stderr, "Error: Only wrote %zu of %zu bytes\n", written, size);
+        return 0;
+    }
+
+    if (!quiet_enabled) {
+        printf("Frame written: %s (%dx%d)\n", filename, FRAME_WIDTH, FRAME_HEIGHT);
+    }
+    return 1;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ render.h  include for render.c
+ */
+
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "patterns.h"
+#include <stdint.h>
+#include <stddef.h>
+
+// PAL 625 line interlaced raster
+#define FRAME_LINES          625
+#define FRAME_WIDTH          720     // Active samples per line (BT.601)
+#define FRAME_HEIGHT         576     // Active lines per frame
+#define FIELD_ACTIVE_LINES   288     // Active lines per field
+
+// First active line of a field (BT.601, field line numbering from 1)
+#define FIELD_FIRST_ACTIVE   23
+
+// Colour levels for the data nibble
+#define LEVEL_COLOR          191     // 75% bars
+#define LEVEL_WHITE          255
+
+// Line counter (CD4520) states, A7-A10
+#define COUNTER_STATES       16      // 0 initial, 1-14 text area, 15 line 16
+#define COUNTER_LINE_16      15
+
+// Output frame formats
+typedef enum {
+    FRAME_RGB24,                     // Packed R,G,B
+    FRAME_YUV420,                    // Planar Y, U, V (I420), BT.601 studio range
+} FrameFormat;
+
+// Frame rendering functions
+void nibbleToRgb(uint8_t value, uint8_t rgb[3]);
+int getCounterState(int field_line);
+uint32_t getPixelAddress(int pattern, int field_line, int pixel);
+size_t getFrameSize(FrameFormat format);
+int renderFrame(const uint8_t* image, int pattern, FrameFormat format, uint8_t* frame);
+int writeFrameFile(const char* filename, const uint8_t* frame, FrameFormat format);
+int getFrameFormat(const char* filename, FrameFormat* format);
+
+#endif // RENDER_H
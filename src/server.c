@@ -0,0 +1,615 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ server.c  resident generator (tcgen --serve <socket>). Clients send framed
+           requests over a Unix domain socket and get the image bytes back
+           from memory, no process start up and no files.
+
+ One thread runs a poll() loop over the listening socket and up to
+ SERVER_MAX_CLIENTS connections, an image takes microseconds so nothing is
+ gained from more threads. Images are kept in an LRU cache keyed by the
+ generator version and ID text (hash chains plus a most recently used
+ list), the Intel HEX text is encoded on the first request for it and kept
+ with the image. An evicted entry keeps its HEX buffer for the next image,
+ so once the cache is full a request makes no heap allocations. A stats
+ request returns counters, cache hit rate and the p50/p99 service latency
+ of the last SERVER_LATENCY_SAMPLES requests.
+
+ Wire format is in server.h.
+ */
+
+#include "server.h"
+#include "patterns.h"
+#include "encoder.h"
+#include "pt430.h"
+#include "tcgen.h"
+#include "version.h"
+#include "alloccount.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#define SERVER_OUTPUT_BACKLOG   (1 << 20)   // Stop reading a client with this much unsent
+
+// Cached image
+typedef struct CacheEntry {
+    uint64_t hash;
+    char     id_text[MAX_TEXT_LENGTH + 1];
+    uint8_t  image[EPROM_SIZE];
+    char*    hex;                           // Intel HEX text, encoded on first use
+    size_t   hex_size;
+    struct CacheEntry* prev;                // LRU list, head is most recent
+    struct CacheEntry* next;
+    struct CacheEntry* chain;               // Hash bucket chain
+} CacheEntry;
+
+typedef struct {
+    CacheEntry*  entries;
+    CacheEntry** buckets;
+    size_t       bucket_mask;
+    int          capacity;
+    int          used;
+    CacheEntry*  head;
+    CacheEntry*  tail;
+} ImageCache;
+
+// One connection, input frame buffer and pending output.
+typedef struct {
+    int      fd;
+    uint8_t  in[4 + SERVER_REQUEST_MAX];
+    size_t   in_len;
+    uint8_t* out;
+    size_t   out_len;
+    size_t   out_sent;
+    size_t   out_cap;
+    int      closing;                       // Close once the output is sent
+} Client;
+
+typedef struct {
+    uint64_t connections;
+    uint64_t requests;
+    uint64_t generate;
+    uint64_t stats;
+    uint64_t errors;
+    uint64_t hits;
+    uint64_t misses;
+    double   latency[SERVER_LATENCY_SAMPLES];   // Microseconds, ring buffer
+    uint64_t latency_count;
+    double   start;
+} ServerStats;
+
+static volatile sig_atomic_t server_stop = 0;
+
+static void onStopSignal(int sig) {
+    (void)sig;
+    server_stop = 1;
+}
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t getBe32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void putBe32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+// FNV-1a of the generator version and ID text, a new version never serves
+// an image cached by an old one.
+static uint64_t hashKey(const char* id_text) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (const char* p = VERSION_STRING; *p; p++) {
+        h = (h ^ (uint8_t)*p) * 0x100000001B3ULL;
+    }
+    h = (h ^ 0) * 0x100000001B3ULL;
+    for (const char* p = id_text; *p; p++) {
+        h = (h ^ (uint8_t)*p) * 0x100000001B3ULL;
+    }
+    return h;
+}
+
+static int initCache(ImageCache* cache, int capacity) {
+    size_t buckets = 1;
+    while (buckets < (size_t)capacity * 2) {
+        buckets <<= 1;
+    }
+    memset(cache, 0, sizeof(*cache));
+    cache->entries = (CacheEntry*)calloc(capacity, sizeof(CacheEntry));
+    cache->buckets = (CacheEntry**)calloc(buckets, sizeof(CacheEntry*));
+    if (!cache->entries || !cache->buckets) {
+        free(cache->entries);
+        free(cache->buckets);
+        return 0;
+    }
+    cache->bucket_mask = buckets - 1;
+    cache->capacity = capacity;
+    return 1;
+}
+
+static void freeCache(ImageCache* cache) {
+    for (int i = 0; i < cache->used; i++) {
+        free(cache->entries[i].hex);
+    }
+    free(cache->entries);
+    free(cache->buckets);
+}
+
+static void unlinkLru(ImageCache* cache, CacheEntry* entry) {
+    if (entry->prev) entry->prev->next = entry->next; else cache->head = entry->next;
+    if (entry->next) entry->next->prev = entry->prev; else cache->tail = entry->prev;
+    entry->prev = entry->next = NULL;
+}
+
+static void pushLru(ImageCache* cache, CacheEntry* entry) {
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head) cache->head->prev = entry; else cache->tail = entry;
+    cache->head = entry;
+}
+
+// Cached image for id_text, generated into the least recently used entry on
+// a miss. NULL only if generation fails.
+static CacheEntry* getCachedImage(ImageCache* cache, const char* id_text, ServerStats* stats) {
+    uint64_t hash = hashKey(id_text);
+    CacheEntry** bucket = &cache->buckets[hash & cache->bucket_mask];
+
+    for (CacheEntry* e = *bucket; e; e = e->chain) {
+        if (e->hash == hash && strcmp(e->id_text, id_text) == 0) {
+            if (cache->head != e) {
+                unlinkLru(cache, e);
+                pushLru(cache, e);
+            }
+            stats->hits++;
+            return e;
+        }
+    }
+    stats->misses++;
+
+    CacheEntry* entry;
+    if (cache->used < cache->capacity) {
+        entry = &cache->entries[cache->used++];
+    } else {
+        // Evict the tail, take it off its hash chain.
+        entry = cache->tail;
+        unlinkLru(cache, entry);
+        if (entry->id_text[0]) {
+            CacheEntry** link = &cache->buckets[entry->hash & cache->bucket_mask];
+            while (*link != entry) {
+                link = &(*link)->chain;
+            }
+            *link = entry->chain;
+        }
+        entry->hex_size = 0;                // Buffer is reused, the size is fixed for a run
+    }
+
+    if (pt430GenerateImage(id_text, entry->image, EPROM_SIZE) != PT430_OK) {
+        // Unnamed slot at the tail, reused by the next miss.
+        entry->id_text[0] = '\0';
+        entry->prev = cache->tail;
+        if (cache->tail) cache->tail->next = entry; else cache->head = entry;
+        cache->tail = entry;
+        return NULL;
+    }
+    entry->hash = hash;
+    strcpy(entry->id_text, id_text);
+    entry->chain = *bucket;
+    *bucket = entry;
+    pushLru(cache, entry);
+    return entry;
+}
+
+// Append to a client's pending output.
+static int appendOutput(Client* client, const void* data, size_t len) {
+    if (client->out_len + len > client->out_cap) {
+        size_t cap = client->out_cap ? client->out_cap : 4096;
+        while (cap < client->out_len + len) {
+            cap *= 2;
+        }
+        uint8_t* out = (uint8_t*)realloc(client->out, cap);
+        if (!out) {
+            return 0;
+        }
+        client->out = out;
+        client->out_cap = cap;
+    }
+    memcpy(client->out + client->out_len, data, len);
+    client->out_len += len;
+    return 1;
+}
+
+// Frame header of a response, the length is filled in by endResponse.
+static size_t beginResponse(Client* client, uint8_t status, uint8_t type) {
+    uint8_t head[6] = { 0, 0, 0, 0, status, type };
+    size_t start = client->out_len;
+    appendOutput(client, head, sizeof(head));
+    return start;
+}
+
+static void endResponse(Client* client, size_t start) {
+    putBe32(client->out + start, (uint32_t)(client->out_len - start - 4));
+}
+
+static int appendSection(Client* client, uint8_t format, const void* data, size_t size) {
+    uint8_t head[5] = { format };
+    putBe32(head + 1, (uint32_t)size);
+    return appendOutput(client, head, sizeof(head)) && appendOutput(client, data, size);
+}
+
+static void recordLatency(ServerStats* stats, double seconds) {
+    stats->latency[stats->latency_count % SERVER_LATENCY_SAMPLES] = seconds * 1e6;
+    stats->latency_count++;
+}
+
+static int compareDouble(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Stats text, percentiles over the kept latency samples.
+static void appendStats(Client* client, const ServerStats* stats, const ImageCache* cache, int clients) {
+    static double sorted[SERVER_LATENCY_SAMPLES];
+    size_t count = stats->latency_count < SERVER_LATENCY_SAMPLES ? stats->latency_count : SERVER_LATENCY_SAMPLES;
+    double p50 = 0, p99 = 0, max = 0;
+
+    if (count) {
+        memcpy(sorted, stats->latency, count * sizeof(double));
+        qsort(sorted, count, sizeof(double), compareDouble);
+        p50 = sorted[(count - 1) * 50 / 100];
+        p99 = sorted[(count - 1) * 99 / 100];
+        max = sorted[count - 1];
+    }
+    uint64_t lookups = stats->hits + stats->misses;
+
+    char text[1024];
+    int len = snprintf(text, sizeof(text),
+        "version %s\n"
+        "uptime_s %.3f\n"
+        "connections %llu\n"
+        "clients %d\n"
+        "requests %llu\n"
+        "generate %llu\n"
+        "stats %llu\n"
+        "errors %llu\n"
+        "cache_hits %llu\n"
+        "cache_misses %llu\n"
+        "cache_hit_rate %.4f\n"
+        "cache_entries %d\n"
+        "cache_capacity %d\n"
+        "latency_samples %zu\n"
+        "latency_p50_us %.2f\n"
+        "latency_p99_us %.2f\n"
+        "latency_max_us %.2f\n",
+        VERSION_STRING, nowSeconds() - stats->start,
+        (unsigned long long)stats->connections, clients,
+        (unsigned long long)stats->requests, (unsigned long long)stats->generate,
+        (unsigned long long)stats->stats, (unsigned long long)stats->errors,
+        (unsigned long long)stats->hits, (unsigned long long)stats->misses,
+        lookups ? (double)stats->hits / lookups : 0.0,
+        cache->used, cache->capacity, count, p50, p99, max);
+    appendOutput(client, text, (size_t)len);
+}
+
+// Same rules as validateText, without the messages.
+static int isValidId(const char* text) {
+    return text[0] && pt430ValidateText(text, NULL) == PT430_OK;
+}
+
+// Answer one request frame (payload of len bytes).
+static void handleRequest(Client* client, const uint8_t* payload, size_t len, ImageCache* cache,
+                          ServerStats* stats, const HexOptions* hex, int clients) {
+    double start = nowSeconds();
+    uint8_t type = len ? payload[0] : 0;
+    stats->requests++;
+
+    if (type == SERVER_REQ_STATS && len == 1) {
+        stats->stats++;
+        size_t frame = beginResponse(client, SERVER_OK, type);
+        appendStats(client, stats, cache, clients);
+        endResponse(client, frame);
+        return;
+    }
+
+    uint8_t formats = len >= 2 ? payload[1] : 0;
+    if (type != SERVER_REQ_GENERATE || !formats || (formats & ~(SERVER_FORMAT_BIN | SERVER_FORMAT_HEX))) {
+        stats->errors++;
+        endResponse(client, beginResponse(client, SERVER_BAD_REQUEST, type));
+        return;
+    }
+
+    char id_text[MAX_TEXT_LENGTH + 1];
+    size_t id_len = len - 2;
+    if (id_len > MAX_TEXT_LENGTH || memchr(payload + 2, '\0', id_len)) {
+        id_len = 0;                         // Fails isValidId
+    }
+    memcpy(id_text, payload + 2, id_len);
+    id_text[id_len] = '\0';
+    if (!isValidId(id_text)) {
+        stats->errors++;
+        endResponse(client, beginResponse(client, SERVER_INVALID_TEXT, type));
+        return;
+    }
+
+    stats->generate++;
+    CacheEntry* entry = getCachedImage(cache, id_text, stats);
+    if (entry && (formats & SERVER_FORMAT_HEX) && !entry->hex_size) {
+        size_t size = getHexEncodedSize(EPROM_SIZE, hex);
+        if (!entry->hex) {
+            entry->hex = (char*)malloc(size);
+        }
+        entry->hex_size = entry->hex ? encodeHexImage(entry->image, EPROM_SIZE, hex, entry->hex, size) : 0;
+    }
+    if (!entry || ((formats & SERVER_FORMAT_HEX) && !entry->hex_size)) {
+        stats->errors++;
+        endResponse(client, beginResponse(client, SERVER_ERROR, type));
+        return;
+    }
+
+    size_t frame = beginResponse(client, SERVER_OK, type);
+    if (formats & SERVER_FORMAT_BIN) {
+        appendSection(client, SERVER_FORMAT_BIN, entry->image, EPROM_SIZE);
+    }
+    if (formats & SERVER_FORMAT_HEX) {
+        appendSection(client, SERVER_FORMAT_HEX, entry->hex, entry->hex_size);
+    }
+    endResponse(client, frame);
+    recordLatency(stats, nowSeconds() - start);
+}
+
+// Send what the socket takes. Returns 0 if the connection is dead.
+static int flushClient(Client* client) {
+    while (client->out_sent < client->out_len) {
+        ssize_t n = send(client->fd, client->out + client->out_sent,
+                         client->out_len - client->out_sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        client->out_sent += (size_t)n;
+    }
+    client->out_len = client->out_sent = 0;
+    return 1;
+}
+
+// Read and answer complete frames. Returns 0 when the client is gone.
+static int readClient(Client* client, ImageCache* cache, ServerStats* stats, const HexOptions* hex, int clients) {
+    ssize_t n = recv(client->fd, client->in + client->in_len, sizeof(client->in) - client->in_len, 0);
+    if (n == 0) {
+        return 0;
+    }
+    if (n < 0) {
+        return errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    client->in_len += (size_t)n;
+
+    size_t pos = 0;
+    while (client->in_len - pos >= 4) {
+        uint32_t len = getBe32(client->in + pos);
+        if (len == 0 || len > SERVER_REQUEST_MAX) {
+            // Framing is lost, answer and drop the connection.
+            stats->requests++;
+            stats->errors++;
+            endResponse(client, beginResponse(client, SERVER_BAD_REQUEST, 0));
+            client->closing = 1;
+            client->in_len = 0;
+            return 1;
+        }
+        if (client->in_len - pos < 4 + len) {
+            break;
+        }
+        beginAllocJob();
+        handleRequest(client, client->in + pos + 4, len, cache, stats, hex, clients);
+        endAllocJob();
+        pos += 4 + len;
+    }
+    memmove(client->in, client->in + pos, client->in_len - pos);
+    client->in_len -= pos;
+    return 1;
+}
+
+static void closeClient(Client* client) {
+    close(client->fd);
+    free(client->out);
+    memset(client, 0, sizeof(*client));
+    client->fd = -1;
+}
+
+static int setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Bind the listening socket, a stale socket file from an earlier run is
+// replaced, anything else at the path is left alone.
+static int openListenSocket(const char* socket_path) {
+    struct sockaddr_un addr;
+    struct stat st;
+
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: Socket path too long: %s\n", socket_path);
+        return -1;
+    }
+    if (stat(socket_path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "Error: %s exists and is not a socket\n", socket_path);
+            return -1;
+        }
+        unlink(socket_path);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("Error creating socket");
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0 || !setNonBlocking(fd)) {
+        fprintf(stderr, "Error: Could not listen on %s: %s\n", socket_path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Serve until SIGINT or SIGTERM.
+int runServer(const char* socket_path, int cache_size, const HexOptions* hex) {
+    static Client clients[SERVER_MAX_CLIENTS];
+    struct pollfd fds[1 + SERVER_MAX_CLIENTS];
+    int slot_of[1 + SERVER_MAX_CLIENTS];
+    ImageCache cache;
+    ServerStats stats;
+
+    if (cache_size < 1) {
+        fprintf(stderr, "Error: Invalid cache size %d\n", cache_size);
+        return 0;
+    }
+    if (!initCache(&cache, cache_size)) {
+        perror("Error allocating memory for image cache");
+        return 0;
+    }
+    int listen_fd = openListenSocket(socket_path);
+    if (listen_fd < 0) {
+        freeCache(&cache);
+        return 0;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onStopSignal;           // No SA_RESTART, poll() returns
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    memset(&stats, 0, sizeof(stats));
+    stats.start = nowSeconds();
+    for (int i = 0; i < SERVER_MAX_CLIENTS; i++) {
+        clients[i].fd = -1;
+    }
+    int active = 0;
+
+    if (!quiet_enabled) {
+        printf("Serving on %s (cache %d images, %d clients)\n", socket_path, cache_size, SERVER_MAX_CLIENTS);
+        fflush(stdout);
+    }
+
+    while (!server_stop) {
+        int nfds = 0;
+        fds[nfds].fd = listen_fd;
+        fds[nfds].events = active < SERVER_MAX_CLIENTS ? POLLIN : 0;
+        slot_of[nfds++] = -1;
+        for (int i = 0; i < SERVER_MAX_CLIENTS; i++) {
+            Client* c = &clients[i];
+            if (c->fd < 0) continue;
+            fds[nfds].fd = c->fd;
+            fds[nfds].events = 0;
+            if (!c->closing && c->out_len - c->out_sent < SERVER_OUTPUT_BACKLOG) fds[nfds].events |= POLLIN;
+            if (c->out_len > c->out_sent) fds[nfds].events |= POLLOUT;
+            slot_of[nfds++] = i;
+        }
+
+        if (poll(fds, nfds, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("Error in poll");
+            break;
+        }
+
+        for (int f = 1; f < nfds; f++) {
+            Client* c = &clients[slot_of[f]];
+            short re = fds[f].revents;
+            int alive = 1;
+            if (re & POLLIN) {
+                alive = readClient(c, &cache, &stats, hex, active);
+            } else if (re & (POLLERR | POLLHUP | POLLNVAL)) {
+                alive = 0;
+            }
+            // Answers go out straight away, POLLOUT picks up the rest.
+            if (alive && c->out_len > c->out_sent) {
+                alive = flushClient(c);
+            }
+            if (!alive || (c->closing && c->out_len == c->out_sent)) {
+                closeClient(c);
+                active--;
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd;
+            while (active < SERVER_MAX_CLIENTS && (fd = accept(listen_fd, NULL, NULL)) >= 0) {
+                if (!setNonBlocking(fd)) {
+                    close(fd);
+                    continue;
+                }
+                for (int i = 0; i < SERVER_MAX_CLIENTS; i++) {
+                    if (clients[i].fd < 0) {
+                        clients[i].fd = fd;
+                        break;
+                    }
+                }
+                active++;
+                stats.connections++;
+            }
+        }
+    }
+
+    for (int i = 0; i < SERVER_MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0) closeClient(&clients[i]);
+    }
+    close(listen_fd);
+    unlink(socket_path);
+
+    if (!quiet_enabled) {
+        uint64_t lookups = stats.hits + stats.misses;
+        printf("Server stopped: %llu requests, %llu errors, cache hit rate %.1f%%\n",
+               (unsigned long long)stats.requests, (unsigned long long)stats.errors,
+               lookups ? 100.0 * stats.hits / lookups : 0.0);
+    }
+    printAllocSummary();
+    freeCache(&cache);
+    return 1;
+}
+
+#else
+
+int runServer(const char* socket_path, int cache_size, const HexOptions* hex) {
+    (void)socket_path;
+    (void)cache_size;
+    (void)hex;
+    fprintf(stderr, "Error: --serve is not supported on Windows\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ server.h  include for server.c
+
+ Wire format, all integers big endian:
+   request   u32 length, then length bytes:
+               u8 type
+               SERVER_REQ_GENERATE: u8 formats (SERVER_FORMAT_x bits), ID text
+               SERVER_REQ_STATS:    nothing
+   response  u32 length, then length bytes:
+               u8 status (SERVER_x), u8 type (echo of the request)
+               SERVER_REQ_GENERATE: per requested format, lowest bit first,
+                                    u8 format, u32 size, size bytes
+               SERVER_REQ_STATS:    "name value\n" text lines
+ Requests on one connection are answered in order.
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "output.h"
+
+// Limits
+#define SERVER_MAX_CLIENTS      64      // Connections served at once
+#define SERVER_CACHE_DEFAULT    1024    // Images kept in the LRU cache
+#define SERVER_REQUEST_MAX      64      // Largest request payload
+#define SERVER_LATENCY_SAMPLES  4096    // Latencies kept for the percentiles
+
+// Request types
+#define SERVER_REQ_GENERATE     1
+#define SERVER_REQ_STATS        2
+
+// Image formats
+#define SERVER_FORMAT_BIN       0x01
+#define SERVER_FORMAT_HEX       0x02
+
+// Response status
+#define SERVER_OK               0
+#define SERVER_BAD_REQUEST      1
+#define SERVER_INVALID_TEXT     2
+#define SERVER_ERROR            3
+
+// Resident generator on a Unix domain socket
+int runServer(const char* socket_path, int cache_size, const HexOptions* hex);
+
+#endif // SERVER_H
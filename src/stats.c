@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ stats.c  phase timing and output counters (tcgen --stats, --trace).
+
+ The generator, encoder and file writers are bracketed by the timer macros
+ of stats.h. With stats off those are a test of stats_enabled and nothing
+ more. With them on each timed phase is an event (phase, job, start, length
+ on CLOCK_MONOTONIC) appended to a buffer owned by the thread, so threads
+ never share a lock after their first event. Files, bytes and records
+ written are counted per thread the same way.
+
+ At exit the buffers of every thread are merged: --stats prints count,
+ total, min, average and p99 for each phase to stderr, --trace writes the
+ events as complete ("X") events of the Chrome trace-event format, one
+ track per thread, for chrome://tracing or Perfetto.
+ */
+
+#include "stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define STATS_EVENTS_INITIAL  1024
+
+static const char* const phase_names[STATS_PHASES] = {
+    "bitmap", "eprom", "encode", "write", "flush", "generate", "job",
+};
+
+typedef struct {
+    uint64_t start;                 // ns since enableStats()
+    uint64_t length;                // ns
+    int      job;                   // Manifest line, 0 outside a job
+    uint8_t  phase;
+} StatsEvent;
+
+typedef struct StatsThread {
+    struct StatsThread* next;
+    int         tid;                // 0 is the thread that called enableStats()
+    int         job;
+    StatsEvent* events;
+    size_t      count;
+    size_t      capacity;
+    uint64_t    files;
+    uint64_t    bytes;
+    uint64_t    records;            // Encoded lines, one per HEX, S or Tek record
+} StatsThread;
+
+bool stats_enabled = false;
+
+static bool stats_summary;
+static const char* stats_trace_file;
+static uint64_t stats_epoch;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static StatsThread* stats_threads;  // Every thread that recorded, newest first
+static int stats_thread_count;
+static __thread StatsThread* own_stats;
+
+uint64_t getStatsClock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// This thread's buffer, registered on first use. NULL if out of memory.
+static StatsThread* getOwnStats(void) {
+    if (!own_stats) {
+        StatsThread* thread = (StatsThread*)calloc(1, sizeof(StatsThread));
+        if (!thread) {
+            return NULL;
+        }
+        pthread_mutex_lock(&stats_lock);
+        thread->tid = stats_thread_count++;
+        thread->next = stats_threads;
+        stats_threads = thread;
+        pthread_mutex_unlock(&stats_lock);
+        own_stats = thread;
+    }
+    return own_stats;
+}
+
+// Charge this thread's following events to manifest line job (0 for none).
+// Returns the clock, the start of the job.
+uint64_t setStatsJob(int job) {
+    StatsThread* thread = getOwnStats();
+    if (thread) {
+        thread->job = job;
+    }
+    return getStatsClock();
+}
+
+// Record phase as running from start to now on this thread.
+void addStatsEvent(StatsPhase phase, uint64_t start) {
+    uint64_t end = getStatsClock();
+    StatsThread* thread = getOwnStats();
+    if (!thread) {
+        return;
+    }
+    if (thread->count == thread->capacity) {
+        size_t capacity = thread->capacity ? thread->capacity * 2 : STATS_EVENTS_INITIAL;
+        StatsEvent* grown = (StatsEvent*)realloc(thread->events, capacity * sizeof(StatsEvent));
+        if (!grown) {
+            return;
+        }
+        thread->events = grown;
+        thread->capacity = capacity;
+    }
+    StatsEvent* event = &thread->events[thread->count++];
+    event->start = start - stats_epoch;
+    event->length = end - start;
+    event->job = thread->job;
+    event->phase = (uint8_t)phase;
+    thread->files += phase == STATS_WRITE;
+}
+
+// Count size bytes written.
+void addStatsBytes(size_t size) {
+    StatsThread* thread = getOwnStats();
+    if (thread) {
+        thread->bytes += size;
+    }
+}
+
+// Count the records of the encoded text formats, one a line.
+void addStatsRecords(const OutputBuffer outs[], const EncoderList* formats) {
+    StatsThread* thread = getOwnStats();
+    if (!thread) {
+        return;
+    }
+    for (int i = 0; i < formats->count; i++) {
+        const char* p = outs[i].data;
+        const char* end = p + outs[i].length;
+        if (formats->formats[i]->binary || !p) {
+            continue;
+        }
+        while ((p = (const char*)memchr(p, '\n', (size_t)(end - p))) != NULL) {
+            thread->records++;
+            p++;
+        }
+    }
+}
+
+// Count files written other than through a timed STATS_WRITE, the files of
+// a batched writer flush.
+void addStatsFiles(uint64_t files) {
+    StatsThread* thread = getOwnStats();
+    if (thread) {
+        thread->files += files;
+    }
+}
+
+static int compareLengths(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Per phase count, total, min, average and p99, then the output counters.
+static void printStatsSummary(FILE* fp) {
+    size_t total_events = 0;
+    uint64_t files = 0, bytes = 0, records = 0;
+    for (StatsThread* t = stats_threads; t; t = t->next) {
+        total_events += t->count;
+        files += t->files;
+        bytes += t->bytes;
+        records += t->records;
+    }
+
+    uint64_t* lengths = (uint64_t*)malloc((total_events ? total_events : 1) * sizeof(uint64_t));
+    if (!lengths) {
+        perror("Error allocating memory for stats");
+        return;
+    }
+
+    fprintf(fp, "\n%-8s %10s %12s %10s %10s %10s\n", "Phase", "Count", "Total ms", "Min us", "Avg us", "P99 us");
+    for (int phase = 0; phase < STATS_PHASES; phase++) {
+        size_t n = 0;
+        uint64_t sum = 0;
+        for (StatsThread* t = stats_threads; t; t = t->next) {
+            for (size_t i = 0; i < t->count; i++) {
+                if (t->events[i].phase == phase) {
+                    lengths[n++] = t->events[i].length;
+                    sum += t->events[i].length;
+                }
+            }
+        }
+        if (n == 0) {
+            continue;
+        }
+        qsort(lengths, n, sizeof(uint64_t), compareLengths);
+        size_t p99 = (n * 99 + 99) / 100 - 1;
+        fprintf(fp, "%-8s %10zu %12.3f %10.2f %10.2f %10.2f\n", phase_names[phase], n, sum / 1e6,
+                lengths[0] / 1e3, (double)sum / n / 1e3, lengths[p99] / 1e3);
+    }
+    fprintf(fp, "Output: %llu files, %llu bytes, %llu records on %d threads\n", (unsigned long long)files,
+            (unsigned long long)bytes, (unsigned long long)records, stats_thread_count);
+    free(lengths);
+}
+
+// Every event as a Chrome trace complete event, microsecond timestamps.
+static int writeStatsTrace(const char* filename) {
+    FILE* fp = fopen(filename, "w");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open trace file %s\n", filename);
+        return 0;
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"tcgen\"}}");
+    for (StatsThread* t = stats_threads; t; t = t->next) {
+        fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}",
+                t->tid, t->tid ? "worker" : "main", t->tid);
+        for (size_t i = 0; i < t->count; i++) {
+            const StatsEvent* e = &t->events[i];
+            fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"tcgen\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                    "\"ts\":%.3f,\"dur\":%.3f", phase_names[e->phase], t->tid, e->start / 1e3, e->length / 1e3);
+            if (e->job) {
+                fprintf(fp, ",\"args\":{\"job\":%d}", e->job);
+            }
+            fprintf(fp, "}");
+        }
+    }
+    fprintf(fp, "\n]}\n");
+
+    int ok = !ferror(fp);
+    if (fclose(fp) != 0 || !ok) {
+        fprintf(stderr, "Error: Could not write trace file %s\n", filename);
+        return 0;
+    }
+    fprintf(stderr, "Trace written to %s\n", filename);
+    return 1;
+}
+
+// atexit handler, by then every worker has been joined.
+static void finishStats(void) {
+    stats_enabled = false;
+    if (stats_summary) {
+        printStatsSummary(stderr);
+    }
+    if (stats_trace_file) {
+        writeStatsTrace(stats_trace_file);
+    }
+    while (stats_threads) {
+        StatsThread* next = stats_threads->next;
+        free(stats_threads->events);
+        free(stats_threads);
+        stats_threads = next;
+    }
+}
+
+// Start timing. summary prints the --stats table at exit, trace_file (may
+// be NULL) receives the --trace timeline.
+int enableStats(bool summary, const char* trace_file) {
+    stats_summary = summary;
+    stats_trace_file = trace_file;
+    stats_epoch = getStatsClock();
+    if (!getOwnStats() || atexit(finishStats) != 0) {
+        fprintf(stderr, "Error: Could not start --stats\n");
+        return 0;
+    }
+    stats_enabled = true;
+    return 1;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ stats.h  include for stats.c
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "encoder.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Timed phases, in summary order
+typedef enum {
+    STATS_BITMAP,                   // generateTextBitmap (pt430GenerateBitmap)
+    STATS_EPROM,                    // generateEpromData (pt430GenerateImage)
+    STATS_ENCODE,                   // encodeImage, every -f format of a job
+    STATS_WRITE,                    // One output file opened, written and closed
+    STATS_FLUSH,                    // One batch of a --writer pwritev/uring run
+    STATS_GENERATE,                 // A job's image on a -j worker, written by the writer stage
+    STATS_JOB,                      // A job on the thread that writes it, once per job
+    STATS_PHASES
+} StatsPhase;
+
+// Set by --stats or --trace. Off, every timer below is this one branch.
+extern bool stats_enabled;
+
+// Phase timers and output counters. start is 0 when stats are off.
+#define startStatsTimer()             (stats_enabled ? getStatsClock() : 0)
+#define stopStatsTimer(phase, start)  do { if (stats_enabled) addStatsEvent(phase, start); } while (0)
+#define beginStatsJob(job)            (stats_enabled ? setStatsJob(job) : 0)
+#define endStatsJob(phase, start)     do { if (stats_enabled) { addStatsEvent(phase, start); setStatsJob(0); } } while (0)
+#define countStatsBytes(size)         do { if (stats_enabled) addStatsBytes(size); } while (0)
+#define countStatsRecords(outs, formats) \
+    do { if (stats_enabled) addStatsRecords(outs, formats); } while (0)
+#define countStatsFiles(files)        do { if (stats_enabled) addStatsFiles(files); } while (0)
+
+// Instrumentation functions
+uint64_t getStatsClock(void);
+uint64_t setStatsJob(int job);
+void addStatsEvent(StatsPhase phase, uint64_t start);
+void addStatsBytes(size_t size);
+void addStatsRecords(const OutputBuffer outs[], const EncoderList* formats);
+void addStatsFiles(uint64_t files);
+int enableStats(bool summary, const char* trace_file);
+
+#endif // STATS_H
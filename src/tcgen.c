@@ -24,44 +24,105 @@ tcgen.c  main  for PT-430 color bar generator, calls all other modules.
 #include "patterns.h"
 #include "version.h"
 #include "output.h"
+#include "batch.h"
+#include "loader.h"
+#include "compare.h"
+#include "render.h"
+#include "y4m.h"
+#include "cvbs.h"
+#include "blend.h"
+#include "server.h"
+#include "incremental.h"
+#include "encoder.h"
+#include "arena.h"
+#include "layout.h"
+#include "pack.h"
+#include "delta.h"
+#include "live.h"
+#include "verify.h"
+#include "decode.h"
+#include "stats.h"
+#include "watch.h"
+#include "pt430.h"
 
 // Library includes
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 #include <getopt.h>
 #include <libgen.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 // set debug to false.
 bool debug_enabled = false;
 
-// Function to validate if a character is in our allowed set
-int isValidChar(char c) {
-    c = toupper(c);
-    return (c == ' ' || c == '-' || c == ':' || 
-            (c >= 'A' && c <= 'Z') || 
-            (c >= '0' && c <= '9'));
-}
-
+// set quiet to false.
+bool quiet_enabled = false;
 
-// Function to validate the entire text string
+// Function to validate the entire text string, with the library's rules.
 int validateText(const char* text) {
-    if (strlen(text) > MAX_TEXT_LENGTH) {
-        fprintf(stderr, "Error: Text length exceeds maximum of %d characters\n", MAX_TEXT_LENGTH);
-        return 0;
-    }
-    
-    for(int i = 0; text[i]; i++) {
-        if (!isValidChar(text[i])) {
-            fprintf(stderr, "Error: Invalid character '%c' at position %d\n", text[i], i);
+    size_t pos = 0;
+
+    switch (pt430ValidateText(text, &pos)) {
+        case PT430_OK:
+            return 1;
+        case PT430_ERROR_TEXT_LENGTH:
+            fprintf(stderr, "Error: Text length exceeds maximum of %d characters\n", MAX_TEXT_LENGTH);
+            return 0;
+        case PT430_ERROR_TEXT_CHAR:
+            fprintf(stderr, "Error: Invalid character '%c' at position %zu\n", text[pos], pos);
             fprintf(stderr, "Allowed characters are A-Z, 0-9, space, hyphen (-) and colon (:)\n");
             return 0;
-        }
+        default:
+            fprintf(stderr, "Error: Invalid ID text\n");
+            return 0;
+    }
+}
+
+// Generate the EPROM image, and the text bitmap when bitmap_data is not
+// NULL, through libpt430.
+int generateImage(const char* id_text, uint8_t* eprom_data, uint8_t* bitmap_data) {
+    uint64_t started = startStatsTimer();
+    Pt430Status status = pt430GenerateImage(id_text, eprom_data, EPROM_SIZE);
+    stopStatsTimer(STATS_EPROM, started);
+    if (status == PT430_OK && bitmap_data) {
+        started = startStatsTimer();
+        status = pt430GenerateBitmap(id_text, bitmap_data, PT430_BITMAP_SIZE);
+        stopStatsTimer(STATS_BITMAP, started);
+    }
+    if (status != PT430_OK) {
+        fprintf(stderr, "Error: Pattern generation failed for \"%s\": %s\n", id_text, pt430StatusString(status));
+        return 0;
     }
     return 1;
 }
 
+// Copy ID text from the command line or a manifest, removing surrounding
+// quotes and converting underscores to spaces.
+void normalizeIdText(const char* src, char* dst, size_t dst_size) {
+    size_t len = strlen(src);
+
+    // Remove surrounding quotes if present
+    if (len >= 2) {
+        if ((src[0] == '"' && src[len-1] == '"') ||
+            (src[0] == '\'' && src[len-1] == '\'')) {
+            src++;
+            len -= 2;
+        }
+    }
+
+    if (len > dst_size - 1) {
+        len = dst_size - 1;
+    }
+
+    // Convert underscores to spaces
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = (src[i] == '_') ? ' ' : src[i];
+    }
+    dst[len] = '\0';
+}
+
 // Extract year from __DATE__ macro (format: "Mmm DD YYYY")
 const char* getYearFromDate(const char* date) {
     // Return last 4 characters of __DATE__ string
@@ -76,7 +137,24 @@ void printVersion(void) {
 
 // Print Usage
 void printUsage(const char* progname) {
-    fprintf(stderr, "Usage: %s [-v] [-d] [-h] -t <text> -o <output file>\n", progname);
+    fprintf(stderr, "Usage: %s [-v] [-d] [-h] [-f <formats>] [-r <len>] [-x] [--incremental] -t <text> -o <output file>\n", progname);
+    fprintf(stderr, "       %s [-f <formats>] [-r <len>] [-x] [-j <threads>] [--incremental | --writer <w> [--fsync]] -m <manifest.csv>\n", progname);
+    fprintf(stderr, "       %s [-d] [-f <formats>] [-r <len>] [-x] [-j <threads>] [--device <part>] --layout <file> -o <output file>\n", progname);
+    fprintf(stderr, "       %s --pack-add <pack> (-t <text> [--input <image>] | -m <manifest.csv>)\n", progname);
+    fprintf(stderr, "       %s [-f <formats>] [-r <len>] [-x] --pack-get <pack> -t <text> -o <output file>\n", progname);
+    fprintf(stderr, "       %s --pack-list <pack>\n", progname);
+    fprintf(stderr, "       %s [--device <part>] --delta <old> (-t <text> | --input <image>) -o <patch>\n", progname);
+    fprintf(stderr, "       %s [-f <formats>] [-r <len>] [-x] --apply <patch> (-t <text> | --input <image>) -o <output file>\n", progname);
+    fprintf(stderr, "       %s -c <reference> [-t <text> | <image> ...]\n", progname);
+    fprintf(stderr, "       %s [-d] --verify <readback> -t <text>\n", progname);
+    fprintf(stderr, "       %s [-d] [-j <threads>] --verify <dir> -m <manifest.csv>\n", progname);
+    fprintf(stderr, "       %s [-j <threads>] --decode <dump | dir> [-o <file.csv>]\n", progname);
+    fprintf(stderr, "       %s --render <frame> [--pattern <n>] (-t <text> | --input <image>)\n", progname);
+    fprintf(stderr, "       %s --y4m [--fps <n>] [--frames <n>] [--pattern <n>] (-t <text> | --input <image>)\n", progname);
+    fprintf(stderr, "       %s [-r <len>] [-x] [--cache <n>] --serve <socket>\n", progname);
+    fprintf(stderr, "       %s [--frames <n>] --live <target> [--clock]\n", progname);
+    fprintf(stderr, "       %s --emulate <source>\n", progname);
+    fprintf(stderr, "       %s --cvbs <file> [--seconds <s>] [--pattern <n>] (-t <text> | --input <image>)\n", progname);
     fprintf(stderr, "\nOptions:\n");
     fprintf(stderr, "  -v           Show version information\n");
     fprintf(stderr, "  -d           Enable debug mode - Prints additional files, <name>.dump\n");
@@ -85,12 +163,519 @@ void printUsage(const char* progname) {
     fprintf(stderr, "  -h           Show this help message\n");
     fprintf(stderr, "  -t <text>    Text to display (A-Z, 0-9, space, - and :)\n");
     fprintf(stderr, "  -o <file>    Output file name (.hex will be created, .bin for binary)\n");
+    fprintf(stderr, "               '-' writes only the first -f format to stdout\n");
+    fprintf(stderr, "  -f <list>    Output formats, comma separated (default %s, -d adds dump)\n", ENCODER_DEFAULT);
+    fprintf(stderr, "  -r <len>     Data bytes per record (hex, srec, tek), 1-255 (default 16)\n");
+    fprintf(stderr, "  -x           Start Intel HEX with an extended linear address record\n");
+    fprintf(stderr, "  -m <file>    Manifest of images to generate in one run, one per line:\n");
+    fprintf(stderr, "                 <text>, <output file> [, debug] [nolabel]\n");
+    fprintf(stderr, "  -j <n>       Generator threads for -m and --layout (0 = one per CPU, default 1)\n");
+    fprintf(stderr, "  --incremental Skip images whose outputs are already up to date and only\n");
+    fprintf(stderr, "               replace files whose content changed (with -o or -m)\n");
+    fprintf(stderr, "  --index <f>  Output index for --incremental (default %s)\n", INDEX_FILE_DEFAULT);
+    fprintf(stderr, "  --writer <w> How -m writes its outputs: stdio (default, file by file),\n");
+    fprintf(stderr, "               pwritev or uring (batches of many images, io_uring where the\n");
+    fprintf(stderr, "               kernel has it, else pwritev)\n");
+    fprintf(stderr, "  --fsync      Sync every file written by a batched --writer\n");
+    fprintf(stderr, "  --watch <f>  Run a manifest, then stay resident and as it is edited\n");
+    fprintf(stderr, "               regenerate only added or changed rows and remove the\n");
+    fprintf(stderr, "               outputs of deleted ones (Ctrl-C to stop)\n");
+    fprintf(stderr, "  --stats      Time each phase (bitmap, eprom, encode, write, flush, generate,\n");
+    fprintf(stderr, "               job) and print count, total, min, avg and p99, with the files,\n");
+    fprintf(stderr, "               bytes and records written, to stderr at exit\n");
+    fprintf(stderr, "  --trace <f>  Write the per job, per thread timeline as a Chrome trace\n");
+    fprintf(stderr, "               (chrome://tracing or Perfetto)\n");
+    fprintf(stderr, "  --layout <f> One image per bank of a larger EPROM switched on A13 and up,\n");
+    fprintf(stderr, "               the file lists the ID text of each bank, one per line\n");
+    fprintf(stderr, "  --device <p> EPROM for --layout (default the smallest that fits):\n");
+    printEpromDevices(stderr);
+    fprintf(stderr, "  --pack-add <p> Add the image for -t (or --input), or every -m row, to a\n");
+    fprintf(stderr, "               .pt430pack archive, created if missing, replacing the same ID\n");
+    fprintf(stderr, "  --pack-get <p> Extract the image for -t from a pack to the -o outputs\n");
+    fprintf(stderr, "  --pack-list <p> List the IDs held in a pack\n");
+    fprintf(stderr, "  --delta <old> Patch from the old image (a .hex/.bin file, or ID text) to the\n");
+    fprintf(stderr, "               image for -t or --input, in the page writes of an EEPROM\n");
+    fprintf(stderr, "               reprogrammed in place, with the estimated write time\n");
+    fprintf(stderr, "               --device picks the EEPROM (default %s):\n", DELTA_PART_DEFAULT);
+    printEepromParts(stderr);
+    fprintf(stderr, "  --apply <p>  Apply a --delta patch to the image for -t or --input, verify\n");
+    fprintf(stderr, "               it and write the new image to the -o outputs\n");
+    fprintf(stderr, "  -c <file>    Compare images (.hex or .bin) against this reference,\n");
+    fprintf(stderr, "               or against the image for -t, grouped by pattern region\n");
+    fprintf(stderr, "  --verify <f> Check a device read back after programming (.bin or .hex)\n");
+    fprintf(stderr, "               against the image for -t: PASS or FAIL with every differing\n");
+    fprintf(stderr, "               address by pattern, line and pixel (-d lists them all).\n");
+    fprintf(stderr, "               With -m, <dir>/<output stem>.bin or .hex of every row\n");
+    fprintf(stderr, "  --decode <f> Read the ID text back out of a dump, with a confidence and the\n");
+    fprintf(stderr, "               checksum. Given a directory, every .bin/.hex in it is decoded\n");
+    fprintf(stderr, "               and a CSV (-o, default stdout) flags IDs found on several\n");
+    fprintf(stderr, "               dumps\n");
+    fprintf(stderr, "  --render <f> Render 720x576 interlaced frames as the PT-430 scans the\n");
+    fprintf(stderr, "               EPROM: .ppm, .rgb (RGB24) or .yuv (I420)\n");
+    fprintf(stderr, "  --pattern <n> Pattern 1-4 to render (default all four, _p1.._p4 added)\n");
+    fprintf(stderr, "  --input <f>  Use an existing .hex/.bin image instead of -t\n");
+    fprintf(stderr, "  --y4m        Stream YUV4MPEG2 PAL video of a pattern (default 1) to stdout\n");
+    fprintf(stderr, "  --fps <n>    Stream frame rate, 0 = as fast as possible (default 25)\n");
+    fprintf(stderr, "  --frames <n> Stop after n frames (default run until stdout closes)\n");
+    fprintf(stderr, "  --cvbs <f>   Write the PAL composite signal of a pattern (default 1) sampled\n");
+    fprintf(stderr, "               at 4 x fsc: .s16/.raw (int16, 32767 = 1 V) or .f32 (volts)\n");
+    fprintf(stderr, "  --seconds <s> Length of the composite signal (default 1)\n");
+    fprintf(stderr, "  --serve <s>  Stay resident and answer image requests on a Unix socket\n");
+    fprintf(stderr, "  --cache <n>  Images kept by --serve (default %d)\n", SERVER_CACHE_DEFAULT);
+    fprintf(stderr, "  --live <t>   Keep the image resident and send only the bytes each new ID\n");
+    fprintf(stderr, "               text changes to an EPROM emulator: '-' is stdout, else the\n");
+    fprintf(stderr, "               Unix socket of --emulate. Captions are read from stdin,\n");
+    fprintf(stderr, "               one per line\n");
+    fprintf(stderr, "  --clock      Live HH:MM:SS instead of captions, one frame a second\n");
+    fprintf(stderr, "  --emulate <s> EPROM emulator stand-in, applies a --live stream from '-'\n");
+    fprintf(stderr, "               (stdin) or a Unix socket and checks every frame against a\n");
+    fprintf(stderr, "               full regeneration\n");
+    fprintf(stderr, "  --selftest   Check the SIMD text blend kernels against the scalar path\n");
     fprintf(stderr, "\nExample:\n");
     fprintf(stderr, "  %s -t \"VK3DG GEELONG\" -o pattern.hex\n", progname);
-    fprintf(stderr, "\nOutputs:\n");
-    fprintf(stderr, "  <name>.hex   Intel HEX format file\n");
-    fprintf(stderr, "  <name>.bin   Binary format file\n");
-    fprintf(stderr, "  <name>.dump  Raw hex dump with ASCII\n");
+    fprintf(stderr, "  %s -r 32 -t \"VK3DG\" -o - | programmer-tool\n", progname);
+    fprintf(stderr, "  %s -f hex,srec,tek -t \"VK3DG\" -o pattern\n", progname);
+    fprintf(stderr, "  %s -j 0 -m stations.csv\n", progname);
+    fprintf(stderr, "  %s -j 0 --incremental -m stations.csv\n", progname);
+    fprintf(stderr, "  %s -j 0 --stats --trace run.json -m stations.csv\n", progname);
+    fprintf(stderr, "  %s -j 0 --watch stations.csv\n", progname);
+    fprintf(stderr, "  %s --device 27C256 --layout stations.txt -o banked\n", progname);
+    fprintf(stderr, "  %s --pack-add fleet.pt430pack -m stations.csv\n", progname);
+    fprintf(stderr, "  %s --pack-get fleet.pt430pack -t \"VK3DG\" -o vk3dg\n", progname);
+    fprintf(stderr, "  %s --delta vk3dg.hex -t \"VK3DG BALLARAT\" -o vk3dg.patch\n", progname);
+    fprintf(stderr, "  %s -c ../eprom/AM27C64.hex dumps/*.bin\n", progname);
+    fprintf(stderr, "  %s --verify readback.bin -t \"VK3DG\"\n", progname);
+    fprintf(stderr, "  %s -j 0 --verify readbacks -m stations.csv\n", progname);
+    fprintf(stderr, "  %s -j 0 --decode old-dumps -o fleet.csv\n", progname);
+    fprintf(stderr, "  %s --live - --clock | %s --emulate -\n", progname, progname);
+    fprintf(stderr, "  %s --y4m -t \"VK3DG\" | ffmpeg -i - -c:v mpeg2video -f mpegts udp://...\n", progname);
+    fprintf(stderr, "\nOutputs (-f):\n");
+    printEncoderFormats(stderr);
+}
+
+// Check every blend kernel the CPU supports (--selftest). Returns the number
+// of kernels that failed.
+static int runSelfTest(void) {
+    int failures = 0;
+    printf("Blend kernel self test, %d rows per kernel (selected: %s)\n",
+           SELFTEST_ROWS, getBlendKernelName(getBlendKernel()));
+    for (int k = 0; k < NUM_BLEND_KERNELS; k++) {
+        if (!isBlendKernelSupported((BlendKernel)k)) {
+            printf("  %-8s not supported on this CPU\n", getBlendKernelName((BlendKernel)k));
+            continue;
+        }
+        bool ok = checkBlendKernel((BlendKernel)k);
+        printf("  %-8s %s\n", getBlendKernelName((BlendKernel)k), ok ? "OK" : "FAIL");
+        failures += !ok;
+    }
+    return failures;
+}
+
+// Compare images against a reference file, or against the image generated
+// for id_text when no files are given. Returns the number of images that
+// differ or could not be read.
+static int runCompare(const char* reference, char* const files[], int count, const char* id_text) {
+    LoadedImage ref;
+    uint8_t generated[EPROM_SIZE];
+    int failed = 0;
+
+    if (!loadImageFile(reference, &ref)) {
+        return 1;
+    }
+
+    if (count == 0) {
+        // Reference against the image for -t.
+        if (!generateImage(id_text, generated, NULL)) {
+            freeLoadedImage(&ref);
+            return 1;
+        }
+        CompareResult result;
+        compareImages(generated, EPROM_SIZE, ref.data, ref.size, &result, NULL, NULL);
+        bool same = result.mismatches == 0 && ref.size == EPROM_SIZE;
+        printf("%s vs generated \"%s\": %s\n", reference, id_text, same ? "MATCH" : "DIFFER");
+        printCompareReport(stdout, &result);
+        freeLoadedImage(&ref);
+        return same ? 0 : 1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        LoadedImage image;
+        CompareResult result;
+
+        if (!loadImageFile(files[i], &image)) {
+            printf("%s: UNREADABLE\n", files[i]);
+            failed++;
+            continue;
+        }
+        compareImages(ref.data, ref.size, image.data, image.size, &result, NULL, NULL);
+        bool same = result.mismatches == 0 && ref.size == image.size;
+        if (same) {
+            printf("%s: MATCH\n", files[i]);
+        } else {
+            printf("%s: DIFFER (%zu bytes)\n", files[i], result.mismatches);
+            printCompareReport(stdout, &result);
+            failed++;
+        }
+        freeLoadedImage(&image);
+    }
+
+    if (count > 1) {
+        printf("\nCompared %d images against %s: %d match, %d differ\n", count, reference, count - failed, failed);
+    }
+    freeLoadedImage(&ref);
+    return failed;
+}
+
+// Long only options
+enum {
+    OPT_RENDER = 256,
+    OPT_PATTERN,
+    OPT_INPUT,
+    OPT_Y4M,
+    OPT_FPS,
+    OPT_FRAMES,
+    OPT_CVBS,
+    OPT_SECONDS,
+    OPT_SELFTEST,
+    OPT_SERVE,
+    OPT_CACHE,
+    OPT_INCREMENTAL,
+    OPT_INDEX,
+    OPT_WRITER,
+    OPT_FSYNC,
+    OPT_LAYOUT,
+    OPT_DEVICE,
+    OPT_PACK_ADD,
+    OPT_PACK_GET,
+    OPT_PACK_LIST,
+    OPT_DELTA,
+    OPT_APPLY,
+    OPT_LIVE,
+    OPT_CLOCK,
+    OPT_EMULATE,
+    OPT_VERIFY,
+    OPT_DECODE,
+    OPT_STATS,
+    OPT_TRACE,
+    OPT_WATCH,
+};
+
+static const struct option long_options[] = {
+    { "text",           required_argument, NULL, 't' },
+    { "output",         required_argument, NULL, 'o' },
+    { "format",         required_argument, NULL, 'f' },
+    { "manifest",       required_argument, NULL, 'm' },
+    { "jobs",           required_argument, NULL, 'j' },
+    { "record-length",  required_argument, NULL, 'r' },
+    { "linear-address", no_argument,       NULL, 'x' },
+    { "compare",        required_argument, NULL, 'c' },
+    { "debug",          no_argument,       NULL, 'd' },
+    { "version",        no_argument,       NULL, 'v' },
+    { "help",           no_argument,       NULL, 'h' },
+    { "render",         required_argument, NULL, OPT_RENDER },
+    { "pattern",        required_argument, NULL, OPT_PATTERN },
+    { "input",          required_argument, NULL, OPT_INPUT },
+    { "y4m",            no_argument,       NULL, OPT_Y4M },
+    { "fps",            required_argument, NULL, OPT_FPS },
+    { "frames",         required_argument, NULL, OPT_FRAMES },
+    { "cvbs",           required_argument, NULL, OPT_CVBS },
+    { "seconds",        required_argument, NULL, OPT_SECONDS },
+    { "selftest",       no_argument,       NULL, OPT_SELFTEST },
+    { "serve",          required_argument, NULL, OPT_SERVE },
+    { "cache",          required_argument, NULL, OPT_CACHE },
+    { "incremental",    no_argument,       NULL, OPT_INCREMENTAL },
+    { "index",          required_argument, NULL, OPT_INDEX },
+    { "writer",         required_argument, NULL, OPT_WRITER },
+    { "fsync",          no_argument,       NULL, OPT_FSYNC },
+    { "layout",         required_argument, NULL, OPT_LAYOUT },
+    { "device",         required_argument, NULL, OPT_DEVICE },
+    { "pack-add",       required_argument, NULL, OPT_PACK_ADD },
+    { "pack-get",       required_argument, NULL, OPT_PACK_GET },
+    { "pack-list",      required_argument, NULL, OPT_PACK_LIST },
+    { "delta",          required_argument, NULL, OPT_DELTA },
+    { "apply",          required_argument, NULL, OPT_APPLY },
+    { "live",           required_argument, NULL, OPT_LIVE },
+    { "clock",          no_argument,       NULL, OPT_CLOCK },
+    { "emulate",        required_argument, NULL, OPT_EMULATE },
+    { "verify",         required_argument, NULL, OPT_VERIFY },
+    { "decode",         required_argument, NULL, OPT_DECODE },
+    { "stats",          no_argument,       NULL, OPT_STATS },
+    { "trace",          required_argument, NULL, OPT_TRACE },
+    { "watch",          required_argument, NULL, OPT_WATCH },
+    { NULL, 0, NULL, 0 }
+};
+
+// Fill image with the first 8K of input_file, or generate it for id_text.
+static int getSourceImage(const char* input_file, const char* id_text, uint8_t* image) {
+    if (input_file) {
+        LoadedImage loaded;
+        if (!loadImageFile(input_file, &loaded)) {
+            return 0;
+        }
+        size_t size = loaded.size < EPROM_SIZE ? loaded.size : EPROM_SIZE;
+        memset(image, ERASED_BYTE, EPROM_SIZE);
+        memcpy(image, loaded.data, size);
+        freeLoadedImage(&loaded);
+        return 1;
+    }
+
+    if (!id_text[0] || !validateText(id_text)) {
+        fprintf(stderr, "Error: Need -t <text> or --input <image>\n");
+        return 0;
+    }
+    return generateImage(id_text, image, NULL);
+}
+
+// Render one pattern (1-4) or all four (0) to frame files. With all four,
+// _p1 to _p4 is added before the extension.
+static int runRender(const char* filename, int pattern, const uint8_t* image) {
+    FrameFormat format;
+    if (!getFrameFormat(filename, &format)) {
+        return 0;
+    }
+
+    uint8_t* frame = (uint8_t*)malloc(getFrameSize(format));
+    if (!frame) {
+        perror("Error allocating memory for frame");
+        return 0;
+    }
+
+    int ok = 1;
+    for (int p = 1; p <= NUM_PATTERNS && ok; p++) {
+        if (pattern && p != pattern) {
+            continue;
+        }
+
+        char name[OUTPUT_PATH_MAX];
+        if (pattern) {
+            snprintf(name, sizeof(name), "%s", filename);
+        } else {
+            const char* ext = strrchr(filename, '.');
+            snprintf(name, sizeof(name), "%.*s_p%d%s", (int)(ext - filename), filename, p, ext);
+        }
+
+        ok = renderFrame(image, p - 1, format, frame) && writeFrameFile(name, frame, format);
+    }
+
+    free(frame);
+    return ok;
+}
+
+// Banked image for a larger EPROM, every bank from the layout file, written
+// in each -f format.
+static int runLayout(const char* layout_file, const char* device_name, const char* output_file,
+                     const BatchOptions* options, FILE* status_out) {
+    EpromLayout layout;
+    if (!loadLayoutFile(layout_file, device_name, &layout)) {
+        return 0;
+    }
+
+    uint32_t size = layout.device->size;
+    int device_banks = getDeviceBanks(layout.device);
+    uint8_t* image = (uint8_t*)malloc(size);
+    if (!image) {
+        perror("Error allocating memory for EPROM data");
+        return 0;
+    }
+
+    fprintf(status_out, "\nGenerating %d bank%s for a %s from layout %s\n", layout.banks,
+            layout.banks == 1 ? "" : "s", layout.device->name, layout_file);
+    for (int b = 0; b < layout.banks; b++) {
+        fprintf(status_out, "  Bank %2d  0x%05X  %s\n", b, (unsigned)(b * EPROM_SIZE), layout.id_text[b]);
+    }
+    if (device_banks > layout.banks + 1) {
+        fprintf(status_out, "  Banks %d-%d repeat the list\n", layout.banks, device_banks - 1);
+    } else if (device_banks > layout.banks) {
+        fprintf(status_out, "  Bank %2d  repeats the list\n", layout.banks);
+    }
+
+    EncoderList formats = options->formats;
+    int ok = generateLayoutImage(&layout, image, options->threads) &&
+             (!debug_enabled || strcmp(output_file, "-") == 0 ||
+              addEncoderFormat(&formats, findEncoderFormat("dump"))) &&
+             writeEncodedFiles(image, size, &formats, &options->hex, output_file, NULL);
+    free(image);
+    return ok;
+}
+
+// Add the image for id_text (from input_file when given), or the image of
+// every valid manifest row, to pack_file.
+static int runPackAdd(const char* pack_file, const char* manifest_file, const char* id_text,
+                      const char* input_file) {
+    PackBuilder builder;
+    uint8_t image[EPROM_SIZE];
+    int ok = 1;
+
+    if (!loadPackBuilder(pack_file, &builder)) {
+        return 0;
+    }
+
+    if (!manifest_file) {
+        ok = getSourceImage(input_file, id_text, image) && addPackImage(&builder, id_text, image);
+    } else {
+        FILE* fp = fopen(manifest_file, "r");
+        if (!fp) {
+            fprintf(stderr, "Error: Could not open manifest %s\n", manifest_file);
+            ok = 0;
+        }
+        char line[MANIFEST_LINE_MAX];
+        int line_no = 0;
+        while (ok && fgets(line, sizeof(line), fp)) {
+            BatchJob job;
+            int parsed = parseManifestLine(line, ++line_no, &job);
+            if (parsed > 0) {
+                ok = generateImage(job.id_text, image, NULL) && addPackImage(&builder, job.id_text, image);
+            } else {
+                ok = parsed == 0;
+            }
+        }
+        if (fp) {
+            fclose(fp);
+        }
+    }
+
+    ok = ok && savePackBuilder(&builder, pack_file);
+    if (ok) {
+        printf("Pack %s: %d images added (%d replaced)\n", pack_file, builder.added, builder.replaced);
+    }
+    freePackBuilder(&builder);
+    return ok;
+}
+
+// Extract the image for id_text from pack_file and write each -f format.
+static int runPackGet(const char* pack_file, const char* id_text, const char* output_file,
+                      const BatchOptions* options) {
+    PackFile pack;
+    uint8_t image[EPROM_SIZE];
+
+    if (!openPackFile(pack_file, &pack)) {
+        return 0;
+    }
+    int n = findPackImage(&pack, id_text);
+    int ok = n >= 0 && extractPackImage(&pack, n, image);
+    closePackFile(&pack);
+    if (n < 0) {
+        fprintf(stderr, "Error: %s holds no image for \"%s\"\n", pack_file, id_text);
+    }
+    return ok && writeEncodedFiles(image, EPROM_SIZE, &options->formats, &options->hex, output_file, NULL);
+}
+
+// IDs in a pack, with what it takes against separate images.
+static int runPackList(const char* pack_file) {
+    PackFile pack;
+    if (!openPackFile(pack_file, &pack)) {
+        return 0;
+    }
+    const PackHeader* h = pack.header;
+    for (uint32_t i = 0; i < h->image_count; i++) {
+        printf("%.*s\n", PACK_ID_SIZE, pack.index[i].id_text);
+    }
+    printf("\n%u images, %u unique lines, %zu bytes (%.1f bytes per image)\n", h->image_count, h->line_count,
+           pack.size, h->image_count ? (double)pack.size / h->image_count : 0.0);
+    closePackFile(&pack);
+    return 1;
+}
+
+// Patch from old (an image file, else ID text) to the image for id_text or
+// input_file, written to patch_file.
+static int runDelta(const char* old, const char* input_file, const char* id_text, const char* part_name,
+                    const char* patch_file, FILE* status_out) {
+    uint8_t old_image[EPROM_SIZE];
+    uint8_t new_image[EPROM_SIZE];
+    char old_text[MAX_TEXT_LENGTH + 1];
+
+    const EepromPart* part = findEepromPart(part_name ? part_name : DELTA_PART_DEFAULT);
+    if (!part) {
+        fprintf(stderr, "Error: Unknown EEPROM %s, one of:\n", part_name);
+        printEepromParts(stderr);
+        return 0;
+    }
+
+    if (access(old, F_OK) == 0) {
+        if (!getSourceImage(old, "", old_image)) {
+            return 0;
+        }
+    } else {
+        normalizeIdText(old, old_text, sizeof(old_text));
+        if (!validateText(old_text) || !generateImage(old_text, old_image, NULL)) {
+            return 0;
+        }
+        old = old_text;
+    }
+    if (!getSourceImage(input_file, id_text, new_image)) {
+        return 0;
+    }
+
+    DeltaPlan* plan = (DeltaPlan*)malloc(sizeof(DeltaPlan));
+    if (!plan) {
+        perror("Error allocating memory for delta");
+        return 0;
+    }
+    planDelta(old_image, new_image, part, plan);
+
+    OutputBuffer out = { 0 };
+    int ok = formatDeltaPatch(plan, new_image, old, input_file ? input_file : id_text, &out) &&
+             writeOutputBuffer(&out, patch_file, false);
+    if (ok) {
+        fprintf(status_out, "\nDelta for %s: %d bytes in %d write cycles, %.1f ms (%.1f ms for the whole part)\n",
+                part->name, plan->bytes, plan->pages, getDeltaTime(plan), getFullWriteTime(part));
+        fprintf(status_out, "- Patch: %s\n", patch_file);
+    }
+    freeOutputBuffer(&out);
+    free(plan);
+    return ok;
+}
+
+// Apply patch_file to the image for id_text or input_file and write the
+// verified result in each -f format.
+static int runApply(const char* patch_file, const char* input_file, const char* id_text, const char* output_file,
+                    const BatchOptions* options) {
+    uint8_t image[EPROM_SIZE];
+
+    return getSourceImage(input_file, id_text, image) && applyDeltaPatch(patch_file, image) &&
+           writeEncodedFiles(image, EPROM_SIZE, &options->formats, &options->hex, output_file, NULL);
+}
+
+// Run a manifest, or the single job, against the output index, which is
+// written back afterwards.
+static int runIncremental(const char* manifest_file, BatchJob* job, const char* index_file,
+                          BatchOptions* options) {
+    OutputIndex index;
+    Arena arena;
+    int ok;
+
+    if (!loadOutputIndex(index_file, &index)) {
+        return 0;
+    }
+    options->index = &index;
+
+    if (manifest_file) {
+        ok = runManifest(manifest_file, options);
+    } else if (isJobCurrent(job, options)) {
+        printf("\nOutputs for ID Text %s are up to date\n", job->id_text);
+        ok = 1;
+    } else if (!initArena(&arena, JOB_ARENA_SIZE)) {
+        perror("Error allocating memory for EPROM data");
+        ok = 0;
+    } else {
+        uint8_t eprom_data[EPROM_SIZE];
+        uint8_t bitmap_data[PIXELS_PER_LINE * TEXT_BITMAP_HEIGHT];
+        printf("\nGenerating EPROM data for ID Text %s\n", job->id_text);
+        // Progress would name the temporary files, the summary replaces it.
+        bool was_quiet = quiet_enabled;
+        quiet_enabled = true;
+        ok = runJob(job, eprom_data, bitmap_data, options, &arena);
+        quiet_enabled = was_quiet;
+        freeArena(&arena);
+        if (ok) {
+            printf("- %d files written, %d regenerated unchanged\n", index.written, index.unchanged);
+        }
+    }
+
+    ok &= saveOutputIndex(&index);
+    freeOutputIndex(&index);
+    options->index = NULL;
+    return ok;
 }
 
 // main entry point of program.
@@ -98,38 +683,76 @@ int main(int argc, char *argv[]) {
 
     char id_text[MAX_TEXT_LENGTH + 1] = {0}; // Initialize to empty string
     char output_file[256] = {0};             // Initialize to empty string
+    const char* manifest_file = NULL;
+    const char* compare_file = NULL;
+    BatchOptions batch_options = { .threads = 1, .hex = { .record_len = HEX_RECORD_DEFAULT } };
+    const char* render_file = NULL;
+    const char* input_file = NULL;
+    int pattern = 0;
+    bool y4m = false;
+    int fps = Y4M_FPS_PAL;
+    long frames = 0;
+    const char* cvbs_file = NULL;
+    double seconds = 1.0;
+    const char* serve_socket = NULL;
+    int cache_size = SERVER_CACHE_DEFAULT;
+    bool incremental = false;
+    const char* index_file = INDEX_FILE_DEFAULT;
+    const char* layout_file = NULL;
+    const char* device_name = NULL;
+    const char* pack_add = NULL;
+    const char* pack_get = NULL;
+    const char* pack_list = NULL;
+    const char* delta_old = NULL;
+    const char* apply_patch = NULL;
+    const char* live_target = NULL;
+    bool live_clock = false;
+    const char* emulate_source = NULL;
+    const char* verify_path = NULL;
+    const char* decode_path = NULL;
+    bool stats = false;
+    const char* trace_file = NULL;
+    const char* watch_file = NULL;
     int opt;
 
     // Parse command line options
-    while ((opt = getopt(argc, argv, "t:o:hvd")) != -1) {
+    while ((opt = getopt_long(argc, argv, "t:o:m:j:r:c:f:xhvd", long_options, NULL)) != -1) {
         switch (opt) {
             case 't':
-            {
-                char* text_arg = optarg;
-                size_t len = strlen(text_arg);
-                
-                // Remove surrounding quotes if present
-                if (len >= 2) {
-                    if ((text_arg[0] == '"' && text_arg[len-1] == '"') ||
-                        (text_arg[0] == '\'' && text_arg[len-1] == '\'')) {
-                        text_arg[len-1] = '\0';
-                        text_arg++;
-                        len -= 2;
-                    }
-                }
-                
-                // Convert underscores to spaces
-                for(int i = 0; i < len; i++) {
-                    if(text_arg[i] == '_') text_arg[i] = ' ';
-                }
-                strncpy(id_text, text_arg, sizeof(id_text) - 1);
-                id_text[sizeof(id_text) - 1] = '\0';
-            }
-            break;
+                normalizeIdText(optarg, id_text, sizeof(id_text));
+                break;
             case 'o':
                 strncpy(output_file, optarg, sizeof(output_file) - 1);
                 output_file[sizeof(output_file) - 1] = '\0'; // Ensure null-termination
                 break;
+            case 'm':
+                manifest_file = optarg;
+                break;
+            case 'f':
+                if (!parseEncoderList(optarg, &batch_options.formats)) {
+                    return 1;
+                }
+                break;
+            case 'c':
+                compare_file = optarg;
+                break;
+            case 'j':
+                batch_options.threads = atoi(optarg);
+                if (batch_options.threads < 0) {
+                    fprintf(stderr, "Error: Invalid thread count %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'r':
+                batch_options.hex.record_len = atoi(optarg);
+                if (batch_options.hex.record_len < 1 || batch_options.hex.record_len > HEX_RECORD_MAX) {
+                    fprintf(stderr, "Error: Invalid HEX record length %s (1-%d)\n", optarg, HEX_RECORD_MAX);
+                    return 1;
+                }
+                break;
+            case 'x':
+                batch_options.hex.linear_address = true;
+                break;
             case 'v': // Version option
                 printVersion();
                 return 0;
@@ -139,15 +762,304 @@ int main(int argc, char *argv[]) {
             case 'd':
                 debug_enabled = true;  // Set debug flag
                 break;
+            case OPT_RENDER:
+                render_file = optarg;
+                break;
+            case OPT_PATTERN:
+                pattern = atoi(optarg);
+                if (pattern < 1 || pattern > NUM_PATTERNS) {
+                    fprintf(stderr, "Error: Invalid pattern %s (1-%d)\n", optarg, NUM_PATTERNS);
+                    return 1;
+                }
+                break;
+            case OPT_INPUT:
+                input_file = optarg;
+                break;
+            case OPT_Y4M:
+                y4m = true;
+                break;
+            case OPT_FPS:
+                fps = atoi(optarg);
+                if (fps < 0) {
+                    fprintf(stderr, "Error: Invalid frame rate %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPT_FRAMES:
+                frames = atol(optarg);
+                if (frames < 0) {
+                    fprintf(stderr, "Error: Invalid frame count %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPT_SELFTEST:
+                return runSelfTest() ? 1 : 0;
+            case OPT_SERVE:
+                serve_socket = optarg;
+                break;
+            case OPT_CACHE:
+                cache_size = atoi(optarg);
+                if (cache_size < 1) {
+                    fprintf(stderr, "Error: Invalid cache size %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPT_INCREMENTAL:
+                incremental = true;
+                break;
+            case OPT_INDEX:
+                index_file = optarg;
+                break;
+            case OPT_WRITER:
+                if (!getWriterBackend(optarg, &batch_options.writer)) {
+                    fprintf(stderr, "Error: Unknown writer %s (stdio, pwritev or uring)\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPT_FSYNC:
+                batch_options.fsync = true;
+                break;
+            case OPT_LAYOUT:
+                layout_file = optarg;
+                break;
+            case OPT_DEVICE:
+                device_name = optarg;
+                break;
+            case OPT_PACK_ADD:
+                pack_add = optarg;
+                break;
+            case OPT_PACK_GET:
+                pack_get = optarg;
+                break;
+            case OPT_PACK_LIST:
+                pack_list = optarg;
+                break;
+            case OPT_DELTA:
+                delta_old = optarg;
+                break;
+            case OPT_APPLY:
+                apply_patch = optarg;
+                break;
+            case OPT_LIVE:
+                live_target = optarg;
+                break;
+            case OPT_CLOCK:
+                live_clock = true;
+                break;
+            case OPT_EMULATE:
+                emulate_source = optarg;
+                break;
+            case OPT_VERIFY:
+                verify_path = optarg;
+                break;
+            case OPT_DECODE:
+                decode_path = optarg;
+                break;
+            case OPT_STATS:
+                stats = true;
+                break;
+            case OPT_TRACE:
+                trace_file = optarg;
+                break;
+            case OPT_WATCH:
+                watch_file = optarg;
+                break;
+            case OPT_CVBS:
+                cvbs_file = optarg;
+                break;
+            case OPT_SECONDS:
+                seconds = atof(optarg);
+                if (seconds <= 0) {
+                    fprintf(stderr, "Error: Invalid signal length %s\n", optarg);
+                    return 1;
+                }
+                break;
             default: /* '?' */
                 printUsage(argv[0]);
                 return 1;
         }
     }
 
+    if (batch_options.formats.count == 0) {
+        parseEncoderList(ENCODER_DEFAULT, &batch_options.formats);
+    }
+
+    // Phase timing from here on, reported when tcgen exits.
+    if ((stats || trace_file) && !enableStats(stats, trace_file)) {
+        return 1;
+    }
+
+    // Compare mode, nothing is written.
+    if (compare_file) {
+        if (optind == argc && (!id_text[0] || !validateText(id_text))) {
+            fprintf(stderr, "Error: -c needs image files or -t <text> to compare against\n");
+            return 1;
+        }
+        return runCompare(compare_file, argv + optind, argc - optind, id_text) ? 1 : 0;
+    }
+
+    // ID text read back out of dumps, a directory of them gives a CSV.
+    if (decode_path) {
+        struct stat st;
+        if (stat(decode_path, &st) == 0 && S_ISDIR(st.st_mode)) {
+            return runDecodeScan(decode_path, output_file[0] ? output_file : "-", batch_options.threads) ? 0 : 1;
+        }
+        return runDecode(decode_path) ? 0 : 1;
+    }
+
+    // Readback verification, nothing is written.
+    if (verify_path) {
+        if (manifest_file) {
+            if (id_text[0]) {
+                fprintf(stderr, "Error: --verify takes -t <text> or -m <manifest>, not both\n");
+                return 1;
+            }
+            return runVerifyManifest(verify_path, manifest_file, batch_options.threads) ? 0 : 1;
+        }
+        if (!id_text[0] || !validateText(id_text)) {
+            fprintf(stderr, "Error: --verify needs -t <text> or -m <manifest>\n");
+            return 1;
+        }
+        return runVerify(verify_path, id_text) ? 0 : 1;
+    }
+
+    // Render frames of the generated or loaded image.
+    if (render_file) {
+        uint8_t image[EPROM_SIZE];
+        if (!getSourceImage(input_file, id_text, image)) {
+            return 1;
+        }
+        return runRender(render_file, pattern, image) ? 0 : 1;
+    }
+
+    // Stream video to stdout, pattern 1 unless chosen.
+    if (y4m) {
+        uint8_t image[EPROM_SIZE];
+        if (!getSourceImage(input_file, id_text, image)) {
+            return 1;
+        }
+        return streamY4m(STDOUT_FILENO, image, pattern ? pattern - 1 : 0, fps, frames) ? 0 : 1;
+    }
+
+    // Resident generator, runs until stopped.
+    if (serve_socket) {
+        return runServer(serve_socket, cache_size, &batch_options.hex) ? 0 : 1;
+    }
+
+    // Live ID text to an EPROM emulator, and the stand-in that receives it.
+    if (live_target) {
+        return runLiveStream(live_target, live_clock, frames) ? 0 : 1;
+    }
+    if (emulate_source) {
+        return runLiveEmulator(emulate_source) ? 0 : 1;
+    }
+
+    // Pack archive, nothing else is generated.
+    if (pack_list) {
+        return runPackList(pack_list) ? 0 : 1;
+    }
+    if (pack_add) {
+        if (manifest_file ? id_text[0] || input_file : !id_text[0] || !validateText(id_text)) {
+            fprintf(stderr, "Error: --pack-add needs -t <text> or -m <manifest>, not both\n");
+            return 1;
+        }
+        return runPackAdd(pack_add, manifest_file, id_text, input_file) ? 0 : 1;
+    }
+
+    // Composite waveform file, pattern 1 unless chosen.
+    if (cvbs_file) {
+        uint8_t image[EPROM_SIZE];
+        if (!getSourceImage(input_file, id_text, image)) {
+            return 1;
+        }
+        return writeCvbsFile(cvbs_file, image, pattern ? pattern - 1 : 0, seconds) ? 0 : 1;
+    }
+
+    // With -o - the Intel HEX goes to stdout, so progress goes to stderr.
+    bool to_stdout = (strcmp(output_file, "-") == 0);
+    FILE* status_out = to_stdout ? stderr : stdout;
+
     // Spit out app name
-    printf("\nPRACTEL PT-430b EPROM Code Generator v%s\n", VERSION_STRING);
-    
+    fprintf(status_out, "\nPRACTEL PT-430b EPROM Code Generator v%s\n", VERSION_STRING);
+
+    // Image from a pack instead of the generator.
+    if (pack_get) {
+        if (!id_text[0] || !output_file[0]) {
+            fprintf(stderr, "Error: --pack-get needs -t <text> and -o <output file>\n");
+            return 1;
+        }
+        if (!runPackGet(pack_get, id_text, output_file, &batch_options)) {
+            return 1;
+        }
+        fprintf(status_out, "\n(E)EPROM pattern file completed successfully:\n");
+        return 0;
+    }
+
+    // EEPROM delta patch, and the image a patch produces.
+    if (delta_old) {
+        if (!output_file[0]) {
+            fprintf(stderr, "Error: --delta needs -o <patch file>\n");
+            return 1;
+        }
+        return runDelta(delta_old, input_file, id_text, device_name, output_file, status_out) ? 0 : 1;
+    }
+    if (apply_patch) {
+        if (!output_file[0]) {
+            fprintf(stderr, "Error: --apply needs -o <output file>\n");
+            return 1;
+        }
+        if (!runApply(apply_patch, input_file, id_text, output_file, &batch_options)) {
+            return 1;
+        }
+        fprintf(status_out, "\nPatch %s applied and verified:\n", apply_patch);
+        return 0;
+    }
+
+    // Manifest kept in step with its edits until stopped.
+    if (watch_file) {
+        if (manifest_file || id_text[0] || output_file[0] || incremental) {
+            fprintf(stderr, "Error: --watch cannot be combined with -m, -t, -o or --incremental\n");
+            return 1;
+        }
+        printf("\nGenerating EPROM data from manifest %s\n\n", watch_file);
+        return runWatch(watch_file, &batch_options) ? 0 : 1;
+    }
+
+    // Batch mode, every row of the manifest in this process.
+    if (manifest_file) {
+        if (id_text[0] || output_file[0]) {
+            fprintf(stderr, "Error: -m cannot be combined with -t or -o\n");
+            return 1;
+        }
+        if (incremental && batch_options.writer != WRITER_STDIO) {
+            fprintf(stderr, "Error: --incremental cannot be combined with --writer %s\n",
+                    getWriterName(batch_options.writer));
+            return 1;
+        }
+        printf("\nGenerating EPROM data from manifest %s\n\n", manifest_file);
+        if (incremental) {
+            return runIncremental(manifest_file, NULL, index_file, &batch_options) ? 0 : 1;
+        }
+        return runManifest(manifest_file, &batch_options) ? 0 : 1;
+    }
+
+    // Banked image for a larger EPROM, the IDs come from the layout file.
+    if (layout_file) {
+        if (id_text[0] || !output_file[0] || incremental) {
+            fprintf(stderr, "Error: --layout needs -o and cannot be combined with -t or --incremental\n");
+            return 1;
+        }
+        if (!runLayout(layout_file, device_name, output_file, &batch_options, status_out)) {
+            return 1;
+        }
+        fprintf(status_out, "\n(E)EPROM pattern file completed successfully:\n");
+        return 0;
+    }
+    if (device_name) {
+        fprintf(stderr, "Error: --device is only used with --layout or --delta\n");
+        return 1;
+    }
+
     // Check if all required parameters are provided
     if (!id_text[0] || !output_file[0]) { // Check if strings are empty
         fprintf(stderr, "Error: Missing required parameters\n");
@@ -160,127 +1072,78 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-     // Dynamic memory allocation (improved)
-     uint8_t* eprom_data = NULL;
-     uint8_t* bitmap_data = NULL;
- 
-     eprom_data = (uint8_t*)calloc(EPROM_SIZE, sizeof(uint8_t));
-     if (!eprom_data) {
-         perror("Error allocating memory for EPROM data"); // Use perror for system error messages
-         return 1; // Return an error code
-     }
- 
-     bitmap_data = (uint8_t*)calloc(PIXELS_PER_LINE * TEXT_BITMAP_HEIGHT, sizeof(uint8_t));
-     if (!bitmap_data) {
-         perror("Error allocating memory for bitmap data");
-         free(eprom_data); // Free previously allocated eprom memory
-         return 1;
-     }
+    // Single image through the output index, as one job of a manifest.
+    if (incremental) {
+        if (to_stdout) {
+            fprintf(stderr, "Error: --incremental needs an output file, not -o -\n");
+            return 1;
+        }
+        BatchJob job = { .valid = true, .debug = debug_enabled, .label = true };
+        strcpy(job.id_text, id_text);
+        strcpy(job.output_file, output_file);
+        return runIncremental(NULL, &job, index_file, &batch_options) ? 0 : 1;
+    }
+
+    // Image, bitmap and encoded outputs all come from one job arena.
+    Arena arena;
+    if (!initArena(&arena, JOB_ARENA_SIZE)) {
+        perror("Error allocating memory for EPROM data"); // Use perror for system error messages
+        return 1; // Return an error code
+    }
+    uint8_t* eprom_data = (uint8_t*)allocArena(&arena, EPROM_SIZE);
+    uint8_t* bitmap_data = (uint8_t*)allocArena(&arena, PIXELS_PER_LINE * TEXT_BITMAP_HEIGHT);
+    memset(eprom_data, 0, EPROM_SIZE);
+    memset(bitmap_data, 0, PIXELS_PER_LINE * TEXT_BITMAP_HEIGHT);
 
     // Generate our pattern buffer data
-    printf("\nGenerating EPROM data for ID Text %s\n", id_text);
+    fprintf(status_out, "\nGenerating EPROM data for ID Text %s\n", id_text);
 
-    if (!generateEpromData(eprom_data, bitmap_data, id_text)) {
-        fprintf(stderr, "Error: Pattern generation failed\n");
-        freeMemory(eprom_data, bitmap_data);
+    if (!generateImage(id_text, eprom_data, debug_enabled ? bitmap_data : NULL)) {
+        freeArena(&arena);
         return 1;
     }
 
     // Success!
-    printf("\nPattern generation completed successfully\n");
+    fprintf(status_out, "\nPattern generation completed successfully\n");
 
-    char* base_filename = NULL; // Use basename for better portability
-    base_filename = strdup(output_file); // Allocate memory for base_filename
-    if (!base_filename) {
-        perror("Error duplicating filename");
-        freeMemory(eprom_data, bitmap_data);
+    // Every -f format in one pass over the image. With -o - only the first
+    // (Intel HEX by default) goes to stdout, straight into a programmer tool.
+    if (debug_enabled && !to_stdout && !addEncoderFormat(&batch_options.formats, findEncoderFormat("dump"))) {
+        freeArena(&arena);
         return 1;
     }
-
-    // Remove file extension if happen to have one.
-    char* ext = strrchr(base_filename, '.');
-    if (ext) {
-        *ext = '\0'; // Truncate the string at the extension
-    }
-
-    char* dir_name = NULL; // Get directory name (if needed)
-    dir_name = strdup(output_file);
-    if (!dir_name) {
-        perror("Error duplicating filename for directory");
-        free(base_filename);
-        freeMemory(eprom_data, bitmap_data);
+    if (!writeEncodedFiles(eprom_data, EPROM_SIZE, &batch_options.formats, &batch_options.hex, output_file, &arena)) {
+        freeArena(&arena);
         return 1;
     }
+    if (to_stdout) {
+        freeArena(&arena);
+        return 0;
+    }
 
-    base_filename = basename(base_filename); // Extract filename only
-    dir_name = dirname(dir_name); // Extract directory name
-
-    char hex_filename[256];
-    char bin_filename[256];
-    char dump_filename[256];
-    char text_filename[256];
-    char label_filename[256];
-   
-  
-    snprintf(hex_filename, sizeof(hex_filename), "%s/%s.hex", dir_name, base_filename);
-    snprintf(bin_filename, sizeof(bin_filename), "%s/%s.bin", dir_name, base_filename);
-    snprintf(dump_filename, sizeof(dump_filename), "%s/%s.dump", dir_name, base_filename);
-    snprintf(text_filename, sizeof(text_filename), "%s/%s_id.txt", dir_name, base_filename); 
-    snprintf(label_filename, sizeof(label_filename), "%s/%s_eprom_label.html", dir_name, base_filename); 
-
-
-   // Write INTEL HEX file
-   if (!writeHexFile(eprom_data, EPROM_SIZE, hex_filename)) {
-       fprintf(stderr, "Error: Failed to write HEX file: %s\n", hex_filename);
-       freeMemory(eprom_data, bitmap_data);
-       return 1;
-   }
-
-   // Write BIN file
-   if (!writeBinFile(eprom_data, EPROM_SIZE, bin_filename)) {
-       fprintf(stderr, "Error: Failed to write binary file: %s\n", bin_filename);
-       freeMemory(eprom_data, bitmap_data);
-       return 1;
-   }
-   
-   if (debug_enabled) {
-        // Write .dump file for comparison purposes.
-        if (!writeRawHexFile(eprom_data, EPROM_SIZE, dump_filename)) {
-            fprintf(stderr, "Error: Failed to write raw hex dump: %s\n", dump_filename);
-            freeMemory(eprom_data, bitmap_data);
-            return 1;
-        } else {
-            printf("- Raw hex dump: %s\n", dump_filename);
-        }
+    OutputNames names;
+    if (!buildOutputNames(output_file, &names)) {
+        freeArena(&arena);
+        return 1;
     }
 
   // In debug print Text bitmap file
     if (debug_enabled) {
-        if (!writeCharBitmapFile(bitmap_data, text_filename, id_text)) {
+        if (!writeCharBitmapFile(bitmap_data, names.text, id_text)) {
             fprintf(stderr, "Error writing character bitmap file.\n");
-            freeMemory(eprom_data, bitmap_data);
+            freeArena(&arena);
             return 1;
          }
     }
 
    // Print EPROM label
-   printEpromLabel(id_text, label_filename);
+   printEpromLabel(id_text, names.label);
    
    printf("- EPROM size: %d bytes\n", EPROM_SIZE);
 
    printf("\n(E)EPROM pattern file completed successfully:\n");
 
-   freeMemory(eprom_data, bitmap_data);
+   freeArena(&arena);
    return 0;
 }
 
- // De-allocate the 8K buffer from memory and text bitmap buffer
-void freeMemory(uint8_t* eprom, uint8_t* bitmap){
-    if (eprom) {
-        free(eprom);
-    }
-    if (bitmap) {
-      
-        free(bitmap);
-    }
-}
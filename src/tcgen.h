@@ -22,11 +22,12 @@
 
 #include "patterns.h"
 #include <stdint.h>
+#include <stddef.h>
 
 // Function declarations
-int isValidChar(char c);
 int validateText(const char* text);
+int generateImage(const char* id_text, uint8_t* eprom_data, uint8_t* bitmap_data);
+void normalizeIdText(const char* src, char* dst, size_t dst_size);
 void printUsage(const char* progname);
-void freeMemory(uint8_t* eprom, uint8_t* bitmap);
 
 #endif // TCGEN_H
@@ -0,0 +1,307 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ verify.c  readback verification (tcgen --verify), a device read back after
+           programming checked against the image regenerated for its ID.
+
+ The expected image is generated in memory and compared with the SIMD scan
+ of compare.c. Differing bytes are gathered into ranges that stay inside
+ one scan line, so each can be named by its place in the pattern: the
+ initial line, a text row and field, or line 16, and the pixels in it.
+
+ With a manifest every row is verified against <dir>/<output stem>.bin (or
+ .hex), the rows shared out over the worker threads like the banks of a
+ layout and reported in manifest order.
+ */
+
+#include "verify.h"
+#include "batch.h"
+#include "loader.h"
+#include "tcgen.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// "Pattern 1 Color Bars, text row 3 field 2, pixel 17" for addr. The region
+// is getRegionIndex()'s, only the row and pixel are worked out here.
+void formatAddressLocation(uint32_t addr, char* buf, size_t size) {
+    int region = getRegionIndex(addr);
+    const char* pattern = getPatternName(region / REGIONS_PER_PATTERN);
+    int offset = addr & (PATTERN_SIZE - 1);
+    int pixel = offset % PIXELS_PER_LINE;
+
+    switch (region % REGIONS_PER_PATTERN) {
+        case REGION_INITIAL:
+            snprintf(buf, size, "%s, initial line, pixel %d", pattern, pixel);
+            break;
+        case REGION_TEXT: {
+            int line = (offset - TEXT_START) / PIXELS_PER_LINE;
+            snprintf(buf, size, "%s, text row %d field %d, pixel %d", pattern, line / 2 + 1, line % 2 + 1, pixel);
+            break;
+        }
+        default:
+            snprintf(buf, size, "%s, line 16, pixel %d", pattern, pixel);
+            break;
+    }
+}
+
+// MismatchCallback, extends the last range or starts one. Ranges do not
+// cross a scan line, past ranges_max they are only counted.
+static void addMismatch(uint32_t addr, uint8_t expected, uint8_t actual, void* context) {
+    VerifyJob* job = (VerifyJob*)context;
+    bool extends = job->range_count && addr == job->last_addr + 1 && addr % PIXELS_PER_LINE != 0;
+
+    job->last_addr = addr;
+    if (!extends) {
+        if (job->range_count++ < job->ranges_max) {
+            VerifyRange* range = &job->ranges[job->range_count - 1];
+            range->addr = (uint16_t)addr;
+            range->length = 0;
+        }
+    }
+    if (job->range_count <= job->ranges_max) {
+        VerifyRange* range = &job->ranges[job->range_count - 1];
+        if (range->length < VERIFY_BYTES_SHOWN) {
+            range->expected[range->length] = expected;
+            range->actual[range->length] = actual;
+        }
+        range->length++;
+    }
+}
+
+// Look for job->readback as given, then with .bin and .hex added.
+static int findReadback(VerifyJob* job) {
+    char name[OUTPUT_PATH_MAX];
+    const char* const suffixes[] = { "", ".bin", ".hex" };
+
+    for (int i = 0; i < 3; i++) {
+        if (snprintf(name, sizeof(name), "%s%s", job->readback, suffixes[i]) < (int)sizeof(name) &&
+            access(name, F_OK) == 0) {
+            strcpy(job->readback, name);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Verify job->readback against the image for job->id_text. all_ranges keeps
+// every mismatch range, else the first VERIFY_RANGES_MAX. Returns 1 on PASS.
+int verifyReadback(VerifyJob* job, bool all_ranges) {
+    uint8_t expected[EPROM_SIZE];
+    LoadedImage image;
+
+    job->range_count = 0;
+    job->ranges_max = all_ranges ? EPROM_SIZE / 2 : VERIFY_RANGES_MAX;
+    job->ranges = (VerifyRange*)malloc(sizeof(VerifyRange) * job->ranges_max);
+    if (!job->ranges || !generateEpromData(expected, NULL, job->id_text)) {
+        job->status = VERIFY_ERROR;
+        return 0;
+    }
+    if (!findReadback(job)) {
+        job->status = VERIFY_MISSING;
+        return 0;
+    }
+    if (!loadImageFile(job->readback, &image)) {
+        job->status = VERIFY_UNREADABLE;
+        return 0;
+    }
+
+    compareImages(expected, EPROM_SIZE, image.data, image.size, &job->result, addMismatch, job);
+    freeLoadedImage(&image);
+    job->status = job->result.mismatches == 0 && job->result.size_actual == EPROM_SIZE ? VERIFY_PASS : VERIFY_FAIL;
+    return job->status == VERIFY_PASS;
+}
+
+// PASS/FAIL line, then each mismatch range with its place in the pattern.
+void printVerifyJob(FILE* fp, const VerifyJob* job) {
+    static const char* const status_names[] = { "PASS", "FAIL", "MISSING", "UNREADABLE", "ERROR" };
+
+    fprintf(fp, "%-10s %s  \"%s\"", status_names[job->status], job->readback, job->id_text);
+    if (job->status == VERIFY_FAIL && job->result.mismatches) {
+        fprintf(fp, "  (%zu bytes)", job->result.mismatches);
+    }
+    fprintf(fp, "\n");
+    if (job->status != VERIFY_FAIL) {
+        return;
+    }
+
+    int shown = job->range_count < job->ranges_max ? job->range_count : job->ranges_max;
+    for (int i = 0; i < shown; i++) {
+        const VerifyRange* range = &job->ranges[i];
+        char location[80];
+        char expected[VERIFY_BYTES_SHOWN * 3 + 4] = "", actual[VERIFY_BYTES_SHOWN * 3 + 4] = "";
+        int count = range->length < VERIFY_BYTES_SHOWN ? range->length : VERIFY_BYTES_SHOWN;
+
+        for (int b = 0, pos = 0; b < count; b++, pos += 3) {
+            snprintf(expected + pos, 4, "%02X ", range->expected[b]);
+            snprintf(actual + pos, 4, "%02X ", range->actual[b]);
+        }
+        expected[count * 3 - 1] = actual[count * 3 - 1] = '\0';
+        if (range->length > VERIFY_BYTES_SHOWN) {
+            strcat(expected, " ...");
+            strcat(actual, " ...");
+        }
+        formatAddressLocation(range->addr, location, sizeof(location));
+        if (range->length > 1) {
+            fprintf(fp, "  0x%04X-0x%04X  %s-%d\n", range->addr, range->addr + range->length - 1, location,
+                    (range->addr + range->length - 1) % PIXELS_PER_LINE);
+        } else {
+            fprintf(fp, "  0x%04X         %s\n", range->addr, location);
+        }
+        fprintf(fp, "                 expected %s  found %s\n", expected, actual);
+    }
+    if (job->range_count > shown) {
+        fprintf(fp, "  ... %d more ranges (-d lists them all)\n", job->range_count - shown);
+    }
+    printCompareReport(fp, &job->result);
+}
+
+void freeVerifyJob(VerifyJob* job) {
+    free(job->ranges);
+    job->ranges = NULL;
+}
+
+// Verify one readback against the image for id_text.
+int runVerify(const char* readback, const char* id_text) {
+    VerifyJob job;
+
+    memset(&job, 0, sizeof(job));
+    snprintf(job.id_text, sizeof(job.id_text), "%s", id_text);
+    snprintf(job.readback, sizeof(job.readback), "%s", readback);
+    int ok = verifyReadback(&job, debug_enabled);
+    printVerifyJob(stdout, &job);
+    freeVerifyJob(&job);
+    return ok;
+}
+
+// Rows first, first + step ... of the manifest, for one thread.
+typedef struct {
+    VerifyJob* jobs;
+    int count;
+    int first;
+    int step;
+    bool started;                   // Running on its own thread
+    pthread_t thread;
+} VerifyWorker;
+
+static void* verifyRows(void* arg) {
+    VerifyWorker* worker = (VerifyWorker*)arg;
+    for (int i = worker->first; i < worker->count; i += worker->step) {
+        verifyReadback(&worker->jobs[i], debug_enabled);
+    }
+    return NULL;
+}
+
+// Verify <readback_dir>/<output stem> of every manifest row on up to threads
+// threads (0 = one per CPU). Returns 1 when every row passes.
+int runVerifyManifest(const char* readback_dir, const char* manifest_file, int threads) {
+    FILE* fp = fopen(manifest_file, "r");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open manifest %s\n", manifest_file);
+        return 0;
+    }
+
+    VerifyJob* jobs = NULL;
+    int count = 0, capacity = 0, invalid = 0;
+    char line[MANIFEST_LINE_MAX];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        BatchJob row;
+        int parsed = parseManifestLine(line, ++line_no, &row);
+        if (parsed < 0) {
+            invalid++;
+        }
+        if (parsed <= 0) {
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            VerifyJob* grown = (VerifyJob*)realloc(jobs, sizeof(VerifyJob) * capacity);
+            if (!grown) {
+                perror("Error allocating memory for manifest");
+                fclose(fp);
+                free(jobs);
+                return 0;
+            }
+            jobs = grown;
+        }
+        VerifyJob* job = &jobs[count++];
+        const char* stem = strrchr(row.output_file, '/');
+        const char* stem_dos = strrchr(row.output_file, '\\');
+        if (stem_dos > stem) {
+            stem = stem_dos;
+        }
+        memset(job, 0, sizeof(*job));
+        job->line = row.line;
+        strcpy(job->id_text, row.id_text);
+        if (snprintf(job->readback, sizeof(job->readback), "%s/%s", readback_dir,
+                     stem ? stem + 1 : row.output_file) >= (int)sizeof(job->readback)) {
+            job->readback[0] = '\0';       // Reported missing
+        }
+    }
+    fclose(fp);
+
+    if (threads <= 0) {
+        threads = getProcessorCount();
+    }
+    if (threads > count) {
+        threads = count;
+    }
+    VerifyWorker* workers = (VerifyWorker*)calloc(threads ? threads : 1, sizeof(VerifyWorker));
+    if (!workers) {
+        perror("Error allocating memory for workers");
+        free(jobs);
+        return 0;
+    }
+
+    // Worker 0, and any that cannot be started, run on this thread.
+    for (int t = 0; t < threads; t++) {
+        workers[t].jobs = jobs;
+        workers[t].count = count;
+        workers[t].first = t;
+        workers[t].step = threads;
+        workers[t].started = t > 0 && pthread_create(&workers[t].thread, NULL, verifyRows, &workers[t]) == 0;
+    }
+    for (int t = 0; t < threads; t++) {
+        if (!workers[t].started) {
+            verifyRows(&workers[t]);
+        }
+    }
+    for (int t = 0; t < threads; t++) {
+        if (workers[t].started) {
+            pthread_join(workers[t].thread, NULL);
+        }
+    }
+
+    int tally[VERIFY_ERROR + 1] = { 0 };
+    for (int i = 0; i < count; i++) {
+        printVerifyJob(stdout, &jobs[i]);
+        tally[jobs[i].status]++;
+        freeVerifyJob(&jobs[i]);
+    }
+    printf("\nVerified %d readbacks in %s: %d pass, %d fail, %d missing, %d unreadable\n", count, readback_dir,
+           tally[VERIFY_PASS], tally[VERIFY_FAIL], tally[VERIFY_MISSING], tally[VERIFY_UNREADABLE] + tally[VERIFY_ERROR]);
+    if (invalid) {
+        printf("%d manifest rows skipped\n", invalid);
+    }
+
+    free(workers);
+    free(jobs);
+    return count > 0 && tally[VERIFY_PASS] == count && invalid == 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ verify.h  include for verify.c
+ */
+
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "patterns.h"
+#include "compare.h"
+#include "output.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define VERIFY_RANGES_MAX  32       // Mismatch ranges kept and listed, -d lists them all
+#define VERIFY_BYTES_SHOWN 8        // Bytes of each range printed
+
+// Verify outcome
+typedef enum {
+    VERIFY_PASS,
+    VERIFY_FAIL,
+    VERIFY_MISSING,                 // No readback found
+    VERIFY_UNREADABLE,
+    VERIFY_ERROR                    // Expected image could not be generated
+} VerifyStatus;
+
+// Differing bytes [addr, addr + length) inside one scan line
+typedef struct {
+    uint16_t addr;
+    uint16_t length;
+    uint8_t  expected[VERIFY_BYTES_SHOWN];
+    uint8_t  actual[VERIFY_BYTES_SHOWN];
+} VerifyRange;
+
+// One readback checked against the image for its ID
+typedef struct {
+    char          id_text[MAX_TEXT_LENGTH + 1];
+    char          readback[OUTPUT_PATH_MAX];
+    int           line;             // Manifest line, 0 for a single readback
+    VerifyStatus  status;
+    CompareResult result;
+    int           range_count;      // All ranges, only VERIFY_RANGES_MAX are kept
+    int           ranges_max;       // Ranges kept, VERIFY_RANGES_MAX or the whole image
+    uint32_t      last_addr;        // Last differing byte seen
+    VerifyRange*  ranges;
+} VerifyJob;
+
+// Readback verification functions
+void formatAddressLocation(uint32_t addr, char* buf, size_t size);
+int verifyReadback(VerifyJob* job, bool all_ranges);
+void printVerifyJob(FILE* fp, const VerifyJob* job);
+void freeVerifyJob(VerifyJob* job);
+int runVerify(const char* readback, const char* id_text);
+int runVerifyManifest(const char* readback_dir, const char* manifest_file, int threads);
+
+#endif // VERIFY_H
@@ -0,0 +1,377 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ watch.c  watch mode (tcgen --watch <manifest>), stays resident and keeps
+          the outputs of a manifest in step with it as it is edited.
+
+ The manifest is first run as a whole, as -m would, and its rows are kept
+ sorted by output stem. inotify on the manifest's directory (editors save
+ by rename as often as in place) wakes the loop; once the directory has
+ been quiet for WATCH_SETTLE_MS the manifest is read again and merged
+ against the rows in memory, stem by stem:
+
+    new stem             generated and written
+    ID text or options   regenerated, outputs the new row no longer
+    changed              writes (dump, _id.txt, label) removed
+    stem gone            its outputs removed
+
+ Unchanged rows are not touched. While the manifest has rows that do not
+ parse, nothing is removed: a row being retyped keeps its outputs until it
+ is valid again. A stem named by two rows belongs to the first, as in -m.
+ */
+
+#include "watch.h"
+#include "tcgen.h"
+#include "stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int compareRows(const void* a, const void* b) {
+    const BatchJob* x = (const BatchJob*)a;
+    const BatchJob* y = (const BatchJob*)b;
+    int cmp = strcmp(x->output_file, y->output_file);
+    return cmp ? cmp : x->line - y->line;
+}
+
+// Sort by stem, the first row of a stem wins and later ones are reported,
+// as runManifest() does.
+static void sortWatchRows(WatchManifest* manifest, bool report) {
+    qsort(manifest->rows, manifest->count, sizeof(BatchJob), compareRows);
+    int kept = 0;
+    for (int i = 0; i < manifest->count; i++) {
+        if (kept && strcmp(manifest->rows[kept - 1].output_file, manifest->rows[i].output_file) == 0) {
+            if (report) {
+                fprintf(stderr, "Error: Manifest line %d: output %s is already written by line %d\n",
+                        manifest->rows[i].line, manifest->rows[i].output_file, manifest->rows[kept - 1].line);
+            }
+            manifest->duplicates++;
+            continue;
+        }
+        manifest->rows[kept++] = manifest->rows[i];
+    }
+    manifest->count = kept;
+}
+
+// Read every valid row of manifest_file, sorted by output stem.
+int loadWatchManifest(const char* manifest_file, WatchManifest* manifest) {
+    memset(manifest, 0, sizeof(*manifest));
+    FILE* fp = fopen(manifest_file, "r");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open manifest %s\n", manifest_file);
+        return 0;
+    }
+
+    int capacity = 0;
+    int line_no = 0;
+    char line[MANIFEST_LINE_MAX];
+    while (fgets(line, sizeof(line), fp)) {
+        BatchJob row;
+        int parsed = parseManifestLine(line, ++line_no, &row);
+        if (parsed < 0) {
+            manifest->invalid++;
+        }
+        if (parsed <= 0) {
+            continue;
+        }
+        if (manifest->count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            BatchJob* grown = (BatchJob*)realloc(manifest->rows, capacity * sizeof(BatchJob));
+            if (!grown) {
+                perror("Error allocating memory for manifest");
+                fclose(fp);
+                freeWatchManifest(manifest);
+                return 0;
+            }
+            manifest->rows = grown;
+        }
+        row.valid = true;
+        manifest->rows[manifest->count++] = row;
+    }
+    fclose(fp);
+
+    sortWatchRows(manifest, true);
+    return 1;
+}
+
+void freeWatchManifest(WatchManifest* manifest) {
+    free(manifest->rows);
+    memset(manifest, 0, sizeof(*manifest));
+}
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+static volatile sig_atomic_t watch_stop = 0;
+
+static void onStopSignal(int sig) {
+    (void)sig;
+    watch_stop = 1;
+}
+
+static double nowMilliseconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int removeOutput(const char* name) {
+    if (unlink(name) == 0) {
+        return 1;
+    }
+    if (errno != ENOENT) {
+        fprintf(stderr, "Error: Could not remove %s\n", name);
+    }
+    return 0;
+}
+
+// Remove the outputs old wrote that keep, the row now at the same stem (NULL
+// when the stem is gone), does not write. Returns the files removed.
+static int removeJobOutputs(const BatchJob* old, const BatchJob* keep, const BatchOptions* options) {
+    OutputNames names;
+    char name[OUTPUT_PATH_MAX];
+    const EncoderFormat* dump = findEncoderFormat("dump");
+    int removed = 0;
+
+    if (!buildOutputNames(old->output_file, &names)) {
+        return 0;
+    }
+    bool dump_listed = false;
+    for (int i = 0; i < options->formats.count; i++) {
+        dump_listed |= options->formats.formats[i] == dump;
+        if (!keep && buildOutputName(old->output_file, options->formats.formats[i]->suffix, name)) {
+            removed += removeOutput(name);
+        }
+    }
+    if (old->debug && !(keep && keep->debug)) {
+        if (!dump_listed && buildOutputName(old->output_file, dump->suffix, name)) {
+            removed += removeOutput(name);
+        }
+        removed += removeOutput(names.text);
+    }
+    if (old->label && !(keep && keep->label)) {
+        removed += removeOutput(names.label);
+    }
+    return removed;
+}
+
+// Generate and write row, which replaces old (NULL for a new stem).
+static int regenerateRow(const BatchJob* row, const BatchJob* old, const BatchOptions* options, Arena* arena) {
+    double start = nowMilliseconds();
+    uint64_t job_started = beginStatsJob(row->line);
+    uint8_t* eprom_data = (uint8_t*)allocArena(arena, EPROM_SIZE);
+    uint8_t* bitmap_data = (uint8_t*)allocArena(arena, PIXELS_PER_LINE * TEXT_BITMAP_HEIGHT);
+    int ok = eprom_data && bitmap_data && runJob(row, eprom_data, bitmap_data, options, arena);
+    int removed = ok && old ? removeJobOutputs(old, row, options) : 0;
+    resetArena(arena);
+    endStatsJob(STATS_JOB, job_started);
+
+    if (!ok) {
+        printf("  FAIL    %s  \"%s\"\n", row->output_file, row->id_text);
+    } else if (old) {
+        printf("  CHANGE  %s  \"%s\" -> \"%s\"  (%.2f ms", row->output_file, old->id_text, row->id_text,
+               nowMilliseconds() - start);
+        if (removed) {
+            printf(", %d removed", removed);
+        }
+        printf(")\n");
+    } else {
+        printf("  ADD     %s  \"%s\"  (%.2f ms)\n", row->output_file, row->id_text, nowMilliseconds() - start);
+    }
+    return ok;
+}
+
+static bool isRowChanged(const BatchJob* old, const BatchJob* row) {
+    return strcmp(old->id_text, row->id_text) != 0 || old->debug != row->debug || old->label != row->label;
+}
+
+// Bring the outputs from current to next, stem by stem. Rows next drops
+// while it has invalid rows are carried over into it.
+static void applyManifest(const char* manifest_file, WatchManifest* current, WatchManifest* next,
+                          const BatchOptions* options, Arena* arena) {
+    double start = nowMilliseconds();
+    int added = 0, changed = 0, removed = 0, unchanged = 0, held = 0, failed = 0;
+    int old_count = current->count, new_count = next->count;
+    int i = 0, j = 0;
+
+    while (i < old_count || j < new_count) {
+        int cmp = i == old_count ? 1 : j == new_count ? -1 :
+                  strcmp(current->rows[i].output_file, next->rows[j].output_file);
+        if (cmp < 0) {
+            const BatchJob* old = &current->rows[i++];
+            if (next->invalid) {
+                // Held until the manifest parses, next is re-sorted below.
+                BatchJob* grown = (BatchJob*)realloc(next->rows, (next->count + 1) * sizeof(BatchJob));
+                if (grown) {
+                    next->rows = grown;
+                    next->rows[next->count++] = *old;
+                    held++;
+                }
+                continue;
+            }
+            int files = removeJobOutputs(old, NULL, options);
+            printf("  REMOVE  %s  \"%s\"  (%d files)\n", old->output_file, old->id_text, files);
+            removed++;
+        } else if (cmp > 0) {
+            failed += !regenerateRow(&next->rows[j++], NULL, options, arena);
+            added++;
+        } else {
+            const BatchJob* old = &current->rows[i++];
+            const BatchJob* row = &next->rows[j++];
+            if (isRowChanged(old, row)) {
+                failed += !regenerateRow(row, old, options, arena);
+                changed++;
+            } else {
+                unchanged++;
+            }
+        }
+    }
+    if (held) {
+        sortWatchRows(next, false);
+    }
+
+    printf("%s: %d added, %d changed, %d removed, %d unchanged in %.2f ms", manifest_file, added, changed,
+           removed, unchanged, nowMilliseconds() - start);
+    if (failed) {
+        printf(", %d failed", failed);
+    }
+    printf("\n");
+    if (next->invalid) {
+        printf("%d rows invalid, %d removals held until they are fixed\n", next->invalid, held);
+    }
+    fflush(stdout);
+}
+
+// True when the events in buf touch name.
+static bool isManifestEvent(const char* buf, ssize_t len, const char* name) {
+    for (const char* p = buf; p < buf + len; ) {
+        const struct inotify_event* event = (const struct inotify_event*)p;
+        if (event->len && strcmp(event->name, name) == 0) {
+            return true;
+        }
+        p += sizeof(struct inotify_event) + event->len;
+    }
+    return false;
+}
+
+// Run the manifest once, then follow its edits until SIGINT or SIGTERM.
+int runWatch(const char* manifest_file, const BatchOptions* options) {
+    char dir[OUTPUT_PATH_MAX];
+    const char* name = strrchr(manifest_file, '/');
+    if (name) {
+        size_t dir_len = name == manifest_file ? 1 : (size_t)(name - manifest_file);
+        if (dir_len >= sizeof(dir)) {
+            fprintf(stderr, "Error: Manifest path too long: %s\n", manifest_file);
+            return 0;
+        }
+        memcpy(dir, manifest_file, dir_len);
+        dir[dir_len] = '\0';
+        name++;
+    } else {
+        strcpy(dir, ".");
+        name = manifest_file;
+    }
+
+    // Watch before the first run, so an edit during it is not missed.
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+        fprintf(stderr, "Error: Could not watch %s: %s\n", dir, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return 0;
+    }
+
+    WatchManifest current;
+    Arena arena;
+    if (!loadWatchManifest(manifest_file, &current)) {
+        close(fd);
+        return 0;
+    }
+    if (!initArena(&arena, JOB_ARENA_SIZE)) {
+        perror("Error allocating memory for watch buffers");
+        freeWatchManifest(&current);
+        close(fd);
+        return 0;
+    }
+    runManifest(manifest_file, options);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onStopSignal;           // No SA_RESTART, poll() returns
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    // Per file progress would name every output, the change lines replace it.
+    bool was_quiet = quiet_enabled;
+    quiet_enabled = true;
+    printf("\nWatching %s (%d rows), Ctrl-C to stop\n", manifest_file, current.count);
+    fflush(stdout);
+
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    bool pending = false;
+    while (!watch_stop) {
+        // Once the manifest has changed, wait for the directory to settle.
+        int ready = poll(&pfd, 1, pending ? WATCH_SETTLE_MS : -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            perror("Error in poll");
+            break;
+        }
+        if (ready > 0) {
+            ssize_t len;
+            while ((len = read(fd, buf, sizeof(buf))) > 0) {
+                pending |= isManifestEvent(buf, len, name);
+            }
+            continue;
+        }
+        pending = false;
+
+        WatchManifest next;
+        if (!loadWatchManifest(manifest_file, &next)) {
+            continue;                       // Gone for now, a rename brings it back
+        }
+        applyManifest(manifest_file, &current, &next, options, &arena);
+        freeWatchManifest(&current);
+        current = next;
+    }
+
+    quiet_enabled = was_quiet;
+    printf("Watch stopped\n");
+    freeArena(&arena);
+    freeWatchManifest(&current);
+    close(fd);
+    return 1;
+}
+
+#else
+
+int runWatch(const char* manifest_file, const BatchOptions* options) {
+    (void)manifest_file;
+    (void)options;
+    fprintf(stderr, "Error: --watch needs inotify (Linux)\n");
+    return 0;
+}
+
+#endif
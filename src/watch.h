@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ watch.h  include for watch.c
+ */
+
+#ifndef WATCH_H
+#define WATCH_H
+
+#include "batch.h"
+
+#define WATCH_SETTLE_MS  20         // Quiet time after a change before the manifest is read
+
+// Manifest rows by output stem
+typedef struct {
+    BatchJob* rows;                 // Sorted by output_file, one row per stem
+    int       count;
+    int       invalid;              // Rows that did not parse
+    int       duplicates;           // Rows naming a stem an earlier row has
+} WatchManifest;
+
+// Watch mode functions
+int loadWatchManifest(const char* manifest_file, WatchManifest* manifest);
+void freeWatchManifest(WatchManifest* manifest);
+int runWatch(const char* manifest_file, const BatchOptions* options);
+
+#endif // WATCH_H
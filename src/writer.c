@@ -0,0 +1,507 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ writer.c  batched output file writer for manifest runs.
+
+ Every output of many images is formatted into one buffer and queued, then
+ the whole batch is written at once:
+   - pwritev: open, pwritev, (fsync), close for each file.
+   - io_uring: all opens are submitted together, then for each file a
+     linked write, (fsync), close chain. Each submission round is one
+     io_uring_enter call for up to WRITER_RING_ENTRIES operations, so a
+     batch of a few hundred files takes a handful of system calls.
+ The ring is set up with raw system calls (no liburing). If the kernel has
+ no io_uring, or lacks one of the operations used, pwritev is used instead.
+ */
+
+#include "writer.h"
+#include "encoder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define WRITER_HAVE_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+#define OUTPUT_OPEN_FLAGS  (O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC)
+#define OUTPUT_MODE        0644
+
+static const char* const writer_names[NUM_WRITERS] = { "stdio", "pwritev", "uring" };
+
+int getWriterBackend(const char* name, WriterBackend* backend) {
+    for (int i = 0; i < NUM_WRITERS; i++) {
+        if (strcmp(name, writer_names[i]) == 0) {
+            *backend = (WriterBackend)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+const char* getWriterName(WriterBackend backend) {
+    if (backend < 0 || backend >= NUM_WRITERS) {
+        return "unknown";
+    }
+    return writer_names[backend];
+}
+
+#ifdef WRITER_HAVE_URING
+
+struct Uring {
+    int fd;
+    unsigned entries;
+    unsigned tail;                  // Local submission tail
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+    void* sq_ring;
+    void* cq_ring;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    size_t sqes_size;
+};
+
+// Operation in the low bits of user_data, file number above.
+enum { OP_OPEN, OP_WRITE, OP_FSYNC, OP_CLOSE, OP_BITS = 2 };
+
+static void closeUring(Uring* ring) {
+    if (ring->sqes) munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring && ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_ring_size);
+    if (ring->sq_ring) munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+    free(ring);
+}
+
+// True if the kernel supports every operation the writer submits.
+static bool probeUring(int fd) {
+    static const int ops[] = { IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_FSYNC, IORING_OP_CLOSE };
+    size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe* probe = (struct io_uring_probe*)calloc(1, size);
+    bool ok = probe && syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+
+    for (size_t i = 0; ok && i < sizeof(ops) / sizeof(ops[0]); i++) {
+        ok = ops[i] <= probe->last_op && (probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+    return ok;
+}
+
+// Set up a ring, NULL if io_uring is missing, disabled or too old.
+static Uring* openUring(unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    Uring* ring = (Uring*)calloc(1, sizeof(Uring));
+    if (!ring) {
+        close(fd);
+        return NULL;
+    }
+    ring->fd = fd;
+    ring->entries = params.sq_entries;
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single && ring->cq_ring_size > ring->sq_ring_size) {
+        ring->sq_ring_size = ring->cq_ring_size;
+    }
+
+    void* sq = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) {
+        closeUring(ring);
+        return NULL;
+    }
+    ring->sq_ring = sq;
+
+    void* cq = sq;
+    if (!single) {
+        cq = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                  fd, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) {
+            closeUring(ring);
+            return NULL;
+        }
+    }
+    ring->cq_ring = cq;
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        closeUring(ring);
+        return NULL;
+    }
+    ring->sqes = (struct io_uring_sqe*)sqes;
+
+    uint8_t* s = (uint8_t*)sq;
+    uint8_t* c = (uint8_t*)cq;
+    ring->sq_head = (unsigned*)(s + params.sq_off.head);
+    ring->sq_tail = (unsigned*)(s + params.sq_off.tail);
+    ring->sq_mask = (unsigned*)(s + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(s + params.sq_off.array);
+    ring->cq_head = (unsigned*)(c + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(c + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)(c + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(c + params.cq_off.cqes);
+    ring->tail = *ring->sq_tail;
+
+    if (!probeUring(fd)) {
+        closeUring(ring);
+        return NULL;
+    }
+    return ring;
+}
+
+// Next free submission entry, zeroed. The caller never queues more than
+// ring->entries before submitting.
+static struct io_uring_sqe* nextSqe(Uring* ring, int op, int file) {
+    unsigned index = ring->tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = ((uint64_t)file << OP_BITS) | op;
+    ring->sq_array[index] = index;
+    ring->tail++;
+    return sqe;
+}
+
+// Submit everything queued and wait for all of it to complete, calling
+// back for each completion.
+static int submitAndWait(Uring* ring, FileWriter* writer,
+                         void (*complete)(FileWriter* writer, int op, int file, int res)) {
+    unsigned pending = ring->tail - *ring->sq_tail;
+    unsigned waiting = pending;
+    __atomic_store_n(ring->sq_tail, ring->tail, __ATOMIC_RELEASE);
+
+    while (waiting > 0) {
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            long ret = syscall(__NR_io_uring_enter, ring->fd, pending, waiting, IORING_ENTER_GETEVENTS, NULL, 0);
+            writer->batch.syscalls++;
+            if (ret < 0) {
+                if (errno == EINTR) continue;
+                // Finish this and later batches synchronously.
+                fprintf(stderr, "Warning: io_uring_enter failed (%s), using pwritev\n", strerror(errno));
+                writer->backend = WRITER_PWRITEV;
+                return 0;
+            }
+            pending -= (unsigned)ret < pending ? (unsigned)ret : pending;
+            continue;
+        }
+        for (; head != tail && waiting > 0; head++, waiting--) {
+            const struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+            complete(writer, (int)(cqe->user_data & ((1 << OP_BITS) - 1)),
+                     (int)(cqe->user_data >> OP_BITS), cqe->res);
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+    return 1;
+}
+
+static void openComplete(FileWriter* writer, int op, int file, int res) {
+    (void)op;
+    WriteRequest* request = &writer->files[file];
+    request->fd = res;
+    request->ok = res >= 0;
+    if (res < 0) {
+        fprintf(stderr, "Error: Could not open file %s for writing: %s\n", request->path, strerror(-res));
+    }
+}
+
+// A failed or short write cancels the rest of the chain, finishFile()
+// completes those files synchronously afterwards.
+static void writeComplete(FileWriter* writer, int op, int file, int res) {
+    WriteRequest* request = &writer->files[file];
+    switch (op) {
+        case OP_WRITE:
+            if (res >= 0) {
+                size_t n = (size_t)res < request->length ? (size_t)res : request->length;
+                request->offset += n;
+                request->length -= n;
+                request->written += n;
+                writer->batch.bytes += n;
+            } else {
+                fprintf(stderr, "Error: Could not write file %s: %s\n", request->path, strerror(-res));
+                request->ok = false;
+            }
+            break;
+        case OP_FSYNC:
+            if (res < 0 && res != -ECANCELED) {
+                fprintf(stderr, "Error: Could not sync file %s: %s\n", request->path, strerror(-res));
+                request->ok = false;
+            }
+            break;
+        case OP_CLOSE:
+            if (res == 0) request->fd = -1;
+            break;
+    }
+}
+
+#endif // WRITER_HAVE_URING
+
+int initFileWriter(FileWriter* writer, WriterBackend backend, bool fsync) {
+    memset(writer, 0, sizeof(*writer));
+    writer->backend = backend;
+    writer->fsync = fsync;
+
+#ifdef _WIN32
+    if (backend != WRITER_STDIO) {
+        fprintf(stderr, "Error: The %s writer is not available on this platform\n", getWriterName(backend));
+        return 0;
+    }
+#endif
+    if (backend == WRITER_URING) {
+#ifdef WRITER_HAVE_URING
+        writer->ring = openUring(WRITER_RING_ENTRIES);
+#endif
+        if (!writer->ring) {
+            fprintf(stderr, "Warning: io_uring not available, using pwritev\n");
+            writer->backend = WRITER_PWRITEV;
+        }
+    }
+
+    // Room for a full batch and the job that tips it over, so the batch
+    // buffers are not grown once the run is going.
+    if (backend != WRITER_STDIO) {
+        writer->capacity = WRITER_BATCH_FILES + MAX_ENCODERS + 2;
+        writer->files = (WriteRequest*)malloc(writer->capacity * sizeof(WriteRequest));
+        if (!writer->files || !reserveOutputBuffer(&writer->data, WRITER_BATCH_BYTES + JOB_ARENA_SIZE)) {
+            perror("Error allocating memory for output batch");
+            freeFileWriter(writer);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void freeFileWriter(FileWriter* writer) {
+#ifdef WRITER_HAVE_URING
+    if (writer->ring) {
+        closeUring(writer->ring);
+    }
+#endif
+    freeOutputBuffer(&writer->data);
+    free(writer->files);
+    memset(writer, 0, sizeof(*writer));
+}
+
+// Queue path with the content appended to writer->data since offset.
+int queueWriterFile(FileWriter* writer, const char* path, size_t offset, int tag) {
+    if (writer->data.failed) {
+        perror("Error allocating memory for output batch");
+        return 0;
+    }
+    if (strlen(path) >= OUTPUT_PATH_MAX) {
+        fprintf(stderr, "Error: Output file name too long: %s\n", path);
+        return 0;
+    }
+    if (writer->count == writer->capacity) {
+        int capacity = writer->capacity ? writer->capacity * 2 : WRITER_BATCH_FILES;
+        WriteRequest* files = (WriteRequest*)realloc(writer->files, capacity * sizeof(WriteRequest));
+        if (!files) {
+            perror("Error allocating memory for output batch");
+            return 0;
+        }
+        writer->files = files;
+        writer->capacity = capacity;
+    }
+
+    WriteRequest* request = &writer->files[writer->count++];
+    strcpy(request->path, path);
+    request->offset = offset;
+    request->length = writer->data.length - offset;
+    request->written = 0;
+    request->tag = tag;
+    request->fd = -1;
+    request->ok = true;
+    return 1;
+}
+
+bool isWriterFull(const FileWriter* writer) {
+    return writer->count >= WRITER_BATCH_FILES || writer->data.length >= WRITER_BATCH_BYTES;
+}
+
+#ifndef _WIN32
+// Open, write, sync and close a file synchronously, or finish one the ring
+// left part way.
+static void finishFile(FileWriter* writer, WriteRequest* request) {
+    bool ok = request->ok;
+
+    if (ok && request->fd < 0) {
+        request->fd = open(request->path, OUTPUT_OPEN_FLAGS, OUTPUT_MODE);
+        writer->batch.syscalls++;
+        ok = request->fd >= 0;
+    }
+
+    while (ok && request->length > 0) {
+        struct iovec iov = { writer->data.data + request->offset, request->length };
+        ssize_t n = pwritev(request->fd, &iov, 1, (off_t)request->written);
+        writer->batch.syscalls++;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ok = false;
+            break;
+        }
+        request->offset += (size_t)n;
+        request->length -= (size_t)n;
+        request->written += (size_t)n;
+        writer->batch.bytes += (uint64_t)n;
+    }
+
+    if (ok && writer->fsync) {
+        ok = fsync(request->fd) == 0;
+        writer->batch.syscalls++;
+    }
+    if (request->fd >= 0) {
+        ok &= close(request->fd) == 0;
+        writer->batch.syscalls++;
+        request->fd = -1;
+    }
+
+    // Failures reported by the ring were already reported.
+    if (request->ok && !ok) {
+        fprintf(stderr, "Error: Could not write file %s: %s\n", request->path, strerror(errno));
+        request->ok = false;
+    }
+}
+#endif
+
+#ifdef WRITER_HAVE_URING
+static void flushUring(FileWriter* writer) {
+    Uring* ring = writer->ring;
+    int per_round = ring->entries / (writer->fsync ? 3 : 2);
+
+    // Opens first, one round per ring full.
+    for (int first = 0; first < writer->count; first += (int)ring->entries) {
+        int last = first + (int)ring->entries;
+        if (last > writer->count) last = writer->count;
+        for (int i = first; i < last; i++) {
+            struct io_uring_sqe* sqe = nextSqe(ring, OP_OPEN, i);
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = (uint64_t)(uintptr_t)writer->files[i].path;
+            sqe->len = OUTPUT_MODE;
+            sqe->open_flags = OUTPUT_OPEN_FLAGS;
+        }
+        if (!submitAndWait(ring, writer, openComplete)) {
+            break;
+        }
+    }
+
+    // Then write -> fsync -> close chains for every opened file.
+    for (int first = 0; first < writer->count; first += per_round) {
+        int last = first + per_round;
+        if (last > writer->count) last = writer->count;
+        for (int i = first; i < last; i++) {
+            WriteRequest* request = &writer->files[i];
+            if (!request->ok) {
+                continue;
+            }
+            struct io_uring_sqe* sqe = nextSqe(ring, OP_WRITE, i);
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->fd = request->fd;
+            sqe->addr = (uint64_t)(uintptr_t)(writer->data.data + request->offset);
+            sqe->len = (unsigned)request->length;
+            sqe->off = 0;
+            sqe->flags = IOSQE_IO_LINK;
+            if (writer->fsync) {
+                sqe = nextSqe(ring, OP_FSYNC, i);
+                sqe->opcode = IORING_OP_FSYNC;
+                sqe->fd = request->fd;
+                sqe->flags = IOSQE_IO_LINK;
+            }
+            sqe = nextSqe(ring, OP_CLOSE, i);
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = request->fd;
+        }
+        if (!submitAndWait(ring, writer, writeComplete)) {
+            break;
+        }
+    }
+}
+#endif
+
+// Write every queued file. For each file that fails, status[tag] is cleared
+// (status may be NULL). Returns the number of files that failed.
+int flushFileWriter(FileWriter* writer, bool* status) {
+    int failed = 0;
+
+    memset(&writer->batch, 0, sizeof(writer->batch));
+    if (writer->count == 0) {
+        return 0;
+    }
+    writer->batch.files = writer->count;
+
+#ifdef WRITER_HAVE_URING
+    if (writer->backend == WRITER_URING) {
+        flushUring(writer);
+    }
+#endif
+
+#ifndef _WIN32
+    // Everything for pwritev, and whatever the ring left unfinished.
+    for (int i = 0; i < writer->count; i++) {
+        WriteRequest* request = &writer->files[i];
+        if (writer->backend == WRITER_PWRITEV || request->fd >= 0 ||
+            (request->ok && request->length > 0)) {
+            finishFile(writer, request);
+        }
+    }
+#endif
+
+    for (int i = 0; i < writer->count; i++) {
+        if (!writer->files[i].ok) {
+            failed++;
+            if (status) status[writer->files[i].tag] = false;
+        }
+    }
+
+    writer->batches++;
+    writer->total.files += writer->batch.files;
+    writer->total.bytes += writer->batch.bytes;
+    writer->total.syscalls += writer->batch.syscalls;
+    writer->count = 0;
+    writer->data.length = 0;
+    return failed;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ writer.h  include for writer.c
+ */
+
+#ifndef WRITER_H
+#define WRITER_H
+
+#include "output.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// A batch is submitted when it holds this many files or bytes
+#define WRITER_BATCH_FILES  256
+#define WRITER_BATCH_BYTES  (16 * 1024 * 1024)
+#define WRITER_RING_ENTRIES 256     // io_uring submission queue size
+
+typedef enum {
+    WRITER_STDIO,                   // Each output written by its own writer as it is made
+    WRITER_PWRITEV,                 // Batched, open/pwritev/close per file
+    WRITER_URING,                   // Batched, opens then writes/closes submitted through io_uring
+    NUM_WRITERS
+} WriterBackend;
+
+// One queued output file, content is data[offset, offset + length)
+typedef struct {
+    char   path[OUTPUT_PATH_MAX];
+    size_t offset;
+    size_t length;                  // Still to be written
+    size_t written;
+    int    tag;                     // Caller's number for the file (batch job)
+    int    fd;
+    bool   ok;
+} WriteRequest;
+
+typedef struct {
+    int      files;
+    uint64_t bytes;
+    long     syscalls;
+} WriterStats;
+
+typedef struct Uring Uring;
+
+typedef struct {
+    WriterBackend backend;
+    bool          fsync;            // fsync every file before it is closed
+    OutputBuffer  data;             // Content of every queued file
+    WriteRequest* files;
+    int           count;
+    int           capacity;
+    int           batches;
+    WriterStats   batch;            // Last submitted batch
+    WriterStats   total;
+    Uring*        ring;
+} FileWriter;
+
+// Batched writer functions
+int initFileWriter(FileWriter* writer, WriterBackend backend, bool fsync);
+int queueWriterFile(FileWriter* writer, const char* path, size_t offset, int tag);
+bool isWriterFull(const FileWriter* writer);
+int flushFileWriter(FileWriter* writer, bool* status);
+void freeFileWriter(FileWriter* writer);
+int getWriterBackend(const char* name, WriterBackend* backend);
+const char* getWriterName(WriterBackend backend);
+
+#endif // WRITER_H
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ y4m.c  streams a pattern as YUV4MPEG2 video, a software stand-in for the
+        PT-430 in front of a DVB encoder (tcgen --y4m -t ID | ffmpeg -i - ...).
+
+ The PT-430 picture never changes: both fields of every frame come from
+ the same EPROM lines. The frame is rendered once into a cache and every
+ frame of the stream is a writev() of the "FRAME" header and that same
+ buffer, so nothing is copied per frame. Paced output sleeps to absolute
+ frame deadlines, unpaced output sends several frames per system call.
+ */
+
+#include "y4m.h"
+#include "render.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#else
+// No writev, each iovec is written in turn.
+struct iovec {
+    void*  iov_base;
+    size_t iov_len;
+};
+static ssize_t writev(int fd, const struct iovec* iov, int count) {
+    ssize_t total = 0;
+    for (int i = 0; i < count; i++) {
+        ssize_t n = write(fd, iov[i].iov_base, iov[i].iov_len);
+        if (n < 0) return total ? total : n;
+        total += n;
+        if ((size_t)n < iov[i].iov_len) break;
+    }
+    return total;
+}
+#endif
+
+// Stream header, PAL 4:3 interlaced top field first.
+static const char y4m_header_format[] = "YUV4MPEG2 W%d H%d F%d:1 It A16:15 C420jpeg\n";
+static const char y4m_frame_header[] = "FRAME\n";
+
+// writev the whole iovec list, advancing through partial writes.
+static int writevAll(int fd, struct iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t n = writev(fd, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char*)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 1;
+}
+
+// Stream pattern (0-3) of image to fd. fps 0 is unpaced, frames 0 runs until
+// the reader goes away.
+int streamY4m(int fd, const uint8_t* image, int pattern, int fps, long frames) {
+    size_t frame_size = getFrameSize(FRAME_YUV420);
+    uint8_t* frame = (uint8_t*)malloc(frame_size);
+    if (!frame) {
+        perror("Error allocating memory for frame");
+        return 0;
+    }
+    if (!renderFrame(image, pattern, FRAME_YUV420, frame)) {
+        free(frame);
+        return 0;
+    }
+
+#ifdef SIGPIPE
+    // A closed pipe ends the stream, it is not an error.
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    char header[64];
+    int header_len = snprintf(header, sizeof(header), y4m_header_format,
+                              FRAME_WIDTH, FRAME_HEIGHT, fps > 0 ? fps : Y4M_FPS_PAL);
+    if (write(fd, header, header_len) != header_len) {
+        free(frame);
+        return errno == EPIPE;
+    }
+
+    // Same two buffers repeated for each frame in a batch.
+    int per_io = fps > 0 ? 1 : Y4M_FRAMES_PER_IO;
+    struct iovec iov[2 * Y4M_FRAMES_PER_IO];
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    long sent = 0;
+    int ok = 1;
+    while (frames == 0 || sent < frames) {
+        int batch = per_io;
+        if (frames && frames - sent < batch) {
+            batch = (int)(frames - sent);
+        }
+        for (int i = 0; i < batch; i++) {
+            iov[2 * i].iov_base = (void*)y4m_frame_header;
+            iov[2 * i].iov_len = sizeof(y4m_frame_header) - 1;
+            iov[2 * i + 1].iov_base = frame;
+            iov[2 * i + 1].iov_len = frame_size;
+        }
+
+        if (fps > 0) {
+            // Absolute deadlines, so write time does not add up as drift.
+            next.tv_nsec += 1000000000L / fps;
+            while (next.tv_nsec >= 1000000000L) {
+                next.tv_nsec -= 1000000000L;
+                next.tv_sec++;
+            }
+#ifndef _WIN32
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR) {
+            }
+#else
+            usleep(1000000 / fps);
+#endif
+        }
+
+        if (!writevAll(fd, iov, 2 * batch)) {
+            ok = (errno == EPIPE);
+            break;
+        }
+        sent += batch;
+    }
+
+    free(frame);
+    return ok;
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2025  Robert Hensel VK3DG <vk3dgtv@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ y4m.h  include for y4m.c
+ */
+
+#ifndef Y4M_H
+#define Y4M_H
+
+#include <stdint.h>
+
+#define Y4M_FPS_PAL        25      // Default frame rate
+#define Y4M_FRAMES_PER_IO  8       // Frames per writev when unpaced
+
+// YUV4MPEG2 streaming
+int streamY4m(int fd, const uint8_t* image, int pattern, int fps, long frames);
+
+#endif // Y4M_H